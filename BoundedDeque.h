@@ -0,0 +1,970 @@
+// -----------------------------
+// projects/deque/BoundedDeque.h
+// -----------------------------
+
+#ifndef BoundedDeque_h
+#define BoundedDeque_h
+
+// --------
+// includes
+// --------
+
+#include <algorithm>          // equal, lexicographical_compare, move, move_backward, rotate
+#include <cassert>            // assert
+#include <condition_variable> // condition_variable
+#include <cstddef>            // ptrdiff_t, size_t
+#include <iterator>           // random_access_iterator_tag
+#include <mutex>              // defer_lock, lock, mutex, unique_lock
+#include <new>                // placement new
+#include <stdexcept>          // out_of_range
+#include <type_traits>        // aligned_storage, enable_if, remove_const
+#include <utility>            // forward, move
+
+// --------------
+// deque_overflow
+// --------------
+
+/**
+ * what a BoundedDeque does with a push when it is full
+ *   deque_reject    the push fails and returns false, the deque is unchanged
+ *   deque_overwrite the element at the other end is destroyed to make room (push_back drops the front)
+ *   deque_block     the push waits until another thread pops; the deque locks a mutex in its
+ *                   push, pop, size, clear, resize, copy and move operations, and pop on an empty
+ *                   deque waits for a push
+ */
+enum deque_overflow {
+    deque_reject,
+    deque_overwrite,
+    deque_block};
+
+// ------------------
+// bounded_deque_sync
+// ------------------
+
+/**
+ * the locking a BoundedDeque needs for its overflow policy: none, except for deque_block
+ */
+template <deque_overflow F>
+struct bounded_deque_sync {
+    struct lock {
+        explicit lock (bounded_deque_sync&) {}};
+
+    struct pair_lock {
+        pair_lock (bounded_deque_sync&, bounded_deque_sync&) {}};
+
+    template <typename P>
+    void wait_not_full (lock&, P) {}
+
+    template <typename P>
+    void wait_not_empty (lock&, P) {}
+
+    void notify_not_full () {}
+
+    void notify_all_not_full () {}
+
+    void notify_not_empty () {}
+
+    void notify_all_not_empty () {}};
+
+template <>
+struct bounded_deque_sync<deque_block> {
+    std::mutex              m;
+    std::condition_variable not_full;
+    std::condition_variable not_empty;
+
+    struct lock : std::unique_lock<std::mutex> {
+        explicit lock (bounded_deque_sync& s) :
+                std::unique_lock<std::mutex>(s.m)
+        {}};
+
+    //both deques of a copy or move, locked together so two assignments in opposite directions cannot deadlock
+    struct pair_lock {
+        std::unique_lock<std::mutex> first;
+        std::unique_lock<std::mutex> second;
+
+        pair_lock (bounded_deque_sync& s, bounded_deque_sync& t) :
+                first(s.m, std::defer_lock),
+                second(t.m, std::defer_lock) {
+            std::lock(first, second);}};
+
+    template <typename P>
+    void wait_not_full (lock& l, P p) {
+        not_full.wait(l, p);}
+
+    template <typename P>
+    void wait_not_empty (lock& l, P p) {
+        not_empty.wait(l, p);}
+
+    void notify_not_full () {
+        not_full.notify_one();}
+
+    void notify_all_not_full () {
+        not_full.notify_all();}
+
+    void notify_not_empty () {
+        not_empty.notify_one();}
+
+    void notify_all_not_empty () {
+        not_empty.notify_all();}};
+
+// ------------
+// BoundedDeque
+// ------------
+
+/**
+ * deque of at most N elements in one inline ring, so it never allocates
+ * element i lives at slot (head + i) wrapped once past N, without a block map to hop through
+ * T the element type
+ * N the capacity
+ * F what a push does when the deque is full
+ */
+template <typename T, std::size_t N, deque_overflow F = deque_reject>
+class BoundedDeque {
+    static_assert(N != 0, "BoundedDeque needs a capacity of at least one");
+
+    public:
+        // --------
+        // typedefs
+        // --------
+
+        typedef T                 value_type;
+
+        typedef std::size_t       size_type;
+        typedef std::ptrdiff_t    difference_type;
+
+        typedef value_type*       pointer;
+        typedef const value_type* const_pointer;
+
+        typedef value_type&       reference;
+        typedef const value_type& const_reference;
+
+        // --------
+        // overflow
+        // --------
+
+        static const deque_overflow overflow = F;
+
+    private:
+        typedef typename std::aligned_storage<sizeof(value_type), alignof(value_type)>::type slot_type;
+
+        // --------------
+        // basic_iterator
+        // --------------
+
+        /**
+         * random-access iterator over the ring: the slots, the head it was made with and an index
+         * V the element type (const for the const_iterator)
+         */
+        template <typename V>
+        class basic_iterator {
+            friend class BoundedDeque;
+
+            template <typename>
+            friend class basic_iterator;
+
+            public:
+                // --------
+                // typedefs
+                // --------
+
+                typedef std::random_access_iterator_tag     iterator_category;
+                typedef typename std::remove_const<V>::type value_type;
+                typedef std::ptrdiff_t                      difference_type;
+                typedef V*                                  pointer;
+                typedef V&                                  reference;
+
+            private:
+                V*          slots;
+                std::size_t head;
+                std::size_t index;
+
+            public:
+                // -----------
+                // constructor
+                // -----------
+
+                basic_iterator (V* s = 0, std::size_t h = 0, std::size_t i = 0) :
+                        slots(s),
+                        head(h),
+                        index(i)
+                {}
+
+                /**
+                 * iterator to const_iterator
+                 */
+                template <typename V2, typename = typename std::enable_if<std::is_convertible<V2*, V*>::value>::type>
+                basic_iterator (const basic_iterator<V2>& that) :
+                        slots(that.slots),
+                        head(that.head),
+                        index(that.index)
+                {}
+
+                // -----------
+                // operator ==
+                // -----------
+
+                friend bool operator == (const basic_iterator& lhs, const basic_iterator& rhs) {
+                    return (lhs.slots == rhs.slots) && (lhs.index == rhs.index);}
+
+                friend bool operator != (const basic_iterator& lhs, const basic_iterator& rhs) {
+                    return !(lhs == rhs);}
+
+                friend bool operator < (const basic_iterator& lhs, const basic_iterator& rhs) {
+                    return lhs.index < rhs.index;}
+
+                friend bool operator > (const basic_iterator& lhs, const basic_iterator& rhs) {
+                    return rhs < lhs;}
+
+                friend bool operator <= (const basic_iterator& lhs, const basic_iterator& rhs) {
+                    return !(rhs < lhs);}
+
+                friend bool operator >= (const basic_iterator& lhs, const basic_iterator& rhs) {
+                    return !(lhs < rhs);}
+
+                // ----------
+                // operator +
+                // ----------
+
+                friend basic_iterator operator + (basic_iterator lhs, difference_type rhs) {
+                    return lhs += rhs;}
+
+                friend basic_iterator operator + (difference_type lhs, basic_iterator rhs) {
+                    return rhs += lhs;}
+
+                friend basic_iterator operator - (basic_iterator lhs, difference_type rhs) {
+                    return lhs -= rhs;}
+
+                friend difference_type operator - (const basic_iterator& lhs, const basic_iterator& rhs) {
+                    return static_cast<difference_type>(lhs.index) - static_cast<difference_type>(rhs.index);}
+
+                // ----------
+                // operator *
+                // ----------
+
+                reference operator * () const {
+                    return slots[BoundedDeque::wrap(head + index)];}
+
+                pointer operator -> () const {
+                    return &**this;}
+
+                reference operator [] (difference_type n) const {
+                    return slots[BoundedDeque::wrap(head + index + n)];}
+
+                // -----------
+                // operator ++
+                // -----------
+
+                basic_iterator& operator ++ () {
+                    ++index;
+                    return *this;}
+
+                basic_iterator operator ++ (int) {
+                    basic_iterator x = *this;
+                    ++*this;
+                    return x;}
+
+                basic_iterator& operator -- () {
+                    --index;
+                    return *this;}
+
+                basic_iterator operator -- (int) {
+                    basic_iterator x = *this;
+                    --*this;
+                    return x;}
+
+                // -----------
+                // operator +=
+                // -----------
+
+                basic_iterator& operator += (difference_type d) {
+                    index += d;
+                    return *this;}
+
+                basic_iterator& operator -= (difference_type d) {
+                    index -= d;
+                    return *this;}};
+
+    public:
+        typedef basic_iterator<value_type>       iterator;
+        typedef basic_iterator<const value_type> const_iterator;
+
+    private:
+        typedef bounded_deque_sync<F>         sync_type;
+        typedef typename sync_type::lock      lock_type;
+        typedef typename sync_type::pair_lock pair_lock_type;
+
+        // ----
+        // data
+        // ----
+
+        slot_type slots[N];
+        size_type head;
+        size_type count;
+        sync_type sync;
+
+    private:
+        // -----
+        // valid
+        // -----
+
+        bool valid () const {
+            return (head < N) && (count <= N);}
+
+        // ----
+        // wrap
+        // ----
+
+        /**
+         * @param j a ring position less than 2 * N
+         * @return j folded into [0, N), a compare and a conditional move rather than a division
+         */
+        static size_type wrap (size_type j) {
+            return (j < N) ? j : j - N;}
+
+        // -----
+        // slot
+        // -----
+
+        value_type* base () {
+            return reinterpret_cast<value_type*>(slots);}
+
+        const value_type* base () const {
+            return reinterpret_cast<const value_type*>(slots);}
+
+        value_type* slot (size_type i) {
+            return base() + wrap(head + i);}
+
+    public:
+        // --------
+        // capacity
+        // --------
+
+        /**
+         * @return N, usable in constant expressions
+         */
+        static constexpr size_type capacity () {
+            return N;}
+
+        static constexpr size_type max_size () {
+            return N;}
+
+        // ------------
+        // constructors
+        // ------------
+
+        BoundedDeque () :
+                head(0),
+                count(0)
+        {
+            assert(valid());
+        }
+
+        /**
+         * @param s the number of value-initialized elements, at most N
+         */
+        explicit BoundedDeque (size_type s) :
+                BoundedDeque()
+        {
+            assert(s <= N);
+            while(count < s)
+            {
+                emplace_back();
+            }
+        }
+
+        /**
+         * @param s the number of copies, at most N
+         * @param v the element to copy
+         */
+        BoundedDeque (size_type s, const_reference v) :
+                BoundedDeque()
+        {
+            assert(s <= N);
+            while(count < s)
+            {
+                emplace_back(v);
+            }
+        }
+
+        /**
+         * @param b the beginning of a range
+         * @param e the end of a range, which goes through the overflow policy if it holds more than N
+         */
+        template <typename II, typename = typename std::enable_if<!std::is_integral<II>::value>::type>
+        BoundedDeque (II b, II e) :
+                BoundedDeque()
+        {
+            static_assert(F != deque_block, "a range longer than N would never finish constructing");
+            for(; b != e; ++b)
+            {
+                emplace_back(*b);
+            }
+        }
+
+        BoundedDeque (const BoundedDeque& that) :
+                BoundedDeque()
+        {
+            lock_type l(const_cast<sync_type&>(that.sync));
+            for(const_iterator it = that.begin(); it != that.end(); ++it)
+            {
+                ::new (static_cast<void*>(slot(count))) value_type(*it);
+                ++count;
+            }
+        }
+
+        /**
+         * moves the elements one by one, leaving that empty
+         */
+        BoundedDeque (BoundedDeque&& that) :
+                BoundedDeque()
+        {
+            lock_type l(that.sync);
+            take(that);
+            that.sync.notify_all_not_full();
+        }
+
+        // ----------
+        // destructor
+        // ----------
+
+        ~BoundedDeque ()
+        {
+            destroy();
+        }
+
+        // ----------
+        // operator =
+        // ----------
+
+        BoundedDeque& operator = (const BoundedDeque& that)
+        {
+            if(this != &that)
+            {
+                pair_lock_type l(sync, const_cast<sync_type&>(that.sync));
+                destroy();
+                for(const_iterator it = that.begin(); it != that.end(); ++it)
+                {
+                    ::new (static_cast<void*>(slot(count))) value_type(*it);
+                    ++count;
+                }
+                notify_resized();
+            }
+            return *this;
+        }
+
+        BoundedDeque& operator = (BoundedDeque&& that)
+        {
+            if(this != &that)
+            {
+                pair_lock_type l(sync, that.sync);
+                destroy();
+                take(that);
+                notify_resized();
+                that.sync.notify_all_not_full();
+            }
+            return *this;
+        }
+
+        // -----------
+        // operator ==
+        // -----------
+
+        friend bool operator == (const BoundedDeque& lhs, const BoundedDeque& rhs) {
+            return (lhs.count == rhs.count) && std::equal(lhs.begin(), lhs.end(), rhs.begin());}
+
+        friend bool operator != (const BoundedDeque& lhs, const BoundedDeque& rhs) {
+            return !(lhs == rhs);}
+
+        // ----------
+        // operator <
+        // ----------
+
+        friend bool operator < (const BoundedDeque& lhs, const BoundedDeque& rhs) {
+            return std::lexicographical_compare(lhs.begin(), lhs.end(), rhs.begin(), rhs.end());}
+
+        // -----------
+        // operator []
+        // -----------
+
+        reference operator [] (size_type index) {
+            return *slot(index);}
+
+        const_reference operator [] (size_type index) const {
+            return const_cast<BoundedDeque*>(this)->operator[](index);}
+
+        // --
+        // at
+        // --
+
+        /**
+         * @param index the position of the element
+         * @return the element at index
+         * @throw out_of_range
+         */
+        reference at (size_type index) {
+            if (index >= count)
+                throw std::out_of_range("invalid index");
+            return *slot(index);}
+
+        const_reference at (size_type index) const {
+            return const_cast<BoundedDeque*>(this)->at(index);}
+
+        // -----
+        // front
+        // -----
+
+        reference front () {
+            return *slot(0);}
+
+        const_reference front () const {
+            return const_cast<BoundedDeque*>(this)->front();}
+
+        // ----
+        // back
+        // ----
+
+        reference back () {
+            return *slot(count - 1);}
+
+        const_reference back () const {
+            return const_cast<BoundedDeque*>(this)->back();}
+
+        // -----
+        // begin
+        // -----
+
+        iterator begin () {
+            return iterator(base(), head, 0);}
+
+        const_iterator begin () const {
+            return const_iterator(base(), head, 0);}
+
+        const_iterator cbegin () const {
+            return begin();}
+
+        // ---
+        // end
+        // ---
+
+        iterator end () {
+            return iterator(base(), head, count);}
+
+        const_iterator end () const {
+            return const_iterator(base(), head, count);}
+
+        const_iterator cend () const {
+            return end();}
+
+        // -----
+        // clear
+        // -----
+
+        void clear ()
+        {
+            lock_type l(sync);
+            destroy();
+            //every slot is free, so every waiting push can go ahead
+            sync.notify_all_not_full();
+        }
+
+        // -----
+        // empty
+        // -----
+
+        bool empty () const {
+            return size() == 0;}
+
+        // ----
+        // full
+        // ----
+
+        bool full () const {
+            return size() == N;}
+
+        // ----
+        // size
+        // ----
+
+        size_type size () const {
+            lock_type l(const_cast<sync_type&>(sync));
+            return count;}
+
+        // ------------
+        // emplace_back
+        // ------------
+
+        /**
+         * @param args the arguments forwarded to the constructor of the new element
+         * @return false if the deque was full and the policy is deque_reject, otherwise true
+         */
+        template <typename... Args>
+        bool emplace_back (Args&&... args)
+        {
+            lock_type l(sync);
+            if(!wait_for_room(l))
+            {
+                return false;
+            }
+            if(count == N)
+            {
+                //deque_overwrite: build the value before dropping the front, which args may refer to
+                value_type v(std::forward<Args>(args)...);
+                destroy_front();
+                ::new (static_cast<void*>(slot(count))) value_type(std::move(v));
+            }
+            else
+            {
+                ::new (static_cast<void*>(slot(count))) value_type(std::forward<Args>(args)...);
+            }
+            ++count;
+            sync.notify_not_empty();
+            return true;
+        }
+
+        // -------------
+        // emplace_front
+        // -------------
+
+        template <typename... Args>
+        bool emplace_front (Args&&... args)
+        {
+            lock_type l(sync);
+            if(!wait_for_room(l))
+            {
+                return false;
+            }
+            size_type new_head = (head == 0) ? N - 1 : head - 1;
+            if(count == N)
+            {
+                //deque_overwrite: build the value before dropping the back, which args may refer to
+                value_type v(std::forward<Args>(args)...);
+                destroy_back();
+                ::new (static_cast<void*>(base() + new_head)) value_type(std::move(v));
+            }
+            else
+            {
+                ::new (static_cast<void*>(base() + new_head)) value_type(std::forward<Args>(args)...);
+            }
+            head = new_head;
+            ++count;
+            sync.notify_not_empty();
+            return true;
+        }
+
+        // ---------
+        // push_back
+        // ---------
+
+        bool push_back (const_reference v) {
+            return emplace_back(v);}
+
+        bool push_back (value_type&& v) {
+            return emplace_back(std::move(v));}
+
+        // ----------
+        // push_front
+        // ----------
+
+        bool push_front (const_reference v) {
+            return emplace_front(v);}
+
+        bool push_front (value_type&& v) {
+            return emplace_front(std::move(v));}
+
+        // --------
+        // pop_back
+        // --------
+
+        /**
+         * the deque must not be empty, except under deque_block, where pop waits for an element
+         */
+        void pop_back ()
+        {
+            lock_type l(sync);
+            wait_for_element(l);
+            destroy_back();
+            sync.notify_not_full();
+        }
+
+        /**
+         * @param v where the back element is moved before it is popped
+         */
+        void pop_back (reference v)
+        {
+            lock_type l(sync);
+            wait_for_element(l);
+            v = std::move(*slot(count - 1));
+            destroy_back();
+            sync.notify_not_full();
+        }
+
+        // ---------
+        // pop_front
+        // ---------
+
+        void pop_front ()
+        {
+            lock_type l(sync);
+            wait_for_element(l);
+            destroy_front();
+            sync.notify_not_full();
+        }
+
+        void pop_front (reference v)
+        {
+            lock_type l(sync);
+            wait_for_element(l);
+            v = std::move(*slot(0));
+            destroy_front();
+            sync.notify_not_full();
+        }
+
+        // -------------
+        // try_pop_front
+        // -------------
+
+        /**
+         * @param v where the front element is moved
+         * @return false if the deque was empty
+         */
+        bool try_pop_front (reference v)
+        {
+            lock_type l(sync);
+            if(count == 0)
+            {
+                return false;
+            }
+            v = std::move(*slot(0));
+            destroy_front();
+            sync.notify_not_full();
+            return true;
+        }
+
+        // ------------
+        // try_pop_back
+        // ------------
+
+        bool try_pop_back (reference v)
+        {
+            lock_type l(sync);
+            if(count == 0)
+            {
+                return false;
+            }
+            v = std::move(*slot(count - 1));
+            destroy_back();
+            sync.notify_not_full();
+            return true;
+        }
+
+        // -------
+        // emplace
+        // -------
+
+        /**
+         * construct an element before it, shifting the shorter side
+         * under deque_overwrite a full deque first drops the front, taking it with it if it pointed there
+         * @return an iterator to the new element, or end() if the deque was full and the policy is deque_reject
+         */
+        template <typename... Args>
+        iterator emplace (const_iterator it, Args&&... args)
+        {
+            static_assert(F != deque_block, "an iterator would not survive waiting for room");
+            size_type offset = it.index;
+            value_type v(std::forward<Args>(args)...);
+            if(count == N)
+            {
+                if(F == deque_reject)
+                {
+                    return end();
+                }
+                destroy_front();
+                offset -= (offset != 0);
+            }
+            if(offset < count / 2)
+            {
+                emplace_front(std::move(v));
+                std::rotate(begin(), begin() + 1, begin() + (offset + 1));
+            }
+            else
+            {
+                emplace_back(std::move(v));
+                std::rotate(begin() + offset, end() - 1, end());
+            }
+            return begin() + offset;
+        }
+
+        // ------
+        // insert
+        // ------
+
+        iterator insert (const_iterator it, const_reference v) {
+            return emplace(it, v);}
+
+        iterator insert (const_iterator it, value_type&& v) {
+            return emplace(it, std::move(v));}
+
+        // -----
+        // erase
+        // -----
+
+        /**
+         * @param it the element to remove
+         * @return an iterator to the element after it
+         */
+        iterator erase (const_iterator it)
+        {
+            static_assert(F != deque_block, "erase by iterator is not synchronized");
+            size_type offset = it.index;
+            if(offset < count / 2)
+            {
+                std::move_backward(begin(), begin() + offset, begin() + (offset + 1));
+                destroy_front();
+            }
+            else
+            {
+                std::move(begin() + (offset + 1), end(), begin() + offset);
+                destroy_back();
+            }
+            return begin() + offset;
+        }
+
+        // ------
+        // resize
+        // ------
+
+        /**
+         * @param s the new size, at most N
+         */
+        void resize (size_type s)
+        {
+            assert(s <= N);
+            lock_type l(sync);
+            while(count > s)
+            {
+                destroy_back();
+            }
+            while(count < s)
+            {
+                ::new (static_cast<void*>(slot(count))) value_type();
+                ++count;
+            }
+            notify_resized();
+        }
+
+        void resize (size_type s, const_reference v)
+        {
+            assert(s <= N);
+            lock_type l(sync);
+            while(count > s)
+            {
+                destroy_back();
+            }
+            while(count < s)
+            {
+                ::new (static_cast<void*>(slot(count))) value_type(v);
+                ++count;
+            }
+            notify_resized();
+        }
+
+    private:
+        // -------------
+        // wait_for_room
+        // -------------
+
+        /**
+         * apply the overflow policy if the deque is full, short of dropping an element:
+         * deque_block waits for room, deque_reject gives up, and deque_overwrite goes ahead
+         * full, leaving the push to drop the other end once the new value is built
+         * @return whether the push goes ahead
+         */
+        bool wait_for_room (lock_type& l)
+        {
+            if(F == deque_block)
+            {
+                sync.wait_not_full(l, [this] () {return count < N;});
+            }
+            return (count < N) || (F == deque_overwrite);
+        }
+
+        // ----------------
+        // wait_for_element
+        // ----------------
+
+        void wait_for_element (lock_type& l)
+        {
+            if(F == deque_block)
+            {
+                sync.wait_not_empty(l, [this] () {return count != 0;});
+            }
+            assert(count != 0);
+        }
+
+        // --------------
+        // notify_resized
+        // --------------
+
+        /**
+         * after a change of size by more than one, wake every waiter to recheck:
+         * any number of pushes and pops may now go ahead
+         */
+        void notify_resized ()
+        {
+            sync.notify_all_not_full();
+            sync.notify_all_not_empty();
+        }
+
+        // -------------
+        // destroy_front
+        // -------------
+
+        void destroy_front ()
+        {
+            slot(0)->~value_type();
+            head = wrap(head + 1);
+            --count;
+        }
+
+        // ------------
+        // destroy_back
+        // ------------
+
+        void destroy_back ()
+        {
+            slot(count - 1)->~value_type();
+            --count;
+        }
+
+        // -------
+        // destroy
+        // -------
+
+        void destroy ()
+        {
+            while(count != 0)
+            {
+                destroy_back();
+            }
+            head = 0;
+        }
+
+        // ----
+        // take
+        // ----
+
+        void take (BoundedDeque& that)
+        {
+            for(size_type i = 0; i != that.count; ++i)
+            {
+                ::new (static_cast<void*>(slot(count))) value_type(std::move(*that.slot(i)));
+                ++count;
+            }
+            that.destroy();
+        }
+};
+
+template <typename T, std::size_t N, deque_overflow F>
+const deque_overflow BoundedDeque<T, N, F>::overflow;
+
+#endif // BoundedDeque_h
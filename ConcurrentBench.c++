@@ -0,0 +1,282 @@
+// ----------------------------------
+// projects/deque/ConcurrentBench.c++
+// ----------------------------------
+
+/*
+To run the benchmarks:
+    % make ConcurrentBench
+    % ./ConcurrentBench
+To record them for comparing two versions:
+    % make ConcurrentBench.json
+*/
+
+// --------
+// includes
+// --------
+
+#include <atomic>  // atomic
+#include <chrono>  // steady_clock
+#include <mutex>   // lock_guard, mutex
+#include <random>  // minstd_rand
+#include <thread>  // thread, yield
+#include <vector>  // vector
+
+#include "benchmark/benchmark.h"
+
+#include "ConcurrentDeque.h"
+#include "Deque.h"
+
+using namespace std;
+
+// -----------
+// LockedDeque
+// -----------
+
+/**
+ * the handoff queue we had before: a MyDeque behind one mutex
+ */
+template <typename T>
+class LockedDeque
+{
+    public:
+        void push_back (const T& v)
+        {
+            lock_guard<mutex> lock(m);
+            x.push_back(v);
+        }
+
+        bool try_pop_front (T& v)
+        {
+            lock_guard<mutex> lock(m);
+            if(x.empty())
+            {
+                return false;
+            }
+            v = x.front();
+            x.pop_front();
+            return true;
+        }
+
+    private:
+        mutex m;
+        MyDeque<T> x;
+};
+
+template <typename Q, typename T>
+inline void pop_spinning (Q& q, T& v)
+{
+    while(!q.try_pop_front(v))
+    {
+        this_thread::yield();
+    }
+}
+
+// ----------
+// throughput
+// ----------
+
+/**
+ * one producer thread pushes n elements while the benchmark thread pops them
+ */
+template <typename Q>
+void BM_HandoffThroughput (benchmark::State& state)
+{
+    const int n = state.range(0);
+    for(auto _ : state)
+    {
+        Q q;
+        thread producer([&q, n] () {
+            for(int i = 0; i < n; ++i)
+            {
+                q.push_back(i);
+            }});
+        int v = 0;
+        for(int i = 0; i < n; ++i)
+        {
+            pop_spinning(q, v);
+        }
+        producer.join();
+        benchmark::DoNotOptimize(v);
+    }
+    state.SetItemsProcessed(state.iterations() * n);
+}
+
+// -------
+// latency
+// -------
+
+/**
+ * ping-pong over two queues: the time per round trip is twice the one-way handoff latency
+ * reported per element as the benchmark's time, with the worst round trip as a counter
+ */
+template <typename Q>
+void BM_HandoffLatency (benchmark::State& state)
+{
+    const int n = state.range(0);
+    double worst = 0;
+    for(auto _ : state)
+    {
+        Q ping;
+        Q pong;
+        thread echo([&ping, &pong, n] () {
+            int v;
+            for(int i = 0; i < n; ++i)
+            {
+                pop_spinning(ping, v);
+                pong.push_back(v);
+            }});
+        int v = 0;
+        for(int i = 0; i < n; ++i)
+        {
+            chrono::steady_clock::time_point start = chrono::steady_clock::now();
+            ping.push_back(i);
+            pop_spinning(pong, v);
+            double elapsed = chrono::duration<double, nano>(chrono::steady_clock::now() - start).count();
+            if(elapsed > worst)
+            {
+                worst = elapsed;
+            }
+        }
+        echo.join();
+    }
+    state.SetItemsProcessed(state.iterations() * n);
+    state.counters["worst_round_trip_ns"] = worst;
+}
+
+// ----
+// mpmc
+// ----
+
+/**
+ * p producers and p consumers move n elements through one queue
+ */
+template <typename Q>
+void BM_MPMCThroughput (benchmark::State& state)
+{
+    const int pairs = state.range(0);
+    const int n = state.range(1);
+    for(auto _ : state)
+    {
+        Q q;
+        vector<thread> threads;
+        for(int j = 0; j < pairs; ++j)
+        {
+            threads.push_back(thread([&q, n, pairs] () {
+                for(int i = 0; i < n / pairs; ++i)
+                {
+                    q.push_back(i);
+                }}));
+            threads.push_back(thread([&q, n, pairs] () {
+                int v;
+                for(int i = 0; i < n / pairs; ++i)
+                {
+                    pop_spinning(q, v);
+                }}));
+        }
+        for(size_t j = 0; j < threads.size(); ++j)
+        {
+            threads[j].join();
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * (n / pairs) * pairs);
+}
+
+/**
+ * 1, 2, 4, ..., 16 producer/consumer pairs moving 2^20 elements
+ */
+void MPMCArguments (benchmark::internal::Benchmark* b)
+{
+    for(int pairs = 1; pairs <= 16; pairs *= 2)
+    {
+        b->Args({pairs, 1 << 20});
+    }
+}
+
+// ---------
+// task_tree
+// ---------
+
+/**
+ * a task of depth d > 0 spawns two tasks of depth d - 1; a leaf does a little arithmetic
+ * each worker runs its own WorkStealingDeque as a stack and steals from a random victim when it runs dry
+ */
+void BM_TaskTreeScaling (benchmark::State& state)
+{
+    const int workers = state.range(0);
+    const int depth = state.range(1);
+    for(auto _ : state)
+    {
+        WorkStealingDeque<int> queues[64];
+        atomic<long> pending(1);
+        atomic<long> leaves(0);
+        queues[0].push_back(depth);
+        vector<thread> threads;
+        for(int w = 0; w < workers; ++w)
+        {
+            threads.push_back(thread([&, w] () {
+                minstd_rand random(w + 1);
+                long local_leaves = 0;
+                unsigned sink = w;
+                int task;
+                while(pending.load(memory_order_acquire) != 0)
+                {
+                    if(!queues[w].try_pop_back(task) && !queues[random() % workers].try_steal_front(task))
+                    {
+                        this_thread::yield();
+                        continue;
+                    }
+                    if(task == 0)
+                    {
+                        for(int i = 0; i < 64; ++i)
+                        {
+                            sink = sink * 1664525 + 1013904223;
+                        }
+                        ++local_leaves;
+                        pending.fetch_sub(1, memory_order_release);
+                    }
+                    else
+                    {
+                        pending.fetch_add(1, memory_order_relaxed);
+                        queues[w].push_back(task - 1);
+                        queues[w].push_back(task - 1);
+                    }
+                }
+                benchmark::DoNotOptimize(sink);
+                leaves += local_leaves;}));
+        }
+        for(int w = 0; w < workers; ++w)
+        {
+            threads[w].join();
+        }
+        if(leaves.load() != (1L << depth))
+        {
+            state.SkipWithError("the task tree lost or repeated tasks");
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * ((2L << depth) - 1));
+}
+
+/**
+ * 1, 2, 4, ..., 64 workers on a tree of 2^17 - 1 tasks
+ */
+void TaskTreeArguments (benchmark::internal::Benchmark* b)
+{
+    for(int workers = 1; workers <= 64; workers *= 2)
+    {
+        b->Args({workers, 16});
+    }
+}
+
+// ------------
+// registration
+// ------------
+
+BENCHMARK_TEMPLATE(BM_HandoffThroughput, SPSCDeque<int>)->Arg(1 << 20)->UseRealTime();
+BENCHMARK_TEMPLATE(BM_HandoffThroughput, LockedDeque<int>)->Arg(1 << 20)->UseRealTime();
+BENCHMARK_TEMPLATE(BM_HandoffLatency, SPSCDeque<int>)->Arg(1 << 14)->UseRealTime();
+BENCHMARK_TEMPLATE(BM_HandoffLatency, LockedDeque<int>)->Arg(1 << 14)->UseRealTime();
+BENCHMARK_TEMPLATE(BM_MPMCThroughput, MPMCDeque<int>)->Apply(MPMCArguments)->UseRealTime();
+BENCHMARK_TEMPLATE(BM_MPMCThroughput, LockedDeque<int>)->Apply(MPMCArguments)->UseRealTime();
+BENCHMARK(BM_TaskTreeScaling)->Apply(TaskTreeArguments)->UseRealTime();
+
+BENCHMARK_MAIN();
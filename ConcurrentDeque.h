@@ -0,0 +1,1151 @@
+// --------------------------------
+// projects/deque/ConcurrentDeque.h
+// --------------------------------
+
+#ifndef ConcurrentDeque_h
+#define ConcurrentDeque_h
+
+// --------
+// includes
+// --------
+
+#include <atomic>  // atomic, memory_order
+#include <cstddef> // size_t
+#include <memory>  // allocator, allocator_traits
+#include <thread>  // yield
+#include <type_traits> // aligned_storage, false_type, is_nothrow_constructible, is_trivially_copyable, true_type
+#include <utility> // forward, move
+
+#include "Deque.h"
+
+// ----------------
+// deque_cache_line
+// ----------------
+
+/**
+ * the indices written by different threads are kept this far apart so they never share a cache line
+ */
+static const std::size_t deque_cache_line = 64;
+
+// -------------
+// deque_backoff
+// -------------
+
+/**
+ * spin for a while, then give the processor away; used by the blocking operations
+ * @param attempt how many times the caller has failed so far
+ */
+inline void deque_backoff (std::size_t attempt) {
+    if (attempt < 64)
+        std::atomic_signal_fence(std::memory_order_seq_cst);
+    else
+        std::this_thread::yield();}
+
+// ---------
+// SPSCDeque
+// ---------
+
+/**
+ * single-producer/single-consumer queue on MyDeque's block-and-map layout
+ * one thread calls push_back/emplace_back, one other thread calls try_pop_front
+ * element i lives at slot i & block_mask of block i >> block_shift; the map is a ring of
+ * block pointers indexed by block number, so a block never moves once it is installed
+ * T the element type
+ * A the allocator, used from both threads (blocks the cache cannot hold are freed by the consumer)
+ * B the number of elements per block, a power of two
+ */
+template < typename T, typename A = std::allocator<T>, std::size_t B = deque_block_size<T>::value >
+class SPSCDeque {
+    static_assert(B != 0 && (B & (B - 1)) == 0, "SPSCDeque block size must be a power of two");
+
+    public:
+        // --------
+        // typedefs
+        // --------
+
+        typedef A                                          allocator_type;
+        typedef std::allocator_traits<allocator_type>      allocator_traits;
+        typedef typename allocator_traits::value_type      value_type;
+
+        typedef typename allocator_traits::size_type       size_type;
+        typedef typename allocator_traits::difference_type difference_type;
+
+        typedef typename allocator_traits::pointer         pointer;
+
+        typedef value_type&                                reference;
+        typedef const value_type&                          const_reference;
+
+        // ----------
+        // block_size
+        // ----------
+
+        static const std::size_t block_size  = B;
+        static const std::size_t block_shift = deque_log2(B);
+        static const std::size_t block_mask  = B - 1;
+
+        // ----------------------------
+        // default_block_cache_capacity
+        // ----------------------------
+
+        static const std::size_t default_block_cache_capacity = 4;
+
+    private:
+        // ---------
+        // block_map
+        // ---------
+
+        /**
+         * ring of block pointers; block k lives in slots[k & mask]
+         * a map that has been outgrown is kept (through retired) until the deque is destroyed,
+         * since the consumer may still be reading it
+         */
+        struct block_map {
+            pointer*   slots;
+            size_type  mask;
+            block_map* retired;};
+
+        typedef typename allocator_traits::template rebind_alloc<pointer>   outer_allocator_type;
+        typedef std::allocator_traits<outer_allocator_type>                 outer_traits;
+        typedef typename allocator_traits::template rebind_alloc<block_map> map_allocator_type;
+        typedef std::allocator_traits<map_allocator_type>                   map_traits;
+
+        // ----
+        // data
+        // ----
+
+        //consumer side
+        alignas(deque_cache_line) std::atomic<size_type> head;
+        size_type  cached_tail;
+        block_map* consumer_map;
+
+        //producer side
+        alignas(deque_cache_line) std::atomic<size_type> tail;
+        size_type  cached_head;
+        size_type  installed_end;
+        block_map* producer_map;
+        std::atomic<block_map*> map;
+
+        //emptied blocks travel from the consumer back to the producer through this ring
+        alignas(deque_cache_line) std::atomic<size_type> spare_head;
+        alignas(deque_cache_line) std::atomic<size_type> spare_tail;
+        pointer*  spare_blocks;
+        size_type spare_capacity;
+
+        allocator_type       _a;
+        outer_allocator_type _a_outer;
+        map_allocator_type   _a_map;
+
+    public:
+        // ------------
+        // constructors
+        // ------------
+
+        /**
+         * @param cache_capacity how many emptied blocks are kept for the producer to reuse
+         * @param a the allocator
+         */
+        explicit SPSCDeque (size_type cache_capacity = default_block_cache_capacity, const allocator_type& a = allocator_type()) :
+                head(0), cached_tail(0), consumer_map(0),
+                tail(0), cached_head(0), installed_end(0), producer_map(0), map(0),
+                spare_head(0), spare_tail(0), spare_blocks(0), spare_capacity(cache_capacity),
+                _a(a), _a_outer(a), _a_map(a)
+        {
+            if(spare_capacity)
+            {
+                spare_blocks = outer_traits::allocate(_a_outer, spare_capacity);
+            }
+        }
+
+        SPSCDeque (const SPSCDeque&) = delete;
+        SPSCDeque& operator = (const SPSCDeque&) = delete;
+
+        // ----------
+        // destructor
+        // ----------
+
+        /**
+         * neither thread may be using the deque any more
+         */
+        ~SPSCDeque ()
+        {
+            size_type h = head.load(std::memory_order_acquire);
+            size_type t = tail.load(std::memory_order_acquire);
+            for(; h != t; ++h)
+            {
+                allocator_traits::destroy(_a, slot(producer_map, h));
+            }
+            //the installed blocks that have not been handed back
+            for(size_type k = head.load(std::memory_order_relaxed) >> block_shift; k < (installed_end >> block_shift); ++k)
+            {
+                allocator_traits::deallocate(_a, producer_map->slots[k & producer_map->mask], block_size);
+            }
+            for(size_type i = spare_head.load(std::memory_order_relaxed); i != spare_tail.load(std::memory_order_relaxed); ++i)
+            {
+                allocator_traits::deallocate(_a, spare_blocks[i % spare_capacity], block_size);
+            }
+            if(spare_blocks)
+            {
+                outer_traits::deallocate(_a_outer, spare_blocks, spare_capacity);
+            }
+            while(producer_map)
+            {
+                block_map* retired = producer_map->retired;
+                outer_traits::deallocate(_a_outer, producer_map->slots, producer_map->mask + 1);
+                map_traits::deallocate(_a_map, producer_map, 1);
+                producer_map = retired;
+            }
+        }
+
+        // ------------
+        // emplace_back
+        // ------------
+
+        /**
+         * producer only: construct an element at the back
+         * allocates only when a new block is needed and the cache is empty, or the map is full
+         * @param args the arguments for the element's constructor
+         */
+        template <typename... Args>
+        void emplace_back (Args&&... args)
+        {
+            size_type t = tail.load(std::memory_order_relaxed);
+            if(t == installed_end)
+            {
+                install_block(t >> block_shift);
+                installed_end += block_size;
+            }
+            allocator_traits::construct(_a, slot(producer_map, t), std::forward<Args>(args)...);
+            tail.store(t + 1, std::memory_order_release);
+        }
+
+        // ---------
+        // push_back
+        // ---------
+
+        /**
+         * producer only: add v to the back
+         * @param v the value to be pushed
+         */
+        void push_back (const_reference v)
+        {
+            emplace_back(v);
+        }
+
+        void push_back (value_type&& v)
+        {
+            emplace_back(std::move(v));
+        }
+
+        // -------------
+        // try_pop_front
+        // -------------
+
+        /**
+         * consumer only: move the front element into v and remove it
+         * a block the consumer finishes goes back to the producer through the cache
+         * @param v where the front element is moved to
+         * @return false if the deque was empty (v is left untouched)
+         */
+        bool try_pop_front (reference v)
+        {
+            size_type h = head.load(std::memory_order_relaxed);
+            if(h == cached_tail)
+            {
+                //the map is published before the tail that needs it, so read it after the tail
+                cached_tail = tail.load(std::memory_order_acquire);
+                if(h == cached_tail)
+                {
+                    return false;
+                }
+                consumer_map = map.load(std::memory_order_acquire);
+            }
+            pointer p = slot(consumer_map, h);
+            v = std::move(*p);
+            allocator_traits::destroy(_a, p);
+            if(((h + 1) & block_mask) == 0)
+            {
+                release_block(p - block_mask);
+            }
+            head.store(h + 1, std::memory_order_release);
+            return true;
+        }
+
+        // -----
+        // empty
+        // -----
+
+        /**
+         * exact when called by the consumer, a snapshot otherwise
+         * @return whether there are no elements
+         */
+        bool empty () const
+        {
+            return head.load(std::memory_order_acquire) == tail.load(std::memory_order_acquire);
+        }
+
+        // ----
+        // size
+        // ----
+
+        /**
+         * a snapshot: the other thread may change it at any moment
+         * @return the number of elements
+         */
+        size_type size () const
+        {
+            size_type h = head.load(std::memory_order_acquire);
+            return tail.load(std::memory_order_acquire) - h;
+        }
+
+    private:
+        // ----
+        // slot
+        // ----
+
+        /**
+         * @return the address of element i in m
+         */
+        static pointer slot (block_map* m, size_type i)
+        {
+            return m->slots[(i >> block_shift) & m->mask] + (i & block_mask);
+        }
+
+        // -------------
+        // install_block
+        // -------------
+
+        /**
+         * producer only: give block k a place in the map and memory
+         * the map holds the blocks from head's up to k; it doubles (a new ring, the old one retired)
+         * when that span no longer fits
+         */
+        void install_block (size_type k)
+        {
+            if(!producer_map || k - (cached_head >> block_shift) > producer_map->mask)
+            {
+                cached_head = head.load(std::memory_order_acquire);
+                size_type first = cached_head >> block_shift;
+                if(!producer_map || k - first > producer_map->mask)
+                {
+                    grow_map(first, k);
+                }
+            }
+            producer_map->slots[k & producer_map->mask] = acquire_block();
+        }
+
+        // --------
+        // grow_map
+        // --------
+
+        /**
+         * producer only: replace the map with one that holds blocks [first, k]
+         * the live blocks keep their addresses; only their pointers are copied
+         */
+        void grow_map (size_type first, size_type k)
+        {
+            size_type capacity = producer_map ? 2 * (producer_map->mask + 1) : 8;
+            while(capacity < k - first + 1)
+            {
+                capacity *= 2;
+            }
+            block_map* m = map_traits::allocate(_a_map, 1);
+            m->slots = outer_traits::allocate(_a_outer, capacity);
+            m->mask = capacity - 1;
+            m->retired = producer_map;
+            for(size_type j = first; j != k; ++j)
+            {
+                m->slots[j & m->mask] = producer_map->slots[j & producer_map->mask];
+            }
+            producer_map = m;
+            map.store(m, std::memory_order_release);
+        }
+
+        // -------------
+        // acquire_block
+        // -------------
+
+        /**
+         * producer only
+         * @return a block the consumer handed back, or a new one
+         */
+        pointer acquire_block ()
+        {
+            size_type h = spare_head.load(std::memory_order_relaxed);
+            if(h != spare_tail.load(std::memory_order_acquire))
+            {
+                pointer p = spare_blocks[h % spare_capacity];
+                spare_head.store(h + 1, std::memory_order_release);
+                return p;
+            }
+            return allocator_traits::allocate(_a, block_size);
+        }
+
+        // -------------
+        // release_block
+        // -------------
+
+        /**
+         * consumer only
+         * @param p a block that holds no elements, handed back if there is room and freed otherwise
+         */
+        void release_block (pointer p)
+        {
+            size_type t = spare_tail.load(std::memory_order_relaxed);
+            if(t - spare_head.load(std::memory_order_acquire) == spare_capacity)
+            {
+                allocator_traits::deallocate(_a, p, block_size);
+                return;
+            }
+            spare_blocks[t % spare_capacity] = p;
+            spare_tail.store(t + 1, std::memory_order_release);
+        }
+};
+
+template <typename T, typename A, std::size_t B>
+const std::size_t SPSCDeque<T, A, B>::block_size;
+
+template <typename T, typename A, std::size_t B>
+const std::size_t SPSCDeque<T, A, B>::block_shift;
+
+template <typename T, typename A, std::size_t B>
+const std::size_t SPSCDeque<T, A, B>::block_mask;
+
+template <typename T, typename A, std::size_t B>
+const std::size_t SPSCDeque<T, A, B>::default_block_cache_capacity;
+
+// -----------------
+// WorkStealingDeque
+// -----------------
+
+/**
+ * Chase-Lev work-stealing deque on MyDeque's block-and-map layout
+ * the owner thread calls push_back and try_pop_back; any other thread may call try_steal_front
+ * the owner never waits on other threads; thieves race for the front with one CAS on top
+ * the storage is a ring of blocks: position i lives in block (i >> block_shift) & mask, so when
+ * the ring is full it doubles by copying block pointers (the elements never move) into a new map
+ * blocks and outgrown maps stay allocated until the deque is destroyed, since a thief holding a
+ * stale index may still read them (its CAS then fails and the value is discarded)
+ * T the element type, trivially copyable (usually a task pointer); slots are std::atomic<T>
+ * A the allocator
+ * B the number of elements per block, a power of two
+ */
+template < typename T, typename A = std::allocator<T>, std::size_t B = deque_block_size<T>::value >
+class WorkStealingDeque {
+    static_assert(B != 0 && (B & (B - 1)) == 0, "WorkStealingDeque block size must be a power of two");
+    static_assert(std::is_trivially_copyable<T>::value, "WorkStealingDeque elements must be trivially copyable");
+
+    public:
+        // --------
+        // typedefs
+        // --------
+
+        typedef A                                          allocator_type;
+        typedef std::allocator_traits<allocator_type>      allocator_traits;
+        typedef typename allocator_traits::value_type      value_type;
+
+        typedef typename allocator_traits::size_type       size_type;
+        typedef typename allocator_traits::difference_type difference_type;
+
+        typedef value_type&                                reference;
+        typedef const value_type&                          const_reference;
+
+        // ----------
+        // block_size
+        // ----------
+
+        static const std::size_t block_size  = B;
+        static const std::size_t block_shift = deque_log2(B);
+        static const std::size_t block_mask  = B - 1;
+
+        // ---------------------
+        // default_block_count
+        // ---------------------
+
+        static const std::size_t default_block_count = 2;
+
+    private:
+        typedef std::atomic<value_type>                                            slot_type;
+        typedef typename allocator_traits::template rebind_alloc<slot_type>        block_allocator_type;
+        typedef std::allocator_traits<block_allocator_type>                        block_traits;
+        typedef typename block_traits::pointer                                     block_pointer;
+        typedef typename allocator_traits::template rebind_alloc<block_pointer>    outer_allocator_type;
+        typedef std::allocator_traits<outer_allocator_type>                        outer_traits;
+
+        // ---------
+        // block_map
+        // ---------
+
+        /**
+         * ring of block pointers; position i lives in slots[(i >> block_shift) & mask]
+         * a published map is never written again
+         */
+        struct block_map {
+            block_pointer* slots;
+            size_type      mask;};
+
+        typedef typename allocator_traits::template rebind_alloc<block_map>        map_allocator_type;
+        typedef std::allocator_traits<map_allocator_type>                          map_traits;
+
+        typedef MyDeque<block_pointer, outer_allocator_type>                                                block_list;
+        typedef MyDeque<block_map*, typename allocator_traits::template rebind_alloc<block_map*> >          map_list;
+
+        // ----
+        // data
+        // ----
+
+        alignas(deque_cache_line) std::atomic<difference_type> top;
+        alignas(deque_cache_line) std::atomic<difference_type> bottom;
+        std::atomic<block_map*> map;
+
+        //owner only: everything to free when the deque is destroyed
+        block_list blocks;
+        map_list   maps;
+
+        block_allocator_type _a_block;
+        outer_allocator_type _a_outer;
+        map_allocator_type   _a_map;
+
+    public:
+        // ------------
+        // constructors
+        // ------------
+
+        /**
+         * @param block_count how many blocks the ring starts with, rounded up to a power of two
+         * @param a the allocator
+         */
+        explicit WorkStealingDeque (size_type block_count = default_block_count, const allocator_type& a = allocator_type()) :
+                top(0), bottom(0), map(0),
+                blocks(a), maps(a),
+                _a_block(a), _a_outer(a), _a_map(a)
+        {
+            size_type capacity = 1;
+            while(capacity < block_count)
+            {
+                capacity *= 2;
+            }
+            map.store(make_map(0, capacity), std::memory_order_relaxed);
+        }
+
+        WorkStealingDeque (const WorkStealingDeque&) = delete;
+        WorkStealingDeque& operator = (const WorkStealingDeque&) = delete;
+
+        // ----------
+        // destructor
+        // ----------
+
+        /**
+         * no thread may be using the deque any more; the elements are trivially destructible
+         */
+        ~WorkStealingDeque ()
+        {
+            for(typename block_list::iterator b = blocks.begin(); b != blocks.end(); ++b)
+            {
+                block_traits::deallocate(_a_block, *b, block_size);
+            }
+            for(typename map_list::iterator m = maps.begin(); m != maps.end(); ++m)
+            {
+                outer_traits::deallocate(_a_outer, (*m)->slots, (*m)->mask + 1);
+                map_traits::deallocate(_a_map, *m, 1);
+            }
+        }
+
+        // ---------
+        // push_back
+        // ---------
+
+        /**
+         * owner only: add v to the back
+         * allocates only when the ring is full
+         * @param v the value to be pushed
+         */
+        void push_back (const_reference v)
+        {
+            difference_type b = bottom.load(std::memory_order_relaxed);
+            difference_type t = top.load(std::memory_order_acquire);
+            block_map* m = map.load(std::memory_order_relaxed);
+            //the block b lands in must not still hold the front
+            if((b >> block_shift) - (t >> block_shift) > static_cast<difference_type>(m->mask))
+            {
+                m = grow(m, t, b);
+            }
+            slot(m, b).store(v, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_release);
+            bottom.store(b + 1, std::memory_order_relaxed);
+        }
+
+        // ------------
+        // try_pop_back
+        // ------------
+
+        /**
+         * owner only: take the most recently pushed element
+         * only the last element is contested, and then by a single CAS
+         * @param v where the element is copied to
+         * @return false if the deque was empty or a thief took the last element
+         */
+        bool try_pop_back (reference v)
+        {
+            difference_type b = bottom.load(std::memory_order_relaxed) - 1;
+            block_map* m = map.load(std::memory_order_relaxed);
+            bottom.store(b, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            difference_type t = top.load(std::memory_order_relaxed);
+            if(t > b)
+            {
+                bottom.store(b + 1, std::memory_order_relaxed);
+                return false;
+            }
+            v = slot(m, b).load(std::memory_order_relaxed);
+            if(t < b)
+            {
+                return true;
+            }
+            //the last element: race the thieves for it
+            bool won = top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+            bottom.store(b + 1, std::memory_order_relaxed);
+            return won;
+        }
+
+        // ---------------
+        // try_steal_front
+        // ---------------
+
+        /**
+         * any thread: take the oldest element
+         * @param v where the element is copied to (also written when the steal is lost)
+         * @return false if the deque was empty or another thread took the element first
+         */
+        bool try_steal_front (reference v)
+        {
+            difference_type t = top.load(std::memory_order_acquire);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            difference_type b = bottom.load(std::memory_order_acquire);
+            if(t >= b)
+            {
+                return false;
+            }
+            block_map* m = map.load(std::memory_order_acquire);
+            v = slot(m, t).load(std::memory_order_relaxed);
+            return top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+        }
+
+        // -----
+        // empty
+        // -----
+
+        /**
+         * a snapshot: other threads may change it at any moment
+         * @return whether there are no elements
+         */
+        bool empty () const
+        {
+            return size() == 0;
+        }
+
+        // ----
+        // size
+        // ----
+
+        /**
+         * a snapshot: other threads may change it at any moment
+         * @return the number of elements
+         */
+        size_type size () const
+        {
+            difference_type b = bottom.load(std::memory_order_acquire);
+            difference_type t = top.load(std::memory_order_acquire);
+            return (b > t) ? b - t : 0;
+        }
+
+    private:
+        // ----
+        // slot
+        // ----
+
+        /**
+         * @return the slot of position i in m
+         */
+        static slot_type& slot (block_map* m, difference_type i)
+        {
+            return m->slots[static_cast<size_type>(i >> block_shift) & m->mask][i & block_mask];
+        }
+
+        // --------
+        // make_map
+        // --------
+
+        /**
+         * owner only: a map of capacity slots whose empty slots all get new blocks
+         * @param old the map being outgrown, or 0
+         * @param capacity the number of blocks, a power of two
+         * @param first the first block to carry over from old
+         * @param last one past the last block to carry over from old
+         */
+        block_map* make_map (block_map* old, size_type capacity, difference_type first = 0, difference_type last = 0)
+        {
+            block_map* m = map_traits::allocate(_a_map, 1);
+            m->slots = outer_traits::allocate(_a_outer, capacity);
+            m->mask = capacity - 1;
+            maps.push_back(m);
+            std::fill(m->slots, m->slots + capacity, block_pointer());
+            for(difference_type k = first; k != last; ++k)
+            {
+                m->slots[static_cast<size_type>(k) & m->mask] = old->slots[static_cast<size_type>(k) & old->mask];
+            }
+            for(size_type k = 0; k != capacity; ++k)
+            {
+                if(!m->slots[k])
+                {
+                    m->slots[k] = block_traits::allocate(_a_block, block_size);
+                    blocks.push_back(m->slots[k]);
+                    for(size_type i = 0; i != block_size; ++i)
+                    {
+                        block_traits::construct(_a_block, &m->slots[k][i]);
+                    }
+                }
+            }
+            return m;
+        }
+
+        // ----
+        // grow
+        // ----
+
+        /**
+         * owner only: double the ring, keeping the blocks that hold [t, b) where they are
+         * @return the new map, already published
+         */
+        block_map* grow (block_map* m, difference_type t, difference_type b)
+        {
+            size_type capacity = 2 * (m->mask + 1);
+            while(static_cast<difference_type>(capacity) <= (b >> block_shift) - (t >> block_shift))
+            {
+                capacity *= 2;
+            }
+            block_map* n = make_map(m, capacity, t >> block_shift, b >> block_shift);
+            map.store(n, std::memory_order_release);
+            return n;
+        }
+};
+
+template <typename T, typename A, std::size_t B>
+const std::size_t WorkStealingDeque<T, A, B>::block_size;
+
+template <typename T, typename A, std::size_t B>
+const std::size_t WorkStealingDeque<T, A, B>::block_shift;
+
+template <typename T, typename A, std::size_t B>
+const std::size_t WorkStealingDeque<T, A, B>::block_mask;
+
+template <typename T, typename A, std::size_t B>
+const std::size_t WorkStealingDeque<T, A, B>::default_block_count;
+
+// ---------
+// MPMCDeque
+// ---------
+
+/**
+ * bounded multi-producer/multi-consumer queue with a sequence number per slot (Vyukov's scheme)
+ * any thread may push at the back and pop at the front; a slot's sequence says whose turn it is,
+ * so producers and consumers claim positions with one CAS each and never share a lock
+ * the slots are laid out in MyDeque-sized blocks under a fixed map, allocated once up front
+ * an element whose constructor cannot throw is built in its claimed slot; one whose constructor may throw
+ * is built before the slot is claimed, so a throwing constructor leaves the deque untouched
+ * T the element type
+ * A the allocator
+ * B the number of elements per block, a power of two
+ */
+template < typename T, typename A = std::allocator<T>, std::size_t B = deque_block_size<T>::value >
+class MPMCDeque {
+    static_assert(B != 0 && (B & (B - 1)) == 0, "MPMCDeque block size must be a power of two");
+    static_assert(std::is_nothrow_move_constructible<T>::value && std::is_nothrow_move_assignable<T>::value,
+                  "MPMCDeque moves elements in and out of claimed slots, where it cannot back out");
+
+    public:
+        // --------
+        // typedefs
+        // --------
+
+        typedef A                                          allocator_type;
+        typedef std::allocator_traits<allocator_type>      allocator_traits;
+        typedef typename allocator_traits::value_type      value_type;
+
+        typedef typename allocator_traits::size_type       size_type;
+        typedef typename allocator_traits::difference_type difference_type;
+
+        typedef typename allocator_traits::pointer         pointer;
+
+        typedef value_type&                                reference;
+        typedef const value_type&                          const_reference;
+
+        // ----------
+        // block_size
+        // ----------
+
+        static const std::size_t block_size  = B;
+        static const std::size_t block_shift = deque_log2(B);
+        static const std::size_t block_mask  = B - 1;
+
+        // ----------------
+        // default_capacity
+        // ----------------
+
+        static const std::size_t default_capacity = 1024;
+
+    private:
+        // ----
+        // cell
+        // ----
+
+        /**
+         * a slot is free for the push at position p when sequence == p,
+         * and holds the element for the pop at position p when sequence == p + 1
+         */
+        struct cell {
+            std::atomic<size_type> sequence;
+            typename std::aligned_storage<sizeof(value_type), alignof(value_type)>::type storage;};
+
+        typedef typename allocator_traits::template rebind_alloc<cell>    block_allocator_type;
+        typedef std::allocator_traits<block_allocator_type>               block_traits;
+        typedef typename block_traits::pointer                            block_pointer;
+        typedef typename allocator_traits::template rebind_alloc<block_pointer> outer_allocator_type;
+        typedef std::allocator_traits<outer_allocator_type>                     outer_traits;
+
+        // ----
+        // data
+        // ----
+
+        alignas(deque_cache_line) std::atomic<size_type> head;
+        alignas(deque_cache_line) std::atomic<size_type> tail;
+
+        alignas(deque_cache_line) block_pointer* blocks;
+        size_type capacity_num;
+
+        allocator_type       _a;
+        block_allocator_type _a_block;
+        outer_allocator_type _a_outer;
+
+    public:
+        // ------------
+        // constructors
+        // ------------
+
+        /**
+         * @param capacity the most elements the deque holds, rounded up to a power of two and a whole block
+         * @param a the allocator
+         */
+        explicit MPMCDeque (size_type capacity = default_capacity, const allocator_type& a = allocator_type()) :
+                head(0), tail(0), blocks(0), capacity_num(block_size),
+                _a(a), _a_block(a), _a_outer(a)
+        {
+            while(capacity_num < capacity)
+            {
+                capacity_num *= 2;
+            }
+            size_type n = capacity_num >> block_shift;
+            blocks = outer_traits::allocate(_a_outer, n);
+            for(size_type k = 0; k != n; ++k)
+            {
+                blocks[k] = block_traits::allocate(_a_block, block_size);
+                for(size_type i = 0; i != block_size; ++i)
+                {
+                    block_traits::construct(_a_block, &blocks[k][i]);
+                    blocks[k][i].sequence.store((k << block_shift) + i, std::memory_order_relaxed);
+                }
+            }
+        }
+
+        MPMCDeque (const MPMCDeque&) = delete;
+        MPMCDeque& operator = (const MPMCDeque&) = delete;
+
+        // ----------
+        // destructor
+        // ----------
+
+        /**
+         * no thread may be using the deque any more
+         */
+        ~MPMCDeque ()
+        {
+            for(size_type i = head.load(std::memory_order_acquire); i != tail.load(std::memory_order_acquire); ++i)
+            {
+                allocator_traits::destroy(_a, element(cell_at(i)));
+            }
+            for(size_type k = 0; k != (capacity_num >> block_shift); ++k)
+            {
+                for(size_type i = 0; i != block_size; ++i)
+                {
+                    block_traits::destroy(_a_block, &blocks[k][i]);
+                }
+                block_traits::deallocate(_a_block, blocks[k], block_size);
+            }
+            outer_traits::deallocate(_a_outer, blocks, capacity_num >> block_shift);
+        }
+
+        // ----------------
+        // try_emplace_back
+        // ----------------
+
+        /**
+         * any thread: construct an element at the back unless the deque is full
+         * @param args the arguments for the element's constructor; left untouched if the deque was full,
+         * unless the constructor may throw (such an element is built before its slot is claimed)
+         * @return false if the deque was full
+         */
+        template <typename... Args>
+        bool try_emplace_back (Args&&... args)
+        {
+            return emplace_back_if_room(std::is_nothrow_constructible<value_type, Args&&...>(), std::forward<Args>(args)...);
+        }
+
+        // -------------
+        // try_push_back
+        // -------------
+
+        /**
+         * any thread: add v to the back unless the deque is full
+         * @param v the value to be pushed
+         * @return false if the deque was full
+         */
+        bool try_push_back (const_reference v)
+        {
+            return try_emplace_back(v);
+        }
+
+        /**
+         * any thread: add v to the back unless the deque is full
+         * @param v the value to be moved in; left untouched if the deque was full
+         * @return false if the deque was full
+         */
+        bool try_push_back (value_type&& v)
+        {
+            return try_emplace_back(std::move(v));
+        }
+
+        // ---------
+        // push_back
+        // ---------
+
+        /**
+         * any thread: add v to the back, waiting while the deque is full
+         * @param v the value to be pushed
+         */
+        void push_back (const_reference v)
+        {
+            value_type copy(v);
+            push_back(std::move(copy));
+        }
+
+        void push_back (value_type&& v)
+        {
+            for(size_type attempt = 0; !try_push_back(std::move(v)); ++attempt)
+            {
+                deque_backoff(attempt);
+            }
+        }
+
+        // -------------
+        // try_pop_front
+        // -------------
+
+        /**
+         * any thread: move the front element into v and remove it
+         * @param v where the front element is moved to
+         * @return false if the deque was empty (v is left untouched)
+         */
+        bool try_pop_front (reference v)
+        {
+            size_type position = head.load(std::memory_order_relaxed);
+            cell* c;
+            for(;;)
+            {
+                c = cell_at(position);
+                difference_type turn = static_cast<difference_type>(c->sequence.load(std::memory_order_acquire) - (position + 1));
+                if(turn == 0)
+                {
+                    if(head.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+                    {
+                        break;
+                    }
+                }
+                else if(turn < 0)
+                {
+                    //nothing has been pushed at this position yet
+                    return false;
+                }
+                else
+                {
+                    position = head.load(std::memory_order_relaxed);
+                }
+            }
+            pointer p = element(c);
+            v = std::move(*p);
+            allocator_traits::destroy(_a, p);
+            //free for the push one lap later
+            c->sequence.store(position + capacity_num, std::memory_order_release);
+            return true;
+        }
+
+        // ---------
+        // pop_front
+        // ---------
+
+        /**
+         * any thread: move the front element into v and remove it, waiting while the deque is empty
+         * @param v where the front element is moved to
+         */
+        void pop_front (reference v)
+        {
+            for(size_type attempt = 0; !try_pop_front(v); ++attempt)
+            {
+                deque_backoff(attempt);
+            }
+        }
+
+        // --------
+        // capacity
+        // --------
+
+        /**
+         * @return the most elements the deque can hold
+         */
+        size_type capacity () const
+        {
+            return capacity_num;
+        }
+
+        // ----
+        // size
+        // ----
+
+        /**
+         * a snapshot: other threads may change it at any moment
+         * counts claimed positions, so an element being written or read is included
+         * @return the number of elements
+         */
+        size_type size () const
+        {
+            size_type h = head.load(std::memory_order_acquire);
+            size_type t = tail.load(std::memory_order_acquire);
+            return (t > h) ? t - h : 0;
+        }
+
+        // -----
+        // empty
+        // -----
+
+        /**
+         * a snapshot: other threads may change it at any moment
+         * @return whether there are no elements
+         */
+        bool empty () const
+        {
+            return size() == 0;
+        }
+
+    private:
+        // ----------
+        // claim_back
+        // ----------
+
+        /**
+         * claim the slot at the back for one push
+         * @param position set to the claimed position
+         * @return the claimed cell, or 0 if the deque was full
+         */
+        cell* claim_back (size_type& position)
+        {
+            position = tail.load(std::memory_order_relaxed);
+            for(;;)
+            {
+                cell* c = cell_at(position);
+                difference_type turn = static_cast<difference_type>(c->sequence.load(std::memory_order_acquire) - position);
+                if(turn == 0)
+                {
+                    if(tail.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+                    {
+                        return c;
+                    }
+                }
+                else if(turn < 0)
+                {
+                    //the slot still holds the element from one lap ago
+                    return 0;
+                }
+                else
+                {
+                    position = tail.load(std::memory_order_relaxed);
+                }
+            }
+        }
+
+        // --------------------
+        // emplace_back_if_room
+        // --------------------
+
+        /**
+         * construct straight into a claimed slot: nothing can throw once it is claimed,
+         * and args are not touched if the deque is full
+         */
+        template <typename... Args>
+        bool emplace_back_if_room (std::true_type, Args&&... args)
+        {
+            size_type position;
+            cell* c = claim_back(position);
+            if(!c)
+            {
+                return false;
+            }
+            allocator_traits::construct(_a, element(c), std::forward<Args>(args)...);
+            c->sequence.store(position + 1, std::memory_order_release);
+            return true;
+        }
+
+        /**
+         * a constructor that may throw runs before a slot is claimed, since a claimed slot cannot be given back;
+         * if the deque is full, args may already have been consumed
+         */
+        template <typename... Args>
+        bool emplace_back_if_room (std::false_type, Args&&... args)
+        {
+            value_type v(std::forward<Args>(args)...);
+            return emplace_back_if_room(std::true_type(), std::move(v));
+        }
+
+        // -------
+        // cell_at
+        // -------
+
+        /**
+         * @return the cell of position i
+         */
+        cell* cell_at (size_type i) const
+        {
+            i &= capacity_num - 1;
+            return &blocks[i >> block_shift][i & block_mask];
+        }
+
+        // -------
+        // element
+        // -------
+
+        static pointer element (cell* c)
+        {
+            return reinterpret_cast<pointer>(&c->storage);
+        }
+};
+
+template <typename T, typename A, std::size_t B>
+const std::size_t MPMCDeque<T, A, B>::block_size;
+
+template <typename T, typename A, std::size_t B>
+const std::size_t MPMCDeque<T, A, B>::block_shift;
+
+template <typename T, typename A, std::size_t B>
+const std::size_t MPMCDeque<T, A, B>::block_mask;
+
+template <typename T, typename A, std::size_t B>
+const std::size_t MPMCDeque<T, A, B>::default_capacity;
+
+#endif // ConcurrentDeque_h
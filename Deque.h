@@ -4,7 +4,7 @@
 // Glenn P. Downing
 // ----------------------
 
-#ifndef Deque_
+#ifndef Deque_h
 #define Deque_h
 
 // --------
@@ -12,14 +12,22 @@
 // --------
 
 #include <algorithm> // copy, equal, lexicographical_compare, max, swap
+#include <atomic>    // atomic
 #include <cassert>   // assert
-#include <iterator>  // iterator, bidirectional_iterator_tag
-#include <memory>    // allocator
+#include <chrono>    // steady_clock
+#include <cstddef>   // size_t
+#include <cstdint>   // uint64_t
+#include <cstring>   // memcpy, memmove
+#include <iterator>  // iterator, random_access_iterator_tag, advance
+#include <memory>    // allocator, allocator_traits
 #include <stdexcept> // out_of_range
-#include <utility>   // !=, <=, >, >=
+#include <type_traits> // enable_if, integral_constant, is_integral, is_trivially_copyable, is_trivially_destructible
+#include <utility>   // !=, <=, >, >=, forward, move
 
 #include <iostream>
 
+#include "DequeSimd.h"
+
 // -----
 // using
 // -----
@@ -34,12 +42,24 @@ using std::rel_ops::operator>=;
 // -------
 
 template <typename A, typename BI>
-BI destroy (A& a, BI b, BI e) {
+BI destroy (A& a, BI b, BI e, std::false_type) {
     while (b != e) {
         --e;
-        a.destroy(&*e);}
+        std::allocator_traits<A>::destroy(a, &*e);}
+    return b;}
+
+/**
+ * trivially destructible elements need no destructor calls, so there is nothing to walk
+ */
+template <typename A, typename BI>
+BI destroy (A&, BI b, BI, std::true_type) {
     return b;}
 
+template <typename A, typename BI>
+BI destroy (A& a, BI b, BI e) {
+    typedef typename std::iterator_traits<BI>::value_type value_type;
+    return destroy(a, b, e, std::integral_constant<bool, std::is_trivially_destructible<value_type>::value>());}
+
 // ------------------
 // uninitialized_copy
 // ------------------
@@ -49,7 +69,28 @@ BI uninitialized_copy (A& a, II b, II e, BI x) {
     BI p = x;
     try {
         while (b != e) {
-            a.construct(&*x, *b);
+            std::allocator_traits<A>::construct(a, &*x, *b);
+            ++b;
+            ++x;}}
+    catch (...) {
+        destroy(a, p, x);
+        throw;}
+    return x;}
+
+// ------------------
+// uninitialized_move
+// ------------------
+
+/**
+ * move-construct [b, e) into the raw storage at x, leaving the sources moved-from
+ * if a move throws, the elements already built at x are destroyed
+ */
+template <typename A, typename II, typename BI>
+BI uninitialized_move (A& a, II b, II e, BI x) {
+    BI p = x;
+    try {
+        while (b != e) {
+            std::allocator_traits<A>::construct(a, &*x, std::move(*b));
             ++b;
             ++x;}}
     catch (...) {
@@ -66,7 +107,7 @@ BI uninitialized_fill (A& a, BI b, BI e, const U& v) {
     BI p = b;
     try {
         while (b != e) {
-            a.construct(&*b, v);
+            std::allocator_traits<A>::construct(a, &*b, v);
             ++b;}}
     catch (...) {
         destroy(a, p, b);
@@ -74,29 +115,340 @@ BI uninitialized_fill (A& a, BI b, BI e, const U& v) {
     return e;
 }
 
+// ---------------------
+// uninitialized_default
+// ---------------------
+
+/**
+ * value-initialize every element of the raw storage [b, e)
+ */
+template <typename A, typename BI>
+BI uninitialized_default (A& a, BI b, BI e) {
+    BI p = b;
+    try {
+        while (b != e) {
+            std::allocator_traits<A>::construct(a, &*b);
+            ++b;}}
+    catch (...) {
+        destroy(a, p, b);
+        throw;}
+    return e;}
+
+// ----------------
+// deque_floor_pow2
+// ----------------
+
+/**
+ * @param n a positive number
+ * @return the largest power of two that is not greater than n
+ */
+constexpr std::size_t deque_floor_pow2 (std::size_t n, std::size_t p = 1) {
+    return (p * 2 <= n && p * 2 != 0) ? deque_floor_pow2(n, p * 2) : p;}
+
+// ----------
+// deque_log2
+// ----------
+
+/**
+ * @param n a power of two
+ * @return log base 2 of n
+ */
+constexpr std::size_t deque_log2 (std::size_t n) {
+    return (n <= 1) ? 0 : 1 + deque_log2(n / 2);}
+
+// ----------------
+// deque_block_size
+// ----------------
+
+/**
+ * default number of elements per block for a MyDeque of T
+ * the largest power of two whose block still fits in block_bytes (at least one element)
+ */
+template <typename T>
+struct deque_block_size {
+    static const std::size_t block_bytes = 512;
+    static const std::size_t value       = deque_floor_pow2(sizeof(T) < block_bytes ? block_bytes / sizeof(T) : 1);};
+
+// -----------
+// deque_event
+// -----------
+
+/**
+ * what an instrumentation policy is told about
+ * deque_shift counts elements moved to open or close a gap, the rest time one operation each
+ */
+enum deque_event {
+    deque_push_back,
+    deque_push_front,
+    deque_pop_back,
+    deque_pop_front,
+    deque_insert,
+    deque_erase,
+    deque_map_rebuild,
+    deque_map_recenter,
+    deque_shift,
+    deque_event_count};
+
+// ------------------------
+// deque_no_instrumentation
+// ------------------------
+
+/**
+ * the default instrumentation policy: every hook is empty and inlines to nothing
+ * a policy provides
+ *   scope, constructed with an event at the start of an operation and destroyed at its end
+ *   record(event, n), called with the number of elements an operation shifted
+ */
+struct deque_no_instrumentation {
+    class scope {
+        public:
+            explicit scope (deque_event) {}};
+
+    static void record (deque_event, std::size_t) {}};
+
+// -------------
+// deque_tracing
+// -------------
+
+/**
+ * instrumentation policy that keeps a latency histogram per event, shared by every deque
+ * instantiated with the same Tag (use distinct tags to tell deques apart); safe across threads
+ * an insert or emplace at an end also records the push it turns into
+ */
+template <typename Tag = void>
+struct deque_tracing {
+    // ---------
+    // histogram
+    // ---------
+
+    /**
+     * bucket i counts the operations that took [2^i, 2^(i + 1)) nanoseconds (bucket 0 also takes 0)
+     */
+    struct histogram {
+        static const std::size_t bucket_count = 40;
+
+        std::atomic<std::uint64_t> buckets[bucket_count];
+        std::atomic<std::uint64_t> count;
+        std::atomic<std::uint64_t> total_ns;
+        std::atomic<std::uint64_t> units;
+
+        void add (std::uint64_t ns) {
+            std::size_t i = 0;
+            while (i + 1 < bucket_count && (ns >> (i + 1)))
+                ++i;
+            buckets[i].fetch_add(1, std::memory_order_relaxed);
+            count.fetch_add(1, std::memory_order_relaxed);
+            total_ns.fetch_add(ns, std::memory_order_relaxed);}
+
+        /**
+         * @param q a fraction in (0, 1]
+         * @return an upper bound on the q-quantile latency in nanoseconds (0 if nothing was recorded)
+         */
+        std::uint64_t quantile (double q) const {
+            std::uint64_t n = count.load(std::memory_order_relaxed);
+            std::uint64_t seen = 0;
+            for (std::size_t i = 0; i != bucket_count; ++i) {
+                seen += buckets[i].load(std::memory_order_relaxed);
+                if (n && seen >= q * n)
+                    return (std::uint64_t(2) << i) - 1;}
+            return 0;}
+
+        /**
+         * @return the mean latency in nanoseconds
+         */
+        double mean () const {
+            std::uint64_t n = count.load(std::memory_order_relaxed);
+            return n ? static_cast<double>(total_ns.load(std::memory_order_relaxed)) / n : 0.0;}
+
+        void reset () {
+            for (std::size_t i = 0; i != bucket_count; ++i)
+                buckets[i].store(0, std::memory_order_relaxed);
+            count.store(0, std::memory_order_relaxed);
+            total_ns.store(0, std::memory_order_relaxed);
+            units.store(0, std::memory_order_relaxed);}};
+
+    // -----
+    // scope
+    // -----
+
+    class scope {
+        public:
+            explicit scope (deque_event e) :
+                    event(e),
+                    start(std::chrono::steady_clock::now())
+            {}
+
+            ~scope () {
+                std::chrono::steady_clock::duration d = std::chrono::steady_clock::now() - start;
+                latency(event).add(std::chrono::duration_cast<std::chrono::nanoseconds>(d).count());}
+
+        private:
+            deque_event event;
+            std::chrono::steady_clock::time_point start;};
+
+    // ------
+    // record
+    // ------
+
+    static void record (deque_event e, std::size_t n) {
+        latency(e).units.fetch_add(n, std::memory_order_relaxed);}
+
+    // -------
+    // latency
+    // -------
+
+    /**
+     * @return the histogram of e; for deque_shift only units (elements moved) is filled in
+     */
+    static histogram& latency (deque_event e) {
+        static histogram histograms[deque_event_count];
+        return histograms[e];}
+
+    // -----
+    // reset
+    // -----
+
+    static void reset () {
+        for (std::size_t e = 0; e != deque_event_count; ++e)
+            latency(static_cast<deque_event>(e)).reset();}};
 
 // -------
 // MyDeque
 // -------
 
-template < typename T, typename A = std::allocator<T> >
+/**
+ * T the element type
+ * A the allocator
+ * B the number of elements per block, must be a power of two so that
+ *   indexing compiles to shifts and masks
+ * P the instrumentation policy (deque_no_instrumentation, deque_tracing or one of the same shape)
+ */
+template < typename T, typename A = std::allocator<T>, std::size_t B = deque_block_size<T>::value, typename P = deque_no_instrumentation >
 class MyDeque {
+    static_assert(B != 0 && (B & (B - 1)) == 0, "MyDeque block size must be a power of two");
+
     public:
         // --------
         // typedefs
         // --------
 
-        typedef A                                        allocator_type;
-        typedef typename allocator_type::value_type      value_type;
+        typedef A                                          allocator_type;
+        typedef std::allocator_traits<allocator_type>      allocator_traits;
+        typedef typename allocator_traits::value_type      value_type;
+
+        typedef typename allocator_traits::size_type       size_type;
+        typedef typename allocator_traits::difference_type difference_type;
+
+        typedef typename allocator_traits::pointer         pointer;
+        typedef typename allocator_traits::const_pointer   const_pointer;
+
+        typedef value_type&                                reference;
+        typedef const value_type&                          const_reference;
+
+        typedef P                                          instrumentation_policy;
+
+        // ----------
+        // block_size
+        // ----------
+
+        static const std::size_t block_size  = B;
+        static const std::size_t block_shift = deque_log2(B);
+        static const std::size_t block_mask  = B - 1;
+
+        // ----------------------------
+        // default_block_cache_capacity
+        // ----------------------------
+
+        static const std::size_t default_block_cache_capacity = 4;
+
+        // -----------------
+        // trim_slack_blocks
+        // -----------------
+
+        /**
+         * the empty map slots past the used blocks that automatic trimming leaves alone
+         */
+        static const std::size_t trim_slack_blocks = 16;
+
+        // ----------------
+        // block_cache_stats
+        // ----------------
+
+        /**
+         * how often a block needed by one end came from the spare-block cache
+         */
+        struct block_cache_stats {
+            size_type hits;
+            size_type misses;
+
+            /**
+             * @return the fraction of block requests served by the cache
+             */
+            double hit_rate () const {
+                return (hits + misses) ? static_cast<double>(hits) / (hits + misses) : 0.0;}};
+
+        // ------------
+        // memory_stats
+        // ------------
+
+        /**
+         * what a deque holds right now, and how often it has gone to the allocator
+         * the counters follow the storage: they move and swap with it and start at 0 in a copy
+         */
+        struct memory_stats {
+            size_type size;              //elements
+            size_type blocks;            //allocated blocks in the map, in use or reserved
+            size_type cached_blocks;     //blocks in the spare-block cache
+            size_type map_capacity;      //slots in the map
+            size_type front_capacity;    //elements that fit before begin without a new map
+            size_type back_capacity;     //elements that fit after end without a new map
+            size_type bytes;             //blocks, cache and map, not counting the deque object itself
+            size_type block_allocations; //blocks taken from the allocator
+            size_type block_frees;       //blocks given back to the allocator
+            size_type map_rebuilds;      //maps allocated to grow or shrink
+            size_type map_recenters;     //times the used span was recentered in place instead
+
+            /**
+             * @return the fraction of the allocated element slots that hold elements
+             */
+            double occupancy () const {
+                return blocks ? static_cast<double>(size) / (blocks * block_size) : 0.0;}};
+
+    private:
+        // ------------
+        // block_offset
+        // ------------
 
-        typedef typename allocator_type::size_type       size_type;
-        typedef typename allocator_type::difference_type difference_type;
+        /**
+         * @param index the position within a block, possibly outside [0, block_size)
+         * @return the number of whole blocks to move so that index lands in a block (floored)
+         */
+        static difference_type block_offset (difference_type index) {
+            return (index >= 0) ? (index >> block_shift) : -((-index - 1) >> block_shift) - 1;}
 
-        typedef typename allocator_type::pointer         pointer;
-        typedef typename allocator_type::const_pointer   const_pointer;
+        // -------------
+        // segment_order
+        // -------------
 
-        typedef typename allocator_type::reference       reference;
-        typedef typename allocator_type::const_reference const_reference;
+        /**
+         * compare [p, q) with the span at r lexicographically
+         * @return negative, zero or positive as [p, q) orders before, equivalent to or after r's span
+         */
+        static int segment_order (const value_type* p, const value_type* q, const value_type* r, std::false_type) {
+            //< both ways, as lexicographical_compare does: == may disagree with < (NaN, key-only orderings)
+            for (; p != q; ++p, ++r) {
+                if (*p < *r)
+                    return -1;
+                if (*r < *p)
+                    return 1;}
+            return 0;}
+
+        static int segment_order (const value_type* p, const value_type* q, const value_type* r, std::true_type) {
+            //integers are equal exactly when neither is less, so the vector mismatch finds the deciding pair
+            const value_type* m = deque_mismatch(p, q, r);
+            if (m == q)
+                return 0;
+            return (*m < r[m - p]) ? -1 : 1;}
 
     public:
         // -----------
@@ -111,7 +463,7 @@ class MyDeque {
          */
         friend bool operator == (const MyDeque& lhs, const MyDeque& rhs) {
 
-            return (lhs.size() == rhs.size()) && std::equal(lhs.begin(), lhs.end(), rhs.begin());
+            return (lhs.size() == rhs.size()) && equal(lhs.begin(), lhs.end(), rhs.begin());
         }
 
         // ----------
@@ -125,12 +477,24 @@ class MyDeque {
          * @return whether the lhs is smaller than rhs
          */
         friend bool operator < (const MyDeque& lhs, const MyDeque& rhs) {
-            return std::lexicographical_compare(lhs.begin(), lhs.end(), rhs.begin(), rhs.end());
+            //compare the common prefix a block segment at a time, then fall back on the sizes
+            const_iterator lhs_end = lhs.begin() + std::min(lhs.size(), rhs.size());
+            int order = 0;
+            walk_segments(lhs.begin(), lhs_end, rhs.begin(), [&order] (const value_type* p, const value_type* q, const value_type* r) -> bool {
+                order = segment_order(p, q, r, std::is_integral<value_type>());
+                return order == 0;});
+            if(order)
+            {
+                return order < 0;
+            }
+            return lhs.size() < rhs.size();
         }
 
 
 
         public:
+        class const_iterator;
+
         // --------
         // iterator
         // --------
@@ -141,7 +505,7 @@ class MyDeque {
                 // typedefs
                 // --------
 
-                typedef std::bidirectional_iterator_tag   iterator_category;
+                typedef std::random_access_iterator_tag   iterator_category;
                 typedef typename MyDeque::value_type      value_type;
                 typedef typename MyDeque::difference_type difference_type;
                 typedef typename MyDeque::pointer         pointer;
@@ -186,6 +550,16 @@ class MyDeque {
                     return lhs += rhs;
                 }
 
+                /**
+                 * +operator for number and iterator
+                 * @param lhs integral type to change the position of the iterator
+                 * @param rhs an iterator
+                 * @return rhs + lhs
+                 */
+                friend iterator operator + (difference_type lhs, iterator rhs) {
+                    return rhs += lhs;
+                }
+
                 // ----------
                 // operator -
                 // ----------
@@ -199,6 +573,129 @@ class MyDeque {
                 friend iterator operator - (iterator lhs, difference_type rhs) {
                     return lhs -= rhs;}
 
+                /**
+                 * -operator between two iterators, computed from their blocks in O(1)
+                 * @param lhs an iterator
+                 * @param rhs an iterator into the same deque
+                 * @return the number of elements from rhs to lhs
+                 */
+                friend difference_type operator - (const iterator& lhs, const iterator& rhs) {
+                    return (lhs.current_block - rhs.current_block) * static_cast<difference_type>(block_size)
+                         + static_cast<difference_type>(lhs.current_block_index) - static_cast<difference_type>(rhs.current_block_index);}
+
+                // ----------
+                // operator <
+                // ----------
+
+                /**
+                 * <operator
+                 * @param lhs an iterator
+                 * @param rhs an iterator into the same deque
+                 * @return whether lhs comes before rhs
+                 */
+                friend bool operator < (const iterator& lhs, const iterator& rhs) {
+                    return (lhs.current_block < rhs.current_block) ||
+                           (lhs.current_block == rhs.current_block && lhs.current_block_index < rhs.current_block_index);}
+
+                friend bool operator > (const iterator& lhs, const iterator& rhs) {
+                    return rhs < lhs;}
+
+                friend bool operator <= (const iterator& lhs, const iterator& rhs) {
+                    return !(rhs < lhs);}
+
+                friend bool operator >= (const iterator& lhs, const iterator& rhs) {
+                    return !(lhs < rhs);}
+
+                // ---------
+                // segmented
+                // ---------
+
+                /**
+                 * call f(p, q) for every contiguous span [p, q) of [b, e), one per block
+                 * @return f
+                 */
+                template <typename F>
+                friend F for_each_segment (iterator b, iterator e, F f) {
+                    return MyDeque::segmented_for_each_segment(b, e, f);}
+
+                /**
+                 * for_each over [b, e) with a tight loop per block
+                 * @return f
+                 */
+                template <typename F>
+                friend F for_each (iterator b, iterator e, F f) {
+                    return MyDeque::segmented_for_each(b, e, f);}
+
+                /**
+                 * find over [b, e) with a tight loop per block
+                 * @return an iterator to the first element equal to v, or e
+                 */
+                template <typename U>
+                friend iterator find (iterator b, iterator e, const U& v) {
+                    return MyDeque::segmented_find(b, e, v);}
+
+                /**
+                 * fill [b, e) with copies of v a block at a time
+                 */
+                friend void fill (iterator b, iterator e, const value_type& v) {
+                    MyDeque::segmented_fill(b, e, v);}
+
+                /**
+                 * copy [b, e) to x a block at a time
+                 * @return the end of the copied range
+                 */
+                template <typename O>
+                friend O copy (iterator b, iterator e, O x) {
+                    return MyDeque::segmented_copy(b, e, x);}
+
+                friend iterator copy (iterator b, iterator e, iterator x) {
+                    return MyDeque::segmented_copy(b, e, x);}
+
+                /**
+                 * equal over [b, e) and the range at x, a block at a time
+                 * @return whether every element of [b, e) equals its counterpart at x
+                 */
+                template <typename I>
+                friend bool equal (iterator b, iterator e, I x) {
+                    return MyDeque::segmented_equal(b, e, x);}
+
+                friend bool equal (iterator b, iterator e, iterator x) {
+                    return MyDeque::segmented_equal(b, e, x);}
+
+                friend bool equal (iterator b, iterator e, const_iterator x) {
+                    return MyDeque::segmented_equal(b, e, x);}
+
+                /**
+                 * count over [b, e) a block at a time
+                 * @return the number of elements equal to v
+                 */
+                template <typename U>
+                friend difference_type count (iterator b, iterator e, const U& v) {
+                    return MyDeque::segmented_count(b, e, v);}
+
+                /**
+                 * min_element over [b, e) a block at a time
+                 * @return an iterator to the first smallest element, or e
+                 */
+                friend iterator min_element (iterator b, iterator e) {
+                    return MyDeque::segmented_min_element(b, e);}
+
+                /**
+                 * max_element over [b, e) a block at a time
+                 * @return an iterator to the first largest element, or e
+                 */
+                friend iterator max_element (iterator b, iterator e) {
+                    return MyDeque::segmented_max_element(b, e);}
+
+                /**
+                 * reduce over [b, e) a block at a time; like std::reduce the additions may be
+                 * regrouped, so a floating-point result can differ from accumulate's
+                 * @return init plus every element
+                 */
+                template <typename U>
+                friend U reduce (iterator b, iterator e, U init) {
+                    return MyDeque::segmented_reduce(b, e, init);}
+
             private:
                 // ----
                 // data
@@ -277,6 +774,20 @@ class MyDeque {
                     return &**this;
                 }
 
+                // -----------
+                // operator []
+                // -----------
+
+                /**
+                 * subscript operator
+                 * @param n the offset from the iterator
+                 * @return a reference to the element n positions away
+                 */
+                reference operator [] (difference_type n) const 
+                {
+                    return *(*this + n);
+                }
+
                 // -----------
                 // operator ++
                 // -----------
@@ -353,22 +864,10 @@ class MyDeque {
                  */
                 iterator& operator += (difference_type d) 
                 {
-                    
-                    //wrap around blocks
-                    current_block += d / block_size;
-
-                    int index_inc = d % block_size;
-                    //warp around an additional block if necessary
-                    if((current_block_index + index_inc) >= block_size)
-                    {
-                        current_block_index = (current_block_index + index_inc) % block_size;
-                        ++current_block;
-                    }
-                    else
-                    {
-                        current_block_index += index_inc;
-                    }
-                    
+                    //move by whole blocks with a shift, then mask the index within the block
+                    difference_type index = static_cast<difference_type>(current_block_index) + d;
+                    current_block += block_offset(index);
+                    current_block_index = static_cast<std::size_t>(index) & block_mask;
 
                     assert(valid());
                     return *this;
@@ -385,22 +884,7 @@ class MyDeque {
                  */
                 iterator& operator -= (difference_type d) 
                 {
-                    //wrap around blocks
-                    current_block -= d / block_size;
-
-                    int index_dec = d % block_size;
-                    //warp around an additional block if necessary
-                    if((current_block_index - index_dec) > current_block_index)
-                    {
-                        current_block_index = block_size - (index_dec - current_block_index);
-                        --current_block;
-                    }
-                    else
-                    {
-                        current_block_index -= index_dec;
-                    }
-                    assert(valid());
-                    return *this;
+                    return *this += -d;
                 }
 
                 // -----------
@@ -458,7 +942,7 @@ class MyDeque {
                 // typedefs
                 // --------
 
-                typedef std::bidirectional_iterator_tag   iterator_category;
+                typedef std::random_access_iterator_tag   iterator_category;
                 typedef typename MyDeque::value_type      value_type;
                 typedef typename MyDeque::difference_type difference_type;
                 typedef typename MyDeque::const_pointer   pointer;
@@ -505,6 +989,15 @@ class MyDeque {
                 friend const_iterator operator + (const_iterator lhs, difference_type rhs) {
                     return lhs += rhs;}
 
+                /**
+                 * + Operator
+                 * @param lhs integral type to change the position of the iterator
+                 * @param rhs constant iterator
+                 * @return const_iterator with new position after addition
+                 */
+                friend const_iterator operator + (difference_type lhs, const_iterator rhs) {
+                    return rhs += lhs;}
+
                 // ----------
                 // operator -
                 // ----------
@@ -518,6 +1011,123 @@ class MyDeque {
                 friend const_iterator operator - (const_iterator lhs, difference_type rhs) {
                     return lhs -= rhs;}
 
+                /**
+                 * -operator between two iterators, computed from their blocks in O(1)
+                 * @param lhs an iterator
+                 * @param rhs an iterator into the same deque
+                 * @return the number of elements from rhs to lhs
+                 */
+                friend difference_type operator - (const const_iterator& lhs, const const_iterator& rhs) {
+                    return (lhs.current_block - rhs.current_block) * static_cast<difference_type>(block_size)
+                         + static_cast<difference_type>(lhs.current_block_index) - static_cast<difference_type>(rhs.current_block_index);}
+
+                // ----------
+                // operator <
+                // ----------
+
+                /**
+                 * <operator
+                 * @param lhs an iterator
+                 * @param rhs an iterator into the same deque
+                 * @return whether lhs comes before rhs
+                 */
+                friend bool operator < (const const_iterator& lhs, const const_iterator& rhs) {
+                    return (lhs.current_block < rhs.current_block) ||
+                           (lhs.current_block == rhs.current_block && lhs.current_block_index < rhs.current_block_index);}
+
+                friend bool operator > (const const_iterator& lhs, const const_iterator& rhs) {
+                    return rhs < lhs;}
+
+                friend bool operator <= (const const_iterator& lhs, const const_iterator& rhs) {
+                    return !(rhs < lhs);}
+
+                friend bool operator >= (const const_iterator& lhs, const const_iterator& rhs) {
+                    return !(lhs < rhs);}
+
+                // ---------
+                // segmented
+                // ---------
+
+                /**
+                 * call f(p, q) for every contiguous span [p, q) of [b, e), one per block
+                 * @return f
+                 */
+                template <typename F>
+                friend F for_each_segment (const_iterator b, const_iterator e, F f) {
+                    return MyDeque::segmented_for_each_segment(b, e, f);}
+
+                /**
+                 * for_each over [b, e) with a tight loop per block
+                 * @return f
+                 */
+                template <typename F>
+                friend F for_each (const_iterator b, const_iterator e, F f) {
+                    return MyDeque::segmented_for_each(b, e, f);}
+
+                /**
+                 * find over [b, e) with a tight loop per block
+                 * @return an iterator to the first element equal to v, or e
+                 */
+                template <typename U>
+                friend const_iterator find (const_iterator b, const_iterator e, const U& v) {
+                    return MyDeque::segmented_find(b, e, v);}
+
+                /**
+                 * copy [b, e) to x a block at a time
+                 * @return the end of the copied range
+                 */
+                template <typename O>
+                friend O copy (const_iterator b, const_iterator e, O x) {
+                    return MyDeque::segmented_copy(b, e, x);}
+
+                friend iterator copy (const_iterator b, const_iterator e, iterator x) {
+                    return MyDeque::segmented_copy(b, e, x);}
+
+                /**
+                 * equal over [b, e) and the range at x, a block at a time
+                 * @return whether every element of [b, e) equals its counterpart at x
+                 */
+                template <typename I>
+                friend bool equal (const_iterator b, const_iterator e, I x) {
+                    return MyDeque::segmented_equal(b, e, x);}
+
+                friend bool equal (const_iterator b, const_iterator e, iterator x) {
+                    return MyDeque::segmented_equal(b, e, x);}
+
+                friend bool equal (const_iterator b, const_iterator e, const_iterator x) {
+                    return MyDeque::segmented_equal(b, e, x);}
+
+                /**
+                 * count over [b, e) a block at a time
+                 * @return the number of elements equal to v
+                 */
+                template <typename U>
+                friend difference_type count (const_iterator b, const_iterator e, const U& v) {
+                    return MyDeque::segmented_count(b, e, v);}
+
+                /**
+                 * min_element over [b, e) a block at a time
+                 * @return an iterator to the first smallest element, or e
+                 */
+                friend const_iterator min_element (const_iterator b, const_iterator e) {
+                    return MyDeque::segmented_min_element(b, e);}
+
+                /**
+                 * max_element over [b, e) a block at a time
+                 * @return an iterator to the first largest element, or e
+                 */
+                friend const_iterator max_element (const_iterator b, const_iterator e) {
+                    return MyDeque::segmented_max_element(b, e);}
+
+                /**
+                 * reduce over [b, e) a block at a time; like std::reduce the additions may be
+                 * regrouped, so a floating-point result can differ from accumulate's
+                 * @return init plus every element
+                 */
+                template <typename U>
+                friend U reduce (const_iterator b, const_iterator e, U init) {
+                    return MyDeque::segmented_reduce(b, e, init);}
+
             private:
                 // ----
                 // data
@@ -547,7 +1157,7 @@ class MyDeque {
                  */
                 const_iterator () 
                 {
-                    current_block  = static_cast<const_pointer>(0);
+                    current_block  = static_cast<pointer*>(0);
                     current_block_index = 0;
                     assert(valid());
                 }
@@ -600,6 +1210,18 @@ class MyDeque {
                 pointer operator -> () const {
                     return &**this;}
 
+                // -----------
+                // operator []
+                // -----------
+
+                /**
+                 * subscript operator
+                 * @param n the offset from the iterator
+                 * @return a constant reference to the element n positions away
+                 */
+                reference operator [] (difference_type n) const {
+                    return *(*this + n);}
+
                 // -----------
                 // operator ++
                 // -----------
@@ -669,23 +1291,13 @@ class MyDeque {
                  * @return constant reference of the iterator after incrementation
                  */
                 const_iterator& operator += (difference_type d) {
-                    //wrap around blocks
-                    current_block += d / block_size;
-
-                    int index_inc = d % block_size;
-                    //warp around an additional block if necessary
-                    if((current_block_index + index_inc) >= block_size)
-                    {
-                        current_block_index = (current_block_index + index_inc) % block_size;
-                        ++current_block;
-                    }
-                    else
-                    {
-                        current_block_index += index_inc;
-                    }
+                    //move by whole blocks with a shift, then mask the index within the block
+                    difference_type index = static_cast<difference_type>(current_block_index) + d;
+                    current_block += block_offset(index);
+                    current_block_index = static_cast<std::size_t>(index) & block_mask;
 
                     assert(valid());
-                    return const_cast<iterator&>(*this);
+                    return *this;
                 }
 
                 // -----------
@@ -698,23 +1310,7 @@ class MyDeque {
                  * @return constant reference of the iterator after decrementation
                  */
                 const_iterator& operator -= (difference_type d) {
-                    //wrap around blocks
-                    current_block -= d / block_size;
-
-                    int index_dec = d % block_size;
-                    //warp around an additional block if necessary
-                    if((current_block_index - index_dec) > current_block_index)
-                    {
-                        current_block_index = block_size - (index_dec - current_block_index);
-                        --current_block;
-                    }
-                    else
-                    {
-                        current_block_index -= index_dec;
-                    }
-                    assert(valid());
-                    return const_cast<iterator&>(*this);}
-
+                    return *this += -d;}
 
                 // -----------
                 // get_block_address
@@ -748,14 +1344,25 @@ class MyDeque {
             // data
             // ----
 
+            typedef typename allocator_traits::template rebind_alloc<pointer> outer_allocator_type;
+            typedef std::allocator_traits<outer_allocator_type>            outer_traits;
+
             allocator_type _a;
-            typename allocator_type::template rebind<pointer>::other _a_outer;
+            outer_allocator_type _a_outer;
             pointer* first_block;
             pointer* last_block;
             iterator begin_iterator; 
             iterator end_iterator;
             size_type size_num;
-            static std::size_t block_size;
+            pointer* spare_blocks;        //retired blocks kept for reuse, allocated through _a_outer
+            size_type spare_num;
+            size_type spare_capacity;
+            size_type spare_hits;
+            size_type spare_misses;
+            double trim_occupancy;        //shrink_to_fit once size drops below this fraction of the map's room
+            size_type block_frees;
+            size_type map_rebuilds;
+            size_type map_recenters;
 
              private:
             // -----
@@ -777,90 +1384,128 @@ class MyDeque {
         /**
          * @param a the allocator the deque used
          * default constructor or constructor that takes in an allocator
+         * no map or block is allocated until the first element is added
          */
-        explicit MyDeque (const allocator_type& a = allocator_type()) : _a(a)
+        explicit MyDeque (const allocator_type& a = allocator_type()) :
+                _a(a),
+                _a_outer(a),
+                first_block(0),
+                last_block(0),
+                begin_iterator(0, 0),
+                end_iterator(0, 0),
+                size_num(0),
+                spare_blocks(0),
+                spare_num(0),
+                spare_capacity(default_block_cache_capacity),
+                spare_hits(0),
+                spare_misses(0),
+                trim_occupancy(0),
+                block_frees(0),
+                map_rebuilds(0),
+                map_recenters(0)
         {
-            size_num = 0;
-
-            //allocate outer array
-            first_block = _a_outer.allocate(5);
-
-            //allocate inner array
-            for(int i = 0; i < 5; ++i)
-            {
-                *(first_block + i) = _a.allocate(block_size);
-            }
+            assert(valid());
+        }
 
-            last_block = first_block + 5;
-            begin_iterator = iterator(first_block + 2, 5);
-            end_iterator = iterator(first_block + 2, 5);
+        /**
+         * size constructor that optionally takes in an allocator
+         * @param s the number of value-initialized elements
+         */
+        explicit MyDeque (size_type s, const allocator_type& a = allocator_type()) :
+                MyDeque(a)
+        {
+            reserve_map_back(s);
+            end_iterator = uninitialized_default(_a, end_iterator, end_iterator + s);
+            size_num = s;
 
+            assert(valid());
         }
 
         /**
          * fill constructor that optionally takes in an allocator
          * @param s the number of elements
+         * @param v the value to copy into every element
          */
-        explicit MyDeque (size_type s, const_reference v = value_type(), const allocator_type& a = allocator_type()) : _a(a)
+        MyDeque (size_type s, const_reference v, const allocator_type& a = allocator_type()) :
+                MyDeque(a)
         {
+            reserve_map_back(s);
+            end_iterator = uninitialized_fill(_a, end_iterator, end_iterator + s, v);
             size_num = s;
 
-            std::size_t block_num = s / 10 + 1;
-
-            //allocate outer array
-            first_block = _a_outer.allocate(block_num);
-
-            //allocate inner array
-            for(std::size_t i = 0; i < block_num; ++i)
-            {
-                *(first_block + i) = _a.allocate(block_size);
-            }
-
-            last_block = first_block + block_num;
+            assert(valid());
+        }
 
-            begin_iterator = iterator(first_block + block_num / 2, 5);
-            end_iterator = iterator(first_block + block_num / 2, 5);
-
-            //middle load to contruct the elements
-            for(std::size_t i = 0; i < s / 2; ++i)
-            {   
-
-                _a.construct(&(*(--begin_iterator)), v);
-                _a.construct(&*end_iterator, v);
-                ++end_iterator;
-            }
+        /**
+         * range constructor that optionally takes in an allocator
+         * @param b the beginning of the elements to copy
+         * @param e the end of the elements to copy
+         */
+        template <typename II, typename = typename std::enable_if<!std::is_integral<II>::value>::type>
+        MyDeque (II b, II e, const allocator_type& a = allocator_type()) :
+                MyDeque(a)
+        {
+            insert(end_iterator, b, e);
+            assert(valid());
+        }
 
+        /**
+         * copy constructor
+         * only the blocks that hold elements of that are allocated
+         * @param that MyDeque to be get copied
+         */
+        MyDeque (const MyDeque& that) :
+                MyDeque(that, allocator_traits::select_on_container_copy_construction(that._a))
+        {}
 
-            //if size is odd, add a single element at the beginning
-            if(s % 2 == 1)
-            {
-                _a.construct(&*(--begin_iterator), v);
-            }
+        /**
+         * allocator-extended copy constructor
+         * @param that MyDeque to be get copied
+         * @param a the allocator for the copy
+         */
+        MyDeque (const MyDeque& that, const allocator_type& a) :
+                MyDeque(a)
+        {
+            spare_capacity = that.spare_capacity;
+            trim_occupancy = that.trim_occupancy;
+            reserve_map_back(that.size_num);
+            end_iterator = uninitialized_copy_blocks(that.begin(), that.end(), end_iterator);
+            size_num = that.size_num;
 
             assert(valid());
         }
 
         /**
-         * copy constructor
-         * @param that MyDeque to be get copied
+         * move constructor
+         * takes over the map and blocks of that, which is left empty
+         * @param that MyDeque to be moved from
          */
-        MyDeque (const MyDeque& that) 
+        MyDeque (MyDeque&& that) :
+                MyDeque(std::move(that._a))
         {
-            int block_num = that.last_block - that.first_block;
-            size_num = that.size();
+            swap_storage(that);
+            assert(valid());
+        }
 
-            //allocate memory
-            first_block = _a_outer.allocate(block_num);
-            last_block = first_block + block_num;
-            for(int i = 0; i < (block_num); ++i)
+        /**
+         * allocator-extended move constructor
+         * takes over the storage of that when a can free it, and moves the elements one by one otherwise
+         * @param that MyDeque to be moved from
+         * @param a the allocator for the new deque
+         */
+        MyDeque (MyDeque&& that, const allocator_type& a) :
+                MyDeque(a)
+        {
+            if(_a == that._a)
             {
-                *(first_block + i) = _a.allocate(block_size); 
+                swap_storage(that);
+            }
+            else
+            {
+                spare_capacity = that.spare_capacity;
+                trim_occupancy = that.trim_occupancy;
+                insert(end_iterator, std::make_move_iterator(that.begin()), std::make_move_iterator(that.end()));
             }
-
-            //find the position of begin
-            begin_iterator = iterator(first_block + (that.begin_iterator.get_block_address() - that.first_block), that.begin_iterator.get_block_index());
-
-            end_iterator = uninitialized_copy(_a, that.begin_iterator, that.end_iterator, begin_iterator);
             assert(valid());
         }
 
@@ -875,16 +1520,7 @@ class MyDeque {
         {
             //destroy all elements
             destroy(_a, begin_iterator, end_iterator);
-
-            //deallocate inner arrays
-            for(pointer* current = first_block; current != last_block; ++current)
-            {
-                _a.deallocate(*current, block_size);
-            }
-            //dellocate outer arrays
-            _a_outer.deallocate(first_block, last_block - first_block);
-
-            assert(valid());
+            deallocate_map();
         }
 
         // ----------
@@ -902,75 +1538,79 @@ class MyDeque {
             {
                 return *this;
             }
-            if(size_num >= that.size_num) //if there are enough space, no reallocation is needed
+            copy_assign_allocator(that, typename allocator_traits::propagate_on_container_copy_assignment());
+            if(size_num >= that.size_num) //if there are enough elements, assign over them and drop the excess
             {
-                iterator new_begin = begin_iterator + (size_num / 2);
-                iterator new_end = end_iterator - (size_num / 2);
-                if(size_num % 2 == 1)
-                {
-                    --end_iterator;
-                }
-
-                //copy element from that
-                std::size_t element_offset = that.size_num / 2;
-                new_begin -= element_offset;
-                new_end += element_offset;
-                //get new_begin to the next position if size of that is even
-                if(that.size_num % 2 == 1)
-                {
-                    ++new_end;
-                }
-                //destroy excess elements if size of the old deque is larger than that of the new one and copy the elements
-                destroy(_a, begin_iterator, new_begin );
-                destroy(_a, new_end, end_iterator);
-
-                begin_iterator = new_begin;
-                end_iterator = new_end;
-
-                //copy elements
-                iterator that_current = that.begin_iterator;
-                iterator current = begin_iterator;
-                while(that_current != that.end_iterator)
-                {
-                    *current = *that_current;
-                    ++that_current;
-                    ++current;
-                }
+                truncate(copy_blocks(that.begin(), that.end(), begin_iterator));
             }
-            else //reallocation is needed
+            else //assign over the existing elements and append the rest
             {
-                //destroy all elements
-                destroy(_a, begin_iterator, end_iterator);
-
-                //deallocate inner arrays
-                for(pointer* current = first_block; current != last_block; ++current)
-                {
-                    _a.deallocate(*current, block_size);
-                }
-                //dellocate outer arrays
-                _a_outer.deallocate(first_block, last_block - first_block);
+                const_iterator that_current = that.begin() + size_num;
+                copy_blocks(that.begin(), that_current, begin_iterator);
+                reserve_map_back(that.size_num - size_num);
+                end_iterator = uninitialized_copy_blocks(that_current, that.end(), end_iterator);
+            }
 
-                int block_num = that.last_block - that.first_block;
-                size_num = that.size();
+            size_num = that.size_num;
+            assert(valid());
+            return *this;}
 
-                //allocate memory
-                first_block = _a_outer.allocate(block_num);
-                last_block = first_block + block_num;
-                for(int i = 0; i < (block_num); ++i)
-                {
-                    *(first_block + i) = _a.allocate(block_size); 
-                }
+        /**
+         * move = operator
+         * frees the elements of this and takes over those of that, which is left empty
+         * if the allocator does not propagate and the two differ, the elements are moved one by one instead
+         * @param that MyDeque to be moved from
+         * @return this MyDeque
+         */
+        MyDeque& operator = (MyDeque&& that) 
+        {
+            if (this != &that)
+            {
+                move_assign(that, typename allocator_traits::propagate_on_container_move_assignment());
+            }
+            assert(valid());
+            return *this;}
 
-                //find the position of begin
-                begin_iterator = iterator(first_block + (that.begin_iterator.get_block_address() - that.first_block), that.begin_iterator.get_block_index());
+        // ------
+        // assign
+        // ------
 
-                end_iterator = uninitialized_copy(_a, that.begin_iterator, that.end_iterator, begin_iterator);
+        /**
+         * assign (replace the contents with n copies of v)
+         * @param n the new size
+         * @param v the value to copy
+         */
+        void assign (size_type n, const_reference v)
+        {
+            //v may be an element of this deque
+            value_type copy(v);
+            assign(repeat_iterator(&copy, 0), repeat_iterator(&copy, n));
+        }
 
+        /**
+         * assign (replace the contents with [b, e))
+         * assigns over the existing elements, then drops the excess or appends the rest at once
+         * @param b the beginning of the new elements
+         * @param e the end of the new elements
+         */
+        template <typename II, typename = typename std::enable_if<!std::is_integral<II>::value>::type>
+        void assign (II b, II e)
+        {
+            iterator current = begin_iterator;
+            for(; b != e && current != end_iterator; ++b, ++current)
+            {
+                *current = *b;
+            }
+            if(b == e)
+            {
+                truncate(current);
+            }
+            else
+            {
+                insert(end_iterator, b, e);
             }
-
-            size_num = that.size_num;
             assert(valid());
-            return *this;}
+        }
 
         // -----------
         // operator []
@@ -1069,6 +1709,97 @@ class MyDeque {
             resize(0);
             assert(valid());}
 
+        // -------
+        // emplace
+        // -------
+
+        /**
+         * emplace (construct an element in place before it)
+         * shifts the shorter side of the deque by one, moving rather than copying
+         * @param it an iterator of the position of insertion
+         * @param args the arguments forwarded to the constructor of the new element
+         * @return an iterator to the new element
+         */
+        template <typename... Args>
+        iterator emplace (iterator it, Args&&... args)
+        {
+            typename P::scope timing(deque_insert);
+            difference_type offset = it - begin_iterator;  //keep track of the insertion position
+            if(offset == 0)
+            {
+                emplace_front(std::forward<Args>(args)...);
+                return begin_iterator;
+            }
+            if(static_cast<size_type>(offset) == size_num)
+            {
+                emplace_back(std::forward<Args>(args)...);
+                return end_iterator - 1;
+            }
+
+            //build the element first, the arguments may refer to elements about to move
+            value_type v(std::forward<Args>(args)...);
+            P::record(deque_shift, std::min<size_type>(offset, size_num - offset));
+            if(static_cast<size_type>(offset) < size_num / 2)
+            {
+                emplace_front(std::move(front()));
+                move_blocks(begin_iterator + 2, begin_iterator + (offset + 1), begin_iterator + 1);
+            }
+            else
+            {
+                emplace_back(std::move(back()));
+                move_blocks_backward(begin_iterator + offset, end_iterator - 2, end_iterator - 1);
+            }
+            it = begin_iterator + offset;
+            *it = std::move(v);
+
+            assert(valid());
+            return it;
+        }
+
+        /**
+         * emplace_back (construct an element in place at the end)
+         * @param args the arguments forwarded to the constructor of the new element
+         * @return reference to the new element
+         */
+        template <typename... Args>
+        reference emplace_back (Args&&... args)
+        {
+            typename P::scope timing(deque_push_back);
+            //grow the map or allocate the next block if the end is at a block boundary without one
+            if(end_iterator.get_block_index() == 0 && (last_block == end_iterator.get_block_address() || !*end_iterator.get_block_address()))
+            {   
+                reserve_map_back(1);
+            }
+            allocator_traits::construct(_a, &*end_iterator, std::forward<Args>(args)...);
+            ++end_iterator;
+            ++size_num;
+
+            assert(valid());
+            return back();
+        }
+
+        /**
+         * emplace_front (construct an element in place at the front)
+         * @param args the arguments forwarded to the constructor of the new element
+         * @return reference to the new element
+         */
+        template <typename... Args>
+        reference emplace_front (Args&&... args)
+        {
+            typename P::scope timing(deque_push_front);
+            //grow the map or allocate the previous block if the front is at a block boundary without one
+            if(begin_iterator.get_block_index() == 0 && (begin_iterator.get_block_address() == first_block || !*(begin_iterator.get_block_address() - 1)))
+            {
+                reserve_map_front(1);
+            }
+            allocator_traits::construct(_a, &*(begin_iterator - 1), std::forward<Args>(args)...);
+            --begin_iterator;
+            ++size_num;
+
+            assert(valid());
+            return front();
+        }
+
         // -----
         // empty
         // -----
@@ -1111,31 +1842,39 @@ class MyDeque {
          */
         iterator erase (iterator it) 
         {
-            iterator result = it + 1;
-            //check if it is closer to the begin_iterator or closer to the end_iterator (and shift elements to the shorter side)
-            if(distance(begin_iterator, it) <= distance(it, end_iterator))
+            return erase(it, it + 1);
+        }
+
+        /**
+         * erase (remove the elements in [b, e))
+         * shifts the shorter side of the deque once, by the whole width of the range
+         * @param b the beginning of the elements to remove
+         * @param e the end of the elements to remove
+         * @return an iterator to the element that followed the removed ones
+         */
+        iterator erase (iterator b, iterator e) 
+        {
+            difference_type n = e - b;
+            difference_type offset = b - begin_iterator;
+            if(n == 0)
+            {
+                return begin_iterator + offset;
+            }
+            typename P::scope timing(deque_erase);
+            //check if b is closer to the begin_iterator or closer to the end_iterator (and shift elements to the shorter side)
+            P::record(deque_shift, std::min(offset, end_iterator - e));
+            if(offset <= end_iterator - e)
             {   
-                while(it != begin_iterator)
-                {
-                    *it = *(it - 1);
-                    --it;
-                }
-                _a.destroy(&*begin_iterator);
-                ++begin_iterator;
+                move_blocks_backward(begin_iterator, b, e);
+                truncate_front(begin_iterator + n);
             }
             else
             {
-                while(it != (end_iterator - 1))
-                {
-                    *it = *(it + 1);
-                    ++it;
-                }
-                _a.destroy(&*(--end_iterator));
+                truncate(move_blocks(e, end_iterator, b));
             }
-            --size_num;
 
             assert(valid());
-            return result;
+            return begin_iterator + offset;
         }
 
         // -----
@@ -1162,48 +1901,53 @@ class MyDeque {
         // ------
 
         /**
-         * insert (remove an element)
+         * insert (add an element)
          * @param it an iterator of the position of insertion
-         * @param b an element to get insert
+         * @param v an element to get insert
          * @return an iterator to the new element get inserted
          */
         iterator insert (iterator it, const_reference v) 
         {
-            //if the end of the deque is fulled, reisze it
-            if(end_iterator.get_block_address() == last_block && end_iterator.get_block_index() == 0)
-            {
-                std::size_t it_offset = std::distance(begin_iterator, it);  //keep track of the insertion position
-                resize(size_num + 1);
-
-                it = begin_iterator + it_offset;
-
-                iterator temp = end_iterator - 2;
-
-                while(temp != (it - 1))
-                {
-                    *(temp + 1) = *temp;
-                    --temp;
-                }
-                *(it) = v;
-            }
-            else
-            {
-                ++size_num;
-                _a.construct(&*end_iterator, value_type());
-                ++end_iterator;
+            return emplace(it, v);
+        }
 
-                iterator temp = end_iterator - 2;
+        /**
+         * insert (add an element by moving it)
+         * @param it an iterator of the position of insertion
+         * @param v an element to get moved in
+         * @return an iterator to the new element get inserted
+         */
+        iterator insert (iterator it, value_type&& v) 
+        {
+            return emplace(it, std::move(v));
+        }
 
-                while(temp != (it - 1))
-                {
-                    *(temp + 1) = *temp;
-                    --temp;
-                }
-                *(it) = v;
-            }
+        /**
+         * insert (add n copies of an element)
+         * @param it an iterator of the position of insertion
+         * @param n the number of copies
+         * @param v an element to get insert
+         * @return an iterator to the first new element
+         */
+        iterator insert (iterator it, size_type n, const_reference v) 
+        {
+            //v may be an element of this deque
+            value_type copy(v);
+            return insert_counted(it, repeat_iterator(&copy, 0), repeat_iterator(&copy, n), n);
+        }
 
-            assert(valid());
-            return it;
+        /**
+         * insert (add the elements of [b, e))
+         * shifts the shorter side of the deque once and grows the map at most once
+         * @param it an iterator of the position of insertion
+         * @param b the beginning of the elements to insert
+         * @param e the end of the elements to insert
+         * @return an iterator to the first new element
+         */
+        template <typename II, typename = typename std::enable_if<!std::is_integral<II>::value>::type>
+        iterator insert (iterator it, II b, II e) 
+        {
+            return insert_range(it, b, e, typename std::iterator_traits<II>::iterator_category());
         }
 
         // ---
@@ -1215,8 +1959,15 @@ class MyDeque {
          */
         void pop_back () 
         {
-            _a.destroy(&*(--end_iterator));
+            typename P::scope timing(deque_pop_back);
+            allocator_traits::destroy(_a, &*(--end_iterator));
             --size_num;
+            //the block end left is now empty, hand it to the cache
+            if(end_iterator.get_block_index() == 0)
+            {
+                release_blocks(end_iterator.get_block_address(), end_iterator.get_block_address() + 1);
+                trim_if_sparse();
+            }
             assert(valid());
 
         }
@@ -1226,8 +1977,15 @@ class MyDeque {
          */
         void pop_front () 
         {
-            _a.destroy(&*(begin_iterator++));
+            typename P::scope timing(deque_pop_front);
+            allocator_traits::destroy(_a, &*(begin_iterator++));
             --size_num;
+            //the block begin left is now empty, hand it to the cache
+            if(begin_iterator.get_block_index() == 0)
+            {
+                release_blocks(begin_iterator.get_block_address() - 1, begin_iterator.get_block_address());
+                trim_if_sparse();
+            }
             assert(valid());}
 
         // ----
@@ -1240,44 +1998,63 @@ class MyDeque {
          */
         void push_back (const_reference v) 
         {
-            //reallocate if not enough memory at the end
-            if((last_block == end_iterator.get_block_address()) && end_iterator.get_block_index() == 0)
-            {   
-                resize(size_num + 1,v);
-            }
-            else
-            {
-                _a.construct(&*end_iterator, v);
-                ++end_iterator;
-                ++size_num;
-            }
-            
-            assert(valid());}
+            emplace_back(v);
+        }
+
+        /**
+         * push_back function (move an element to the end_iterator)
+         * @param v the value to be moved in
+         */
+        void push_back (value_type&& v) 
+        {
+            emplace_back(std::move(v));
+        }
 
         /**
-         * push_back function (add element to the front)
+         * push_front function (add element to the front)
          * @param v the value to be pushed
          */
         void push_front (const_reference v) 
         {   
-            //reallocate if not enough memory at the front
-            if((begin_iterator.get_block_address() - first_block) == 0 && begin_iterator.get_block_index() == 0)
-            {
-                //if there is only one block so far, when we expand the number of blocks, the 
-                resize(size_num + 1); //memory reallocation
-                pop_back(); //get rid of the new element the resize appaend
-                _a.construct(&*(--begin_iterator), v); //get new element in the front
+            emplace_front(v);
+        }
 
-            }
-            else
-            {
-                _a.construct(&*(--begin_iterator), v);
-            }
-            ++size_num;
-            assert(valid());}
+        /**
+         * push_front function (move an element to the front)
+         * @param v the value to be moved in
+         */
+        void push_front (value_type&& v) 
+        {   
+            emplace_front(std::move(v));
+        }
 
+        // -----
+        // range
+        // -----
 
+        /**
+         * append_range (add every element of r to the end, in order)
+         * @param r a range, anything with begin and end
+         */
+        template <typename R>
+        void append_range (const R& r) 
+        {
+            using std::begin;
+            using std::end;
+            insert(end_iterator, begin(r), end(r));
+        }
 
+        /**
+         * prepend_range (add every element of r to the front, keeping their order)
+         * @param r a range, anything with begin and end
+         */
+        template <typename R>
+        void prepend_range (const R& r) 
+        {
+            using std::begin;
+            using std::end;
+            insert(begin_iterator, begin(r), end(r));
+        }
 
         // ------
         // resize
@@ -1285,119 +2062,117 @@ class MyDeque {
 
         /**
          * @param s the size to be resized
-         * @param v the element to get copied for the new space expanded
-         * change the 
+         * change the size, value-initializing the new elements
          */
-        void resize (size_type s, const_reference v = value_type()) 
+        void resize (size_type s) 
         {   
-
-            //destroy elements at the end_iterator if s is less than the current size
             if(s <= size_num)
             {   
-                std::size_t count = size_num - s;
-                while(count-- != 0)
-                {
-                    _a.destroy(&(*end_iterator));
-                    --end_iterator;
-                }
-                size_num = s;
+                truncate(begin_iterator + s);
             }
-            //reallocation is not enough capacity
             else
             {
-                std::size_t block_num = (s / block_size + 1) * 2;
-                pointer* new_first_block = _a_outer.allocate(block_num);
-
-                pointer* old_begin_block = begin_iterator.get_block_address();
-                pointer* old_end_block = end_iterator.get_block_address();
-                std::size_t blocks_filled = old_end_block - old_begin_block;
-                if(end_iterator.get_block_index() != 0)
-                {
-                    ++blocks_filled;
-                }
-
-                pointer* temp_first = first_block;
-                pointer* temp_last = last_block;
-
-                //deallocate the unused inner arrays at the begin
-                while(temp_first != begin_iterator.get_block_address())
-                {
-                 _a.deallocate(*temp_first, block_size);
-                 ++temp_first;
-                }
-
-                //deallocate the unused inner arrays at the end
-                if(end_iterator.get_block_index() != 0)
-                {
-                    while(end_iterator.get_block_address() != --temp_last)
-                    {
-                        _a.deallocate(*temp_last, block_size);
-                    }
-                }
-                else
-                {
-                    while(end_iterator.get_block_address() != temp_last)
-                    {
-                        --temp_last;
-                        _a.deallocate(*temp_last, block_size);
-                    }
-                }
-
-                begin_iterator.set_block_address(new_first_block + ((s / block_size + 1) / 2));
-                end_iterator = begin_iterator + size_num;
-
-                pointer* current =  new_first_block;
-                pointer* old_first_block = first_block;
-                pointer* old_last_block = last_block;
-
-                first_block = new_first_block;
-                last_block = new_first_block + block_num;
-
-                //allocate new inner array at the front
-                while(current != begin_iterator.get_block_address())
-                {
-                    *current = _a.allocate(block_size);
-                    ++current;
-                }
-
-                //copy old inner array
-                while(blocks_filled-- != 0)
-                {   
-                    *current = *old_begin_block; 
-                    ++current;
-                    ++old_begin_block;
-                }
-                
-                //allocate new inner array at the end
-                while(current != last_block)
-                {   
-                    *current = _a.allocate(block_size);
-                    ++current;
-                }
-                
-                //append new elements
-                std::size_t count = s - size_num;
-
+                reserve_map_back(s - size_num);
+                end_iterator = uninitialized_default(_a, end_iterator, end_iterator + (s - size_num));
+            }
+            size_num = s;
+            
+            assert(valid());
+        }
 
-                while(count-- != 0)
-                {   
-                    _a.construct(&*end_iterator, v);
-                    ++end_iterator;
-                }
-                size_num = s;
-                _a_outer.deallocate(old_first_block, old_last_block - old_first_block);
+        /**
+         * @param s the size to be resized
+         * @param v the element to get copied for the new space expanded
+         * change the size, copying v into the new elements
+         */
+        void resize (size_type s, const_reference v) 
+        {   
+            //destroy elements at the end if s is less than the current size
+            if(s <= size_num)
+            {   
+                truncate(begin_iterator + s);
+            }
+            //append copies of v, growing the map only if the end runs out of blocks
+            else
+            {
+                reserve_map_back(s - size_num);
+                end_iterator = uninitialized_fill(_a, end_iterator, end_iterator + (s - size_num), v);
             }
+            size_num = s;
             
             assert(valid());
         }
 
-        // ----
-        // size
-        // ----
+        // -------
+        // reserve
+        // -------
 
         /**
-         * size function
-         * @return size_type the size of the dequeu
+         * make room for n more elements at the back, so that the next n push_backs
+         * (or an insert of n at the end) allocate nothing
+         * @param n the number of elements about to be appended
+         */
+        void reserve_back (size_type n)
+        {
+            reserve_map_back(n);
+            assert(valid());
+        }
+
+        /**
+         * make room for n more elements at the front, so that the next n push_fronts allocate nothing
+         * @param n the number of elements about to be prepended
+         */
+        void reserve_front (size_type n)
+        {
+            reserve_map_front(n);
+            assert(valid());
+        }
+
+        // -------------
+        // shrink_to_fit
+        // -------------
+
+        /**
+         * free every block that holds no element (reserved, cached or left behind by pops)
+         * and cut the map down to the blocks in use; an empty deque frees its map as well
+         * invalidates all iterators
+         */
+        void shrink_to_fit ()
+        {
+            if(size_num == 0)
+            {
+                deallocate_map();
+                begin_iterator = end_iterator = iterator(0, 0);
+                return;
+            }
+            pointer* b = begin_iterator.get_block_address();
+            pointer* e = end_iterator.get_block_address() + (end_iterator.get_block_index() != 0);
+            deallocate_blocks(first_block, b);
+            deallocate_blocks(e, last_block);
+            deallocate_cache();
+            size_type used = e - b;
+            if(used != static_cast<size_type>(last_block - first_block))
+            {
+                typename P::scope timing(deque_map_rebuild);
+                pointer* new_first_block = outer_traits::allocate(_a_outer, used);
+                ++map_rebuilds;
+                std::copy(b, e, new_first_block);
+                outer_traits::deallocate(_a_outer, first_block, last_block - first_block);
+                first_block = new_first_block;
+                last_block = new_first_block + used;
+                begin_iterator.set_block_address(first_block);
+                end_iterator = begin_iterator + size_num;
+            }
+            assert(valid());
+        }
+
+        // ----
+        // size
+        // ----
+
+        /**
+         * size function
+         * @return size_type the size of the dequeu
          */
         size_type size () const {
             
@@ -1409,37 +2184,1148 @@ class MyDeque {
 
         /**
          * swap
+         * the allocators are swapped only if they propagate on swap; otherwise they must be equal
          * @param that reference to MyDeque to be swapped
          */
         void swap (MyDeque& that) {
+            swap_allocators(that, typename allocator_traits::propagate_on_container_swap());
+            swap_storage(that);
+            assert(valid());}
 
-            pointer* temp_first = that.first_block;
-            pointer* temp_last = that.last_block;
-            iterator temp_begin = that.begin_iterator;
-            iterator temp_end = that.end_iterator;
+        // -------------
+        // get_allocator
+        // -------------
 
-            that.first_block = first_block;
-            that.last_block = last_block;
-            that.begin_iterator = begin_iterator; 
-            that.end_iterator = end_iterator;
+        /**
+         * @return a copy of the allocator
+         */
+        allocator_type get_allocator () const {
+            return _a;}
 
-            first_block = temp_first;
-            last_block = temp_last;
-            begin_iterator = temp_begin;
-            end_iterator = temp_end; 
+        // -----------
+        // block_cache
+        // -----------
 
-            that.size_num ^= size_num;
-            size_num ^= that.size_num;
-            that.size_num ^= size_num;
+        /**
+         * @return the most blocks the spare-block cache keeps
+         */
+        size_type block_cache_capacity () const {
+            return spare_capacity;}
 
+        /**
+         * change the most blocks the spare-block cache keeps, freeing any blocks over the new bound
+         * a capacity of 0 turns the cache off
+         * @param n the new capacity
+         */
+        void set_block_cache_capacity (size_type n)
+        {
+            while(spare_num > n)
+            {
+                deallocate_block(spare_blocks[--spare_num]);
+            }
+            if(spare_blocks && n != spare_capacity)
+            {
+                pointer* new_spare_blocks = n ? outer_traits::allocate(_a_outer, n) : 0;
+                std::copy(spare_blocks, spare_blocks + spare_num, new_spare_blocks);
+                outer_traits::deallocate(_a_outer, spare_blocks, spare_capacity);
+                spare_blocks = new_spare_blocks;
+            }
+            spare_capacity = n;
+            assert(valid());
+        }
 
-            assert(valid());}
+        /**
+         * @return how many blocks were taken from the cache (hits) versus the allocator (misses)
+         */
+        block_cache_stats block_cache_statistics () const
+        {
+            block_cache_stats stats = {spare_hits, spare_misses};
+            return stats;
+        }
+
+        // ------
+        // memory
+        // ------
+
+        /**
+         * O(map capacity): the allocated blocks are counted by walking the map
+         * @return the memory held by the deque and its allocation counters
+         */
+        memory_stats memory_statistics () const
+        {
+            memory_stats stats;
+            stats.size = size_num;
+            stats.blocks = 0;
+            for(pointer* current = first_block; current != last_block; ++current)
+            {
+                stats.blocks += (*current != 0);
+            }
+            stats.cached_blocks = spare_num;
+            stats.map_capacity = last_block - first_block;
+            stats.front_capacity = first_block ? (begin_iterator.get_block_address() - first_block) * block_size + begin_iterator.get_block_index() : 0;
+            stats.back_capacity = first_block ? (last_block - end_iterator.get_block_address()) * block_size - end_iterator.get_block_index() : 0;
+            stats.bytes = (stats.blocks + stats.cached_blocks) * block_size * sizeof(value_type)
+                        + stats.map_capacity * sizeof(pointer)
+                        + (spare_blocks ? spare_capacity * sizeof(pointer) : 0);
+            stats.block_allocations = spare_misses;
+            stats.block_frees = block_frees;
+            stats.map_rebuilds = map_rebuilds;
+            stats.map_recenters = map_recenters;
+            return stats;
+        }
+
+        // ----
+        // trim
+        // ----
+
+        /**
+         * @return the occupancy below which the deque shrinks itself (0 when it never does)
+         */
+        double trim_threshold () const {
+            return trim_occupancy;}
+
+        /**
+         * shrink_to_fit automatically whenever an end gives up a block, fewer than
+         * occupancy * (map slots * block_size) elements remain, and the map has at least
+         * trim_slack_blocks slots past the blocks in use; pops and erases may then invalidate all iterators
+         * the slack keeps a small deque cycling through a few blocks from trimming over and over:
+         * its map stays below the slack, so its blocks stay in the spare-block cache
+         * @param occupancy a fraction in [0, 1), 0 turns automatic trimming off
+         */
+        void set_trim_threshold (double occupancy)
+        {
+            trim_occupancy = occupancy;
+            trim_if_sparse();
+        }
+
+    public:
+        // ---------------
+        // segment_pointer
+        // ---------------
+
+        /**
+         * the raw element pointer behind an iterator, T* for iterator and const T* for const_iterator
+         */
+        template <typename I>
+        struct segment_pointer {
+            typedef typename std::remove_reference<typename I::reference>::type* type;};
+
+        // -------------
+        // walk_segments
+        // -------------
+
+        /**
+         * call f(p, q) for every contiguous span [p, q) of [b, e) until f returns false
+         * @return the beginning of the span f stopped on, or e
+         */
+        template <typename I, typename F>
+        static I walk_segments (I b, I e, F f)
+        {
+            typedef typename segment_pointer<I>::type raw;
+            while(b.get_block_address() != e.get_block_address())
+            {
+                raw p = &*b;
+                if(!f(p, p + (block_size - b.get_block_index())))
+                {
+                    return b;
+                }
+                b = I(b.get_block_address() + 1, 0);
+            }
+            if(b.get_block_index() != e.get_block_index())
+            {
+                raw p = &*b;
+                if(!f(p, p + (e.get_block_index() - b.get_block_index())))
+                {
+                    return b;
+                }
+            }
+            return e;
+        }
+
+        /**
+         * call f(p, q, r) for every span [p, q) of [b, e) that is contiguous both there and
+         * at its counterpart r in the range starting at x, until f returns false
+         * @return the beginning of the span f stopped on, or e
+         */
+        template <typename I1, typename I2, typename F>
+        static I1 walk_segments (I1 b, I1 e, I2 x, F f)
+        {
+            typedef typename segment_pointer<I1>::type raw;
+            while(b != e)
+            {
+                size_type run = (b.get_block_address() == e.get_block_address()) ? e.get_block_index() - b.get_block_index() : block_size - b.get_block_index();
+                size_type chunk = std::min(run, block_size - x.get_block_index());
+                raw p = &*b;
+                if(!f(p, p + chunk, &*x))
+                {
+                    return b;
+                }
+                b += chunk;
+                x += chunk;
+            }
+            return e;
+        }
+
+        // --------------------
+        // segmented algorithms
+        // --------------------
+
+        // the bodies behind the for_each_segment, for_each, find, fill, copy, equal, count,
+        // min_element, max_element and reduce overloads on iterator and const_iterator; each
+        // runs a plain loop over raw pointers for every block so the compiler can vectorize it,
+        // or a DequeSimd.h kernel where the element type has one
+
+        template <typename I, typename F>
+        static F segmented_for_each_segment (I b, I e, F& f)
+        {
+            typedef typename segment_pointer<I>::type raw;
+            walk_segments(b, e, [&f] (raw p, raw q) -> bool {
+                f(p, q);
+                return true;});
+            return f;
+        }
+
+        template <typename I, typename F>
+        static F segmented_for_each (I b, I e, F& f)
+        {
+            typedef typename segment_pointer<I>::type raw;
+            walk_segments(b, e, [&f] (raw p, raw q) -> bool {
+                for(; p != q; ++p)
+                {
+                    f(*p);
+                }
+                return true;});
+            return f;
+        }
+
+        template <typename I, typename U>
+        static I segmented_find (I b, I e, const U& v)
+        {
+            typedef typename segment_pointer<I>::type raw;
+            raw found = 0;
+            I span = walk_segments(b, e, [&] (raw p, raw q) -> bool {
+                raw r = deque_find(p, q, v);
+                if(r == q)
+                {
+                    return true;
+                }
+                found = r;
+                return false;});
+            return found ? span + (found - &*span) : e;
+        }
+
+        static void segmented_fill (iterator b, iterator e, const value_type& v)
+        {
+            walk_segments(b, e, [&v] (value_type* p, value_type* q) -> bool {
+                std::fill(p, q, v);
+                return true;});
+        }
+
+        template <typename I, typename O>
+        static O segmented_copy (I b, I e, O x)
+        {
+            typedef typename segment_pointer<I>::type raw;
+            walk_segments(b, e, [&x] (raw p, raw q) -> bool {
+                x = std::copy(p, q, x);
+                return true;});
+            return x;
+        }
+
+        template <typename I>
+        static iterator segmented_copy (I b, I e, iterator x)
+        {
+            typedef typename segment_pointer<I>::type raw;
+            walk_segments(b, e, x, [] (raw p, raw q, value_type* r) -> bool {
+                std::copy(p, q, r);
+                return true;});
+            return x + (e - b);
+        }
+
+        template <typename I1, typename I2>
+        static bool segmented_equal (I1 b, I1 e, I2 x)
+        {
+            typedef typename segment_pointer<I1>::type raw;
+            bool result = true;
+            walk_segments(b, e, [&] (raw p, raw q) -> bool {
+                result = std::equal(p, q, x);
+                std::advance(x, q - p);
+                return result;});
+            return result;
+        }
+
+        template <typename I1>
+        static bool segmented_equal (I1 b, I1 e, iterator x)
+        {
+            return segmented_equal_blocks(b, e, x);
+        }
+
+        template <typename I1>
+        static bool segmented_equal (I1 b, I1 e, const_iterator x)
+        {
+            return segmented_equal_blocks(b, e, x);
+        }
+
+        template <typename I1, typename I2>
+        static bool segmented_equal_blocks (I1 b, I1 e, I2 x)
+        {
+            typedef typename segment_pointer<I1>::type raw;
+            typedef typename segment_pointer<I2>::type raw_x;
+            return walk_segments(b, e, x, [] (raw p, raw q, raw_x r) -> bool {
+                return deque_mismatch(p, q, r) == q;}) == e;
+        }
+
+        template <typename I, typename U>
+        static difference_type segmented_count (I b, I e, const U& v)
+        {
+            typedef typename segment_pointer<I>::type raw;
+            difference_type n = 0;
+            walk_segments(b, e, [&] (raw p, raw q) -> bool {
+                n += deque_count(p, q, v);
+                return true;});
+            return n;
+        }
+
+        template <typename I>
+        static I segmented_min_element (I b, I e)
+        {
+            typedef typename segment_pointer<I>::type raw;
+            difference_type at = 0;
+            difference_type best = e - b;
+            walk_segments(b, e, [&] (raw p, raw q) -> bool {
+                raw r = deque_min_element(p, q);
+                if((r != q) && ((best == e - b) || (*r < b[best])))
+                {
+                    best = at + (r - p);
+                }
+                at += q - p;
+                return true;});
+            return b + best;
+        }
+
+        template <typename I>
+        static I segmented_max_element (I b, I e)
+        {
+            typedef typename segment_pointer<I>::type raw;
+            difference_type at = 0;
+            difference_type best = e - b;
+            walk_segments(b, e, [&] (raw p, raw q) -> bool {
+                raw r = deque_max_element(p, q);
+                if((r != q) && ((best == e - b) || (b[best] < *r)))
+                {
+                    best = at + (r - p);
+                }
+                at += q - p;
+                return true;});
+            return b + best;
+        }
+
+        template <typename I, typename U>
+        static U segmented_reduce (I b, I e, U init)
+        {
+            typedef typename segment_pointer<I>::type raw;
+            walk_segments(b, e, [&init] (raw p, raw q) -> bool {
+                init = deque_sum(p, q, init);
+                return true;});
+            return init;
+        }
+
+    private:
+        // ---------------
+        // repeat_iterator
+        // ---------------
+
+        /**
+         * forward iterator over the same value, used to insert or assign n copies
+         * through the range code
+         */
+        class repeat_iterator {
+            public:
+                typedef std::forward_iterator_tag         iterator_category;
+                typedef typename MyDeque::value_type      value_type;
+                typedef typename MyDeque::difference_type difference_type;
+                typedef const value_type*                 pointer;
+                typedef const value_type&                 reference;
+
+                repeat_iterator (const value_type* v, size_type n) : value(v), count(n) {}
+
+                reference operator * () const {
+                    return *value;}
+
+                pointer operator -> () const {
+                    return value;}
+
+                repeat_iterator& operator ++ () {
+                    ++count;
+                    return *this;}
+
+                repeat_iterator operator ++ (int) {
+                    repeat_iterator x = *this;
+                    ++count;
+                    return x;}
+
+                friend bool operator == (const repeat_iterator& lhs, const repeat_iterator& rhs) {
+                    return lhs.count == rhs.count;}
+
+                friend bool operator != (const repeat_iterator& lhs, const repeat_iterator& rhs) {
+                    return lhs.count != rhs.count;}
+
+            private:
+                const value_type* value;
+                size_type count;
         };
 
+        // ------------
+        // insert_range
+        // ------------
+
+        /**
+         * input iterators can only be walked once, so collect them before shifting anything
+         */
+        template <typename II>
+        iterator insert_range (iterator it, II b, II e, std::input_iterator_tag)
+        {
+            MyDeque temp(_a);
+            for(; b != e; ++b)
+            {
+                temp.emplace_back(*b);
+            }
+            return insert_counted(it, std::make_move_iterator(temp.begin()), std::make_move_iterator(temp.end()), temp.size());
+        }
+
+        template <typename FI>
+        iterator insert_range (iterator it, FI b, FI e, std::forward_iterator_tag)
+        {
+            return insert_counted(it, b, e, std::distance(b, e));
+        }
+
+        // --------------
+        // insert_counted
+        // --------------
+
+        /**
+         * insert the n elements of [b, e) before it
+         * the shorter side of the deque is shifted once by n; the elements that land in
+         * new storage are move-constructed, the rest are move-assigned
+         * @return an iterator to the first new element
+         */
+        template <typename FI>
+        iterator insert_counted (iterator it, FI b, FI e, size_type n)
+        {
+            size_type before = it - begin_iterator;
+            size_type after = size_num - before;
+            if(n == 0)
+            {
+                return it;
+            }
+            typename P::scope timing(deque_insert);
+            P::record(deque_shift, std::min(before, after));
+
+            if(before < after)
+            {
+                reserve_map_front(n);
+                iterator old_begin = begin_iterator;
+                iterator new_begin = begin_iterator - n;
+                if(before >= n)
+                {
+                    //the first n elements move into new storage, the rest of the front shifts down
+                    uninitialized_move_blocks(old_begin, old_begin + n, new_begin);
+                    begin_iterator = new_begin;
+                    size_num += n;
+                    move_blocks(old_begin + n, old_begin + before, old_begin);
+                    std::copy(b, e, old_begin + (before - n));
+                }
+                else
+                {
+                    //the whole front and the first new elements land in new storage
+                    FI mid = b;
+                    std::advance(mid, n - before);
+                    iterator p = uninitialized_move_blocks(old_begin, old_begin + before, new_begin);
+                    try
+                    {
+                        uninitialized_copy(_a, b, mid, p);
+                    }
+                    catch (...)
+                    {
+                        destroy(_a, new_begin, p);
+                        throw;
+                    }
+                    begin_iterator = new_begin;
+                    size_num += n;
+                    std::copy(mid, e, old_begin);
+                }
+            }
+            else
+            {
+                reserve_map_back(n);
+                iterator old_end = end_iterator;
+                iterator position = begin_iterator + before;
+                if(after >= n)
+                {
+                    //the last n elements move into new storage, the rest of the back shifts up
+                    uninitialized_move_blocks(old_end - n, old_end, old_end);
+                    end_iterator = old_end + n;
+                    size_num += n;
+                    move_blocks_backward(position, old_end - n, old_end);
+                    std::copy(b, e, position);
+                }
+                else
+                {
+                    //the last new elements and the whole back land in new storage
+                    FI mid = b;
+                    std::advance(mid, after);
+                    iterator p = uninitialized_copy(_a, mid, e, old_end);
+                    try
+                    {
+                        uninitialized_move_blocks(position, old_end, p);
+                    }
+                    catch (...)
+                    {
+                        destroy(_a, old_end, p);
+                        throw;
+                    }
+                    end_iterator = old_end + n;
+                    size_num += n;
+                    std::copy(b, mid, position);
+                }
+            }
+
+            assert(valid());
+            return begin_iterator + before;
+        }
+
+        // -------------------
+        // trivially_copyable
+        // -------------------
+
+        /**
+         * whether elements can be copied and shifted as raw bytes, a whole block segment at a time
+         */
+        typedef std::integral_constant<bool, std::is_trivially_copyable<value_type>::value> trivially_copyable;
+
+        // -----------
+        // copy_blocks
+        // -----------
+
+        /**
+         * copy [b, e) over the elements starting at x, one contiguous segment at a time
+         * for trivially copyable elements; x must not lie inside (b, e)
+         * @return the end of the copied range at x
+         */
+        template <typename I>
+        static iterator copy_blocks (I b, I e, iterator x)
+        {
+            return copy_blocks(b, e, x, trivially_copyable());
+        }
+
+        template <typename I>
+        static iterator copy_blocks (I b, I e, iterator x, std::false_type)
+        {
+            return std::copy(b, e, x);
+        }
+
+        template <typename I>
+        static iterator copy_blocks (I b, I e, iterator x, std::true_type)
+        {
+            //each span stays inside both the source block and the target block
+            walk_segments(b, e, x, [] (const value_type* p, const value_type* q, value_type* r) -> bool {
+                std::memmove(static_cast<void*>(r), static_cast<const void*>(p), (q - p) * sizeof(value_type));
+                return true;});
+            return x + (e - b);
+        }
+
+        // -------------------------
+        // uninitialized_copy_blocks
+        // -------------------------
+
+        /**
+         * copy-construct [b, e) into the raw storage starting at x, a segment at a time
+         * for trivially copyable elements
+         * @return the end of the constructed range at x
+         */
+        template <typename I>
+        iterator uninitialized_copy_blocks (I b, I e, iterator x)
+        {
+            return uninitialized_copy_blocks(b, e, x, trivially_copyable());
+        }
+
+        template <typename I>
+        iterator uninitialized_copy_blocks (I b, I e, iterator x, std::false_type)
+        {
+            return uninitialized_copy(_a, b, e, x);
+        }
+
+        template <typename I>
+        iterator uninitialized_copy_blocks (I b, I e, iterator x, std::true_type)
+        {
+            return copy_blocks(b, e, x, std::true_type());
+        }
+
+        // -------------------------
+        // uninitialized_move_blocks
+        // -------------------------
+
+        /**
+         * move-construct [b, e) into the raw storage starting at x, a segment at a time
+         * for trivially copyable elements; x must not lie inside (b, e)
+         * @return the end of the constructed range at x
+         */
+        iterator uninitialized_move_blocks (iterator b, iterator e, iterator x)
+        {
+            return uninitialized_move_blocks(b, e, x, trivially_copyable());
+        }
+
+        iterator uninitialized_move_blocks (iterator b, iterator e, iterator x, std::false_type)
+        {
+            return uninitialized_move(_a, b, e, x);
+        }
+
+        iterator uninitialized_move_blocks (iterator b, iterator e, iterator x, std::true_type)
+        {
+            return copy_blocks(b, e, x, std::true_type());
+        }
+
+        // -----------
+        // move_blocks
+        // -----------
+
+        /**
+         * move [b, e) to the elements starting at x, front to back, so x may overlap
+         * the range as long as it does not come after b
+         * @return the end of the moved range at x
+         */
+        static iterator move_blocks (iterator b, iterator e, iterator x)
+        {
+            return move_blocks(b, e, x, trivially_copyable());
+        }
+
+        static iterator move_blocks (iterator b, iterator e, iterator x, std::false_type)
+        {
+            return std::move(b, e, x);
+        }
+
+        static iterator move_blocks (iterator b, iterator e, iterator x, std::true_type)
+        {
+            return copy_blocks(b, e, x, std::true_type());
+        }
+
+        // --------------------
+        // move_blocks_backward
+        // --------------------
+
+        /**
+         * move [b, e) to the elements ending at x, back to front, so x may overlap
+         * the range as long as it does not come before e
+         * @return the beginning of the moved range at x
+         */
+        static iterator move_blocks_backward (iterator b, iterator e, iterator x)
+        {
+            return move_blocks_backward(b, e, x, trivially_copyable());
+        }
+
+        static iterator move_blocks_backward (iterator b, iterator e, iterator x, std::false_type)
+        {
+            return std::move_backward(b, e, x);
+        }
+
+        static iterator move_blocks_backward (iterator b, iterator e, iterator x, std::true_type)
+        {
+            size_type n = (e - b);
+            while(n != 0)
+            {
+                //the longest run that ends inside both the source block and the target block
+                size_type source_run = e.get_block_index() ? e.get_block_index() : block_size;
+                size_type target_run = x.get_block_index() ? x.get_block_index() : block_size;
+                size_type chunk = std::min(n, std::min(source_run, target_run));
+                e -= chunk;
+                x -= chunk;
+                std::memmove(static_cast<void*>(&*x), static_cast<const void*>(&*e), chunk * sizeof(value_type));
+                n -= chunk;
+            }
+            return x;
+        }
+
+        // ---------------
+        // release_storage
+        // ---------------
+
+        /**
+         * destroy every element and free the map, the blocks and the block cache, leaving an empty deque
+         */
+        void release_storage ()
+        {
+            destroy(_a, begin_iterator, end_iterator);
+            deallocate_map();
+            begin_iterator = end_iterator = iterator(0, 0);
+            size_num = 0;
+        }
+
+        // ---------------------
+        // copy_assign_allocator
+        // ---------------------
+
+        /**
+         * take the allocator of that, first freeing everything the old one allocated if the two differ
+         */
+        void copy_assign_allocator (const MyDeque& that, std::true_type)
+        {
+            if(!(_a == that._a))
+            {
+                release_storage();
+            }
+            _a = that._a;
+            _a_outer = that._a_outer;
+        }
+
+        void copy_assign_allocator (const MyDeque&, std::false_type)
+        {}
+
+        // -----------
+        // move_assign
+        // -----------
+
+        /**
+         * the allocator propagates: free this and take over the storage and the allocator of that
+         */
+        void move_assign (MyDeque& that, std::true_type)
+        {
+            release_storage();
+            _a = std::move(that._a);
+            _a_outer = std::move(that._a_outer);
+            swap_storage(that);
+        }
+
+        /**
+         * the allocator stays: take over the storage of that only if this allocator can free it
+         */
+        void move_assign (MyDeque& that, std::false_type)
+        {
+            if(_a == that._a)
+            {
+                release_storage();
+                swap_storage(that);
+            }
+            else
+            {
+                assign(std::make_move_iterator(that.begin()), std::make_move_iterator(that.end()));
+                that.clear();
+            }
+        }
+
+        // ---------------
+        // swap_allocators
+        // ---------------
+
+        void swap_allocators (MyDeque& that, std::true_type)
+        {
+            using std::swap;
+            swap(_a, that._a);
+            swap(_a_outer, that._a_outer);
+        }
+
+        void swap_allocators (MyDeque& that, std::false_type)
+        {
+            assert(_a == that._a);
+        }
+
+        // ------------
+        // swap_storage
+        // ------------
+
+        /**
+         * exchange the map, blocks, elements and block cache with that (not the allocators)
+         * @param that reference to MyDeque to be swapped
+         */
+        void swap_storage (MyDeque& that)
+        {
+            std::swap(first_block, that.first_block);
+            std::swap(last_block, that.last_block);
+            std::swap(begin_iterator, that.begin_iterator);
+            std::swap(end_iterator, that.end_iterator);
+            std::swap(size_num, that.size_num);
+            std::swap(spare_blocks, that.spare_blocks);
+            std::swap(spare_num, that.spare_num);
+            std::swap(spare_capacity, that.spare_capacity);
+            std::swap(spare_hits, that.spare_hits);
+            std::swap(spare_misses, that.spare_misses);
+            std::swap(trim_occupancy, that.trim_occupancy);
+            std::swap(block_frees, that.block_frees);
+            std::swap(map_rebuilds, that.map_rebuilds);
+            std::swap(map_recenters, that.map_recenters);
+        }
+
+        // ----------------
+        // reserve_map_back
+        // ----------------
+
+        /**
+         * make sure the n elements after end have allocated blocks in the map
+         * @param n the number of elements about to be appended
+         */
+        void reserve_map_back (size_type n)
+        {
+            size_type blocks_needed = (end_iterator.get_block_index() + n + block_mask) >> block_shift;
+            size_type blocks_left = last_block - end_iterator.get_block_address();
+            if(blocks_needed > blocks_left)
+            {
+                //the block end is in already counts as part of the used span
+                reallocate_map(blocks_needed - 1, false);
+            }
+            allocate_blocks(end_iterator.get_block_address(), end_iterator.get_block_address() + blocks_needed);
+        }
+
+        // -----------------
+        // reserve_map_front
+        // -----------------
+
+        /**
+         * make sure the n elements before begin have allocated blocks in the map
+         * @param n the number of elements about to be prepended
+         */
+        void reserve_map_front (size_type n)
+        {
+            if(n <= begin_iterator.get_block_index())
+            {
+                return;
+            }
+            size_type blocks_needed = (n - begin_iterator.get_block_index() + block_mask) >> block_shift;
+            size_type blocks_left = begin_iterator.get_block_address() - first_block;
+            if(blocks_needed > blocks_left)
+            {
+                reallocate_map(blocks_needed, true);
+            }
+            allocate_blocks(begin_iterator.get_block_address() - blocks_needed, begin_iterator.get_block_address());
+        }
+
+        // ---------------
+        // allocate_blocks
+        // ---------------
+
+        /**
+         * allocate a block for every empty slot in [b, e)
+         * @param b the first slot in the map
+         * @param e one past the last slot in the map
+         */
+        void allocate_blocks (pointer* b, pointer* e)
+        {
+            for(; b != e; ++b)
+            {
+                if(!*b)
+                {
+                    *b = acquire_block();
+                }
+            }
+        }
+
+        // --------------
+        // release_blocks
+        // --------------
+
+        /**
+         * empty every allocated slot in [b, e), keeping the blocks in the cache while it has room
+         * @param b the first slot in the map
+         * @param e one past the last slot in the map
+         */
+        void release_blocks (pointer* b, pointer* e)
+        {
+            for(; b != e; ++b)
+            {
+                if(*b)
+                {
+                    release_block(*b);
+                    *b = 0;
+                }
+            }
+        }
+
+        // -------------
+        // acquire_block
+        // -------------
+
+        /**
+         * @return a block from the cache, or a new one if the cache is empty
+         */
+        pointer acquire_block ()
+        {
+            if(spare_num)
+            {
+                ++spare_hits;
+                return spare_blocks[--spare_num];
+            }
+            ++spare_misses;
+            return allocator_traits::allocate(_a, block_size);
+        }
+
+        // -------------
+        // release_block
+        // -------------
+
+        /**
+         * @param p a block that holds no elements, cached if there is room and freed otherwise
+         */
+        void release_block (pointer p)
+        {
+            if(spare_num == spare_capacity)
+            {
+                deallocate_block(p);
+                return;
+            }
+            if(!spare_blocks)
+            {
+                spare_blocks = outer_traits::allocate(_a_outer, spare_capacity);
+            }
+            spare_blocks[spare_num++] = p;
+        }
+
+        // --------------
+        // truncate_front
+        // --------------
+
+        /**
+         * destroy the elements in [begin, new_begin) and release the blocks they leave empty
+         * @param new_begin the new beginning of the deque
+         */
+        void truncate_front (iterator new_begin)
+        {
+            destroy(_a, begin_iterator, new_begin);
+            release_blocks(begin_iterator.get_block_address(), new_begin.get_block_address());
+            size_num -= new_begin - begin_iterator;
+            begin_iterator = new_begin;
+            trim_if_sparse();
+        }
+
+        // --------
+        // truncate
+        // --------
+
+        /**
+         * destroy the elements in [new_end, end) and release the blocks they leave empty
+         * @param new_end the new end of the deque
+         */
+        void truncate (iterator new_end)
+        {
+            destroy(_a, new_end, end_iterator);
+            release_blocks(new_end.get_block_address() + (new_end.get_block_index() != 0),
+                           end_iterator.get_block_address() + (end_iterator.get_block_index() != 0));
+            size_num -= end_iterator - new_end;
+            end_iterator = new_end;
+            trim_if_sparse();
+        }
+
+        // --------------
+        // deallocate_map
+        // --------------
+
+        /**
+         * free every allocated block and the map itself (the elements must already be destroyed)
+         */
+        void deallocate_map ()
+        {
+            for(pointer* current = first_block; current != last_block; ++current)
+            {
+                if(*current)
+                {
+                    deallocate_block(*current);
+                }
+            }
+            if(first_block)
+            {
+                outer_traits::deallocate(_a_outer, first_block, last_block - first_block);
+            }
+            first_block = last_block = 0;
+            deallocate_cache();
+        }
+
+        // ----------------
+        // deallocate_block
+        // ----------------
+
+        /**
+         * @param p a block that holds no elements, given back to the allocator
+         */
+        void deallocate_block (pointer p)
+        {
+            allocator_traits::deallocate(_a, p, block_size);
+            ++block_frees;
+        }
+
+        // ----------------
+        // deallocate_cache
+        // ----------------
+
+        /**
+         * free the blocks in the spare-block cache and the cache itself (the capacity stays)
+         */
+        void deallocate_cache ()
+        {
+            while(spare_num)
+            {
+                deallocate_block(spare_blocks[--spare_num]);
+            }
+            if(spare_blocks)
+            {
+                outer_traits::deallocate(_a_outer, spare_blocks, spare_capacity);
+            }
+            spare_blocks = 0;
+        }
+
+        // -----------------
+        // deallocate_blocks
+        // -----------------
+
+        /**
+         * free every allocated block in [b, e), bypassing the cache
+         * @param b the first slot in the map
+         * @param e one past the last slot in the map
+         */
+        void deallocate_blocks (pointer* b, pointer* e)
+        {
+            for(; b != e; ++b)
+            {
+                if(*b)
+                {
+                    deallocate_block(*b);
+                    *b = 0;
+                }
+            }
+        }
+
+        // --------------
+        // trim_if_sparse
+        // --------------
+
+        /**
+         * the automatic half of shrink_to_fit, checked only when a block has just been given up
+         */
+        void trim_if_sparse ()
+        {
+            size_type slots = last_block - first_block;
+            size_type used = (end_iterator.get_block_address() - begin_iterator.get_block_address()) + (end_iterator.get_block_index() != 0);
+            if((slots >= used + trim_slack_blocks) && (size_num < trim_occupancy * static_cast<double>(slots) * block_size))
+            {
+                shrink_to_fit();
+            }
+        }
+
+        // --------------
+        // reallocate_map
+        // --------------
+
+        /**
+         * make room in the map for n more slots at one end of the used span
+         * if the map is at least twice as big as what is needed, the used span is
+         * recentered in place; otherwise the map grows geometrically. In both cases
+         * the existing block pointers are moved, never freed or reallocated, so
+         * pushes at either end stay amortized O(1). New slots are left empty
+         * blocks already allocated right before begin or right after end (reserved) count as part
+         * of the used span, so making room at one end never takes the reservation of the other
+         * @param n the number of free blocks wanted past the used span
+         * @param at_front whether the blocks are wanted before begin or after end
+         */
+        void reallocate_map (size_type n, bool at_front)
+        {
+            size_type map_size = last_block - first_block;
+            //blocks from begin's block through end's block, inclusive, widened by the reserved blocks around them
+            pointer* span_begin = begin_iterator.get_block_address();
+            while(span_begin != first_block && span_begin[-1])
+            {
+                --span_begin;
+            }
+            pointer* span_end = end_iterator.get_block_address() + 1;
+            while(span_end < last_block && *span_end)
+            {
+                ++span_end;
+            }
+            size_type front_reserved = begin_iterator.get_block_address() - span_begin;
+            size_type old_begin_index = span_begin - first_block;
+            size_type used_blocks = span_end - span_begin;
+            size_type new_begin_index;
+
+            if(map_size >= 2 * (used_blocks + n))
+            {
+                //enough slack: rotate the block pointers so the used span sits in the middle
+                typename P::scope timing(deque_map_recenter);
+                ++map_recenters;
+                new_begin_index = (map_size - used_blocks - n) / 2 + (at_front ? n : 0);
+                if(new_begin_index < old_begin_index)
+                {
+                    std::rotate(first_block, first_block + (old_begin_index - new_begin_index), last_block);
+                }
+                else
+                {
+                    std::rotate(first_block, last_block - (new_begin_index - old_begin_index), last_block);
+                }
+                begin_iterator.set_block_address(first_block + new_begin_index + front_reserved);
+            }
+            else
+            {
+                //grow geometrically and move every existing block pointer into the new map,
+                //keeping their cyclic order so the used span stays contiguous
+                typename P::scope timing(deque_map_rebuild);
+                size_type new_map_size = map_size + std::max(map_size, n) + 2;
+                pointer* new_first_block = outer_traits::allocate(_a_outer, new_map_size);
+                ++map_rebuilds;
+                new_begin_index = (new_map_size - used_blocks - n) / 2 + (at_front ? n : 0);
+
+                size_type moved = 0;
+                for(; moved != map_size; ++moved)
+                {
+                    new_first_block[(new_begin_index + moved) % new_map_size] = first_block[(old_begin_index + moved) % map_size];
+                }
+                //the slots that did not receive a block stay empty until an end reaches them
+                for(; moved != new_map_size; ++moved)
+                {
+                    new_first_block[(new_begin_index + moved) % new_map_size] = 0;
+                }
+
+                if(first_block)
+                {
+                    outer_traits::deallocate(_a_outer, first_block, map_size);
+                }
+                first_block = new_first_block;
+                last_block = new_first_block + new_map_size;
+                begin_iterator.set_block_address(first_block + new_begin_index + front_reserved);
+            }
+
+            end_iterator = begin_iterator + size_num;
+            assert(valid());
+        }
+        };
+
+
+
+
+template <typename T, typename A, std::size_t B, typename P>
+const std::size_t MyDeque<T, A, B, P>::block_size;
+
+template <typename T, typename A, std::size_t B, typename P>
+const std::size_t MyDeque<T, A, B, P>::block_shift;
+
+template <typename T, typename A, std::size_t B, typename P>
+const std::size_t MyDeque<T, A, B, P>::block_mask;
+
+template <typename T, typename A, std::size_t B, typename P>
+const std::size_t MyDeque<T, A, B, P>::default_block_cache_capacity;
+
+template <typename T, typename A, std::size_t B, typename P>
+const std::size_t MyDeque<T, A, B, P>::trim_slack_blocks;
+
+// ---
+// pmr
+// ---
 
+#if __cplusplus >= 201703L && defined(__has_include)
+#if __has_include(<memory_resource>)
+#include <memory_resource> // polymorphic_allocator
 
+/**
+ * MyDeque on a std::pmr::memory_resource, like std::pmr::deque
+ * (spelled ::pmr::MyDeque where std::pmr is also visible)
+ */
+namespace pmr {
+    template < typename T, std::size_t B = deque_block_size<T>::value >
+    using MyDeque = ::MyDeque<T, std::pmr::polymorphic_allocator<T>, B>;}
 
-        template<typename T, typename A>
-        typename std::size_t MyDeque<T, A>::block_size = 10;
+#endif
+#endif
 
 #endif // Deque_h
\ No newline at end of file
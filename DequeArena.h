@@ -0,0 +1,455 @@
+// ---------------------------
+// projects/deque/DequeArena.h
+// ---------------------------
+
+#ifndef DequeArena_h
+#define DequeArena_h
+
+// --------
+// includes
+// --------
+
+#include <cstddef> // max_align_t, size_t
+#include <new>     // operator new, operator delete
+
+#include "Deque.h"
+
+// ----------
+// DequeArena
+// ----------
+
+/**
+ * memory resource shaped like MyDeque's two kinds of allocation
+ * blocks (all the same size) come from a slab of identical chunks and go back onto a free list;
+ * maps and other small requests come from a bump arena, rounded up to a power of two and
+ * recycled per size; anything bigger than a quarter of an arena chunk goes straight to operator new
+ * in monotonic mode deallocate does nothing and reset throws everything away at once,
+ * for deques that live and die with one request
+ * not thread safe: use one arena per thread
+ */
+class DequeArena {
+    public:
+        // ---------
+        // constants
+        // ---------
+
+        static const std::size_t alignment           = alignof(std::max_align_t);
+        static const std::size_t default_chunk_bytes = 64 * 1024;
+
+    private:
+        /**
+         * size classes for the arena: alignment, 2 * alignment, ... up to a quarter of a chunk
+         */
+        static const std::size_t class_count = 32;
+
+        struct free_node {
+            free_node* next;};
+
+        struct chunk {
+            chunk*      next;
+            std::size_t bytes;};
+
+        struct large {
+            large*      next;
+            large*      previous;};
+
+        // ----
+        // data
+        // ----
+
+        std::size_t slab_bytes;
+        std::size_t chunk_bytes;
+        bool        monotonic_mode;
+
+        free_node*  free_blocks;
+        free_node*  free_classes[class_count];
+
+        chunk*      chunks;
+        chunk*      current;
+        char*       cursor;
+        char*       limit;
+        std::size_t reserved;
+
+        large*      larges;
+
+    public:
+        // ------------
+        // constructors
+        // ------------
+
+        /**
+         * @param block_bytes the size of the deque's blocks (block_size * sizeof(T)), served by the slab
+         * @param monotonic whether deallocate is a no-op and memory only comes back through reset
+         * @param chunk bytes requested from the system at a time
+         */
+        explicit DequeArena (std::size_t block_bytes = deque_block_size<char>::block_bytes, bool monotonic = false, std::size_t chunk = default_chunk_bytes) :
+                slab_bytes(round_up(block_bytes)),
+                chunk_bytes(chunk < 16 * round_up(block_bytes) ? 16 * round_up(block_bytes) : chunk),
+                monotonic_mode(monotonic),
+                free_blocks(0),
+                chunks(0), current(0), cursor(0), limit(0), reserved(0),
+                larges(0)
+        {
+            clear_free_lists();
+        }
+
+        DequeArena (const DequeArena&) = delete;
+        DequeArena& operator = (const DequeArena&) = delete;
+
+        // ----------
+        // destructor
+        // ----------
+
+        /**
+         * every container using the arena must already be gone
+         */
+        ~DequeArena ()
+        {
+            release_larges();
+            while(chunks)
+            {
+                chunk* next = chunks->next;
+                ::operator delete(chunks);
+                chunks = next;
+            }
+        }
+
+        // --------
+        // allocate
+        // --------
+
+        /**
+         * @param bytes the size of the request
+         * @return memory aligned for any fundamental type
+         */
+        void* allocate (std::size_t bytes)
+        {
+            std::size_t rounded = round_up(bytes);
+            if(rounded == slab_bytes)
+            {
+                return pop(free_blocks, slab_bytes);
+            }
+            std::size_t c = size_class(rounded);
+            if(c < class_count)
+            {
+                return pop(free_classes[c], alignment << c);
+            }
+            return allocate_large(bytes);
+        }
+
+        // ----------
+        // deallocate
+        // ----------
+
+        /**
+         * @param p memory from allocate
+         * @param bytes the size it was allocated with
+         */
+        void deallocate (void* p, std::size_t bytes)
+        {
+            std::size_t rounded = round_up(bytes);
+            std::size_t c = size_class(rounded);
+            if(rounded != slab_bytes && c >= class_count)
+            {
+                deallocate_large(p);
+            }
+            else if(!monotonic_mode)
+            {
+                push((rounded == slab_bytes) ? free_blocks : free_classes[c], p);
+            }
+        }
+
+        // -----
+        // reset
+        // -----
+
+        /**
+         * take back every allocation at once, keeping the chunks for reuse
+         * no container may still be using the arena
+         */
+        void reset ()
+        {
+            release_larges();
+            clear_free_lists();
+            current = chunks;
+            cursor = chunks ? start(chunks) : 0;
+            limit = chunks ? start(chunks) + chunks->bytes : 0;
+        }
+
+        // ---------
+        // monotonic
+        // ---------
+
+        /**
+         * @return whether deallocate is a no-op
+         */
+        bool monotonic () const
+        {
+            return monotonic_mode;
+        }
+
+        // --------------
+        // bytes_reserved
+        // --------------
+
+        /**
+         * @return the bytes held in chunks (not counting requests sent to operator new)
+         */
+        std::size_t bytes_reserved () const
+        {
+            return reserved;
+        }
+
+    private:
+        // --------
+        // round_up
+        // --------
+
+        static std::size_t round_up (std::size_t bytes)
+        {
+            return (bytes + alignment - 1) & ~(alignment - 1);
+        }
+
+        // ----------
+        // size_class
+        // ----------
+
+        /**
+         * @return the index of the smallest class that holds rounded bytes, or class_count if it is too big
+         */
+        std::size_t size_class (std::size_t rounded) const
+        {
+            std::size_t c = 0;
+            while(c < class_count && (alignment << c) < rounded)
+            {
+                ++c;
+            }
+            return (c < class_count && (alignment << c) <= chunk_bytes / 4) ? c : class_count;
+        }
+
+        // -----
+        // start
+        // -----
+
+        /**
+         * @return the first usable byte of c, past its header
+         */
+        static char* start (chunk* c)
+        {
+            return reinterpret_cast<char*>(c) + round_up(sizeof(chunk));
+        }
+
+        // ----------------
+        // clear_free_lists
+        // ----------------
+
+        void clear_free_lists ()
+        {
+            free_blocks = 0;
+            for(std::size_t c = 0; c != class_count; ++c)
+            {
+                free_classes[c] = 0;
+            }
+        }
+
+        // ---
+        // pop
+        // ---
+
+        /**
+         * @return the head of list, or a new piece of bytes carved from the arena
+         */
+        void* pop (free_node*& list, std::size_t bytes)
+        {
+            if(list)
+            {
+                free_node* p = list;
+                list = p->next;
+                return p;
+            }
+            return carve(bytes);
+        }
+
+        // ----
+        // push
+        // ----
+
+        static void push (free_node*& list, void* p)
+        {
+            free_node* n = static_cast<free_node*>(p);
+            n->next = list;
+            list = n;
+        }
+
+        // -----
+        // carve
+        // -----
+
+        /**
+         * bump-allocate from the current chunk, moving to the next one (reused after a reset, or new)
+         */
+        void* carve (std::size_t bytes)
+        {
+            if(static_cast<std::size_t>(limit - cursor) < bytes)
+            {
+                if(current && current->next)
+                {
+                    current = current->next;
+                }
+                else
+                {
+                    chunk* c = static_cast<chunk*>(::operator new(round_up(sizeof(chunk)) + chunk_bytes));
+                    c->next = 0;
+                    c->bytes = chunk_bytes;
+                    reserved += chunk_bytes;
+                    if(current)
+                    {
+                        current->next = c;
+                    }
+                    else
+                    {
+                        chunks = c;
+                    }
+                    current = c;
+                }
+                cursor = start(current);
+                limit = cursor + current->bytes;
+            }
+            void* p = cursor;
+            cursor += bytes;
+            return p;
+        }
+
+        // --------------
+        // allocate_large
+        // --------------
+
+        void* allocate_large (std::size_t bytes)
+        {
+            large* l = static_cast<large*>(::operator new(round_up(sizeof(large)) + bytes));
+            l->previous = 0;
+            l->next = larges;
+            if(larges)
+            {
+                larges->previous = l;
+            }
+            larges = l;
+            return reinterpret_cast<char*>(l) + round_up(sizeof(large));
+        }
+
+        // ----------------
+        // deallocate_large
+        // ----------------
+
+        void deallocate_large (void* p)
+        {
+            if(monotonic_mode)
+            {
+                return;
+            }
+            large* l = reinterpret_cast<large*>(static_cast<char*>(p) - round_up(sizeof(large)));
+            (l->previous ? l->previous->next : larges) = l->next;
+            if(l->next)
+            {
+                l->next->previous = l->previous;
+            }
+            ::operator delete(l);
+        }
+
+        // --------------
+        // release_larges
+        // --------------
+
+        void release_larges ()
+        {
+            while(larges)
+            {
+                large* next = larges->next;
+                ::operator delete(larges);
+                larges = next;
+            }
+        }
+};
+
+// -------------------
+// DequeArenaAllocator
+// -------------------
+
+/**
+ * allocator handle to a DequeArena; copies (and rebinds) share the arena
+ * MyDeque<T, DequeArenaAllocator<T> > sends its blocks to the slab and its map to the arena
+ */
+template <typename T>
+class DequeArenaAllocator {
+    public:
+        // --------
+        // typedefs
+        // --------
+
+        typedef T value_type;
+
+        // ------------
+        // constructors
+        // ------------
+
+        DequeArenaAllocator (DequeArena& a) :
+                arena(&a)
+        {}
+
+        template <typename U>
+        DequeArenaAllocator (const DequeArenaAllocator<U>& that) :
+                arena(that.resource())
+        {}
+
+        // --------
+        // allocate
+        // --------
+
+        T* allocate (std::size_t n)
+        {
+            return static_cast<T*>(arena->allocate(n * sizeof(T)));
+        }
+
+        // ----------
+        // deallocate
+        // ----------
+
+        void deallocate (T* p, std::size_t n)
+        {
+            arena->deallocate(p, n * sizeof(T));
+        }
+
+        // -----------
+        // operator ==
+        // -----------
+
+        /**
+         * allocators are interchangeable when they share an arena
+         */
+        friend bool operator == (const DequeArenaAllocator& lhs, const DequeArenaAllocator& rhs)
+        {
+            return lhs.arena == rhs.arena;
+        }
+
+        friend bool operator != (const DequeArenaAllocator& lhs, const DequeArenaAllocator& rhs)
+        {
+            return lhs.arena != rhs.arena;
+        }
+
+        // --------
+        // resource
+        // --------
+
+        /**
+         * @return the arena this allocator draws from
+         */
+        DequeArena* resource () const
+        {
+            return arena;
+        }
+
+    private:
+        DequeArena* arena;
+};
+
+#endif // DequeArena_h
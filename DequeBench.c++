@@ -0,0 +1,628 @@
+// -----------------------------
+// projects/deque/DequeBench.c++
+// -----------------------------
+
+/*
+To run the benchmarks:
+    % make DequeBench
+    % ./DequeBench
+To record them for comparing two versions:
+    % make DequeBench.json
+    % compare.py benchmarks old.json DequeBench.json
+*/
+
+// --------
+// includes
+// --------
+
+#include <cstddef> // size_t
+#include <cstdio>  // remove
+#include <cstdlib> // rand, srand
+#include <deque>   // deque
+#include <fstream> // ifstream, ofstream
+#include <vector>  // vector
+
+#include "benchmark/benchmark.h"
+
+#include "BoundedDeque.h"
+#include "Deque.h"
+#include "DequeArena.h"
+#include "DequeSnapshot.h"
+#include "SmallDeque.h"
+#include "TieredDeque.h"
+
+using namespace std;
+
+// -------
+// Payload
+// -------
+
+/**
+ * trivially copyable element of N bytes, to see how the block layout behaves as T grows
+ */
+template <std::size_t N>
+struct Payload
+{
+    int value;
+    char padding[N - sizeof(int)];
+};
+
+template <typename T>
+inline T make (int i)
+{
+    T x = T();
+    x.value = i;
+    return x;
+}
+
+template <>
+inline int make<int> (int i)
+{
+    return i;
+}
+
+inline int value_of (int x)
+{
+    return x;
+}
+
+template <std::size_t N>
+inline int value_of (const Payload<N>& x)
+{
+    return x.value;
+}
+
+/**
+ * a container of n elements built with push_back
+ */
+template <typename C>
+C filled (int n)
+{
+    C x;
+    for(int i = 0; i < n; ++i)
+    {
+        x.push_back(make<typename C::value_type>(i));
+    }
+    return x;
+}
+
+// ---------
+// push_back
+// ---------
+
+template <typename C>
+void BM_PushBack (benchmark::State& state)
+{
+    const int n = state.range(0);
+    for(auto _ : state)
+    {
+        C x;
+        for(int i = 0; i < n; ++i)
+        {
+            x.push_back(make<typename C::value_type>(i));
+        }
+        benchmark::DoNotOptimize(x);
+    }
+    state.SetItemsProcessed(state.iterations() * n);
+}
+
+// ----------
+// push_front
+// ----------
+
+template <typename C>
+void BM_PushFront (benchmark::State& state)
+{
+    const int n = state.range(0);
+    for(auto _ : state)
+    {
+        C x;
+        for(int i = 0; i < n; ++i)
+        {
+            x.push_front(make<typename C::value_type>(i));
+        }
+        benchmark::DoNotOptimize(x);
+    }
+    state.SetItemsProcessed(state.iterations() * n);
+}
+
+// ----------
+// map_growth
+// ----------
+
+/**
+ * push n ints at one end of a deque with one-element blocks, so every push needs a map slot
+ * the time per push stays flat as n grows when the map grows in amortized O(1);
+ * the counters say how many times the map was rebuilt or recentered on the way to n
+ */
+template <bool AtFront>
+void BM_MapGrowth (benchmark::State& state)
+{
+    typedef MyDeque<int, allocator<int>, 1> C;
+    const int n = state.range(0);
+    C::memory_stats s = {};
+    for(auto _ : state)
+    {
+        C x;
+        for(int i = 0; i < n; ++i)
+        {
+            if(AtFront)
+            {
+                x.push_front(i);
+            }
+            else
+            {
+                x.push_back(i);
+            }
+        }
+        s = x.memory_statistics();
+        benchmark::DoNotOptimize(x);
+    }
+    state.SetItemsProcessed(state.iterations() * n);
+    state.counters["rebuilds"]  = s.map_rebuilds;
+    state.counters["recenters"] = s.map_recenters;
+}
+
+// --------
+// pop_back
+// --------
+
+template <typename C>
+void BM_PopBack (benchmark::State& state)
+{
+    const int n = state.range(0);
+    for(auto _ : state)
+    {
+        state.PauseTiming();
+        C x = filled<C>(n);
+        state.ResumeTiming();
+        while(!x.empty())
+        {
+            x.pop_back();
+        }
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * n);
+}
+
+// ---------
+// pop_front
+// ---------
+
+template <typename C>
+void BM_PopFront (benchmark::State& state)
+{
+    const int n = state.range(0);
+    for(auto _ : state)
+    {
+        state.PauseTiming();
+        C x = filled<C>(n);
+        state.ResumeTiming();
+        while(!x.empty())
+        {
+            x.pop_front();
+        }
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * n);
+}
+
+// ----
+// fifo
+// ----
+
+/**
+ * steady-state queue: push at the back and pop at the front with n elements in flight
+ */
+template <typename C>
+void BM_FifoChurn (benchmark::State& state)
+{
+    const int n = state.range(0);
+    C x = filled<C>(n);
+    int i = 0;
+    for(auto _ : state)
+    {
+        x.push_back(make<typename C::value_type>(++i));
+        x.pop_front();
+    }
+    benchmark::DoNotOptimize(x);
+    state.SetItemsProcessed(state.iterations());
+}
+
+// -----------
+// random_read
+// -----------
+
+template <typename C>
+void BM_RandomIndex (benchmark::State& state)
+{
+    const int n = state.range(0);
+    C x = filled<C>(n);
+    vector<int> indices(4096);
+    srand(378);
+    for(std::size_t i = 0; i < indices.size(); ++i)
+    {
+        indices[i] = rand() % n;
+    }
+    for(auto _ : state)
+    {
+        int sum = 0;
+        for(std::size_t i = 0; i < indices.size(); ++i)
+        {
+            sum += value_of(x[indices[i]]);
+        }
+        benchmark::DoNotOptimize(sum);
+    }
+    state.SetItemsProcessed(state.iterations() * indices.size());
+}
+
+// -------
+// iterate
+// -------
+
+template <typename C>
+void BM_Iterate (benchmark::State& state)
+{
+    const int n = state.range(0);
+    const C x = filled<C>(n);
+    for(auto _ : state)
+    {
+        int sum = 0;
+        for(typename C::const_iterator it = x.begin(); it != x.end(); ++it)
+        {
+            sum += value_of(*it);
+        }
+        benchmark::DoNotOptimize(sum);
+    }
+    state.SetItemsProcessed(state.iterations() * n);
+}
+
+// --------------
+// middle_insert
+// --------------
+
+/**
+ * insert and then erase one element in the middle, so the size stays at n
+ */
+template <typename C>
+void BM_MiddleInsertErase (benchmark::State& state)
+{
+    const int n = state.range(0);
+    C x = filled<C>(n);
+    for(auto _ : state)
+    {
+        x.insert(x.begin() + n / 2, make<typename C::value_type>(0));
+        x.erase(x.begin() + n / 3);
+    }
+    benchmark::DoNotOptimize(x);
+    state.SetItemsProcessed(state.iterations() * 2);
+}
+
+// ----
+// copy
+// ----
+
+template <typename C>
+void BM_Copy (benchmark::State& state)
+{
+    const int n = state.range(0);
+    const C x = filled<C>(n);
+    for(auto _ : state)
+    {
+        C y(x);
+        benchmark::DoNotOptimize(y);
+    }
+    state.SetBytesProcessed(state.iterations() * n * sizeof(typename C::value_type));
+}
+
+// ------
+// assign
+// ------
+
+/**
+ * copy assignment into a container that already holds n elements
+ */
+template <typename C>
+void BM_Assign (benchmark::State& state)
+{
+    const int n = state.range(0);
+    const C x = filled<C>(n);
+    C y = filled<C>(n);
+    for(auto _ : state)
+    {
+        y = x;
+        benchmark::DoNotOptimize(y);
+    }
+    state.SetBytesProcessed(state.iterations() * n * sizeof(typename C::value_type));
+}
+
+// -----------
+// short_lived
+// -----------
+
+/**
+ * build, use and discard a small deque, as a request handler would
+ * Arena 0 is std::allocator, 1 a pooled DequeArena, 2 a monotonic DequeArena reset after every deque
+ */
+template <int Arena>
+void BM_ShortLived (benchmark::State& state)
+{
+    typedef MyDeque<int, DequeArenaAllocator<int> > arena_deque;
+    const int n = state.range(0);
+    DequeArena arena(arena_deque::block_size * sizeof(int), Arena == 2);
+    for(auto _ : state)
+    {
+        if(Arena == 0)
+        {
+            MyDeque<int> x;
+            for(int i = 0; i < n; ++i)
+            {
+                x.push_back(i);
+            }
+            benchmark::DoNotOptimize(x);
+        }
+        else
+        {
+            {
+                arena_deque x((DequeArenaAllocator<int>(arena)));
+                for(int i = 0; i < n; ++i)
+                {
+                    x.push_back(i);
+                }
+                benchmark::DoNotOptimize(x);
+            }
+            if(Arena == 2)
+            {
+                arena.reset();
+            }
+        }
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+// ----
+// simd
+// ----
+
+/**
+ * the segmented search and compare kernels at instruction set Level (0 scalar, 1 SSE2, 2 AVX2),
+ * capped at what the machine runs
+ */
+template <int Level>
+struct simd_level
+{
+    simd_level () : saved(deque_simd_level())
+    {
+        set_deque_simd_level(static_cast<deque_simd_isa>(Level));
+    }
+    ~simd_level ()
+    {
+        set_deque_simd_level(saved);
+    }
+    deque_simd_isa saved;
+};
+
+/**
+ * find a value that is not there, scanning all n ints
+ */
+template <int Level>
+void BM_Find (benchmark::State& state)
+{
+    simd_level<Level> level;
+    const int n = state.range(0);
+    const MyDeque<int> x = filled<MyDeque<int> >(n);
+    for(auto _ : state)
+    {
+        benchmark::DoNotOptimize(find(x.begin(), x.end(), -1));
+    }
+    state.SetBytesProcessed(state.iterations() * n * sizeof(int));
+}
+
+template <int Level>
+void BM_Count (benchmark::State& state)
+{
+    simd_level<Level> level;
+    const int n = state.range(0);
+    const MyDeque<int> x = filled<MyDeque<int> >(n);
+    for(auto _ : state)
+    {
+        benchmark::DoNotOptimize(count(x.begin(), x.end(), 7));
+    }
+    state.SetBytesProcessed(state.iterations() * n * sizeof(int));
+}
+
+/**
+ * == between two equal deques of n ints, offset so their blocks do not line up
+ */
+template <int Level>
+void BM_Equal (benchmark::State& state)
+{
+    simd_level<Level> level;
+    const int n = state.range(0);
+    const MyDeque<int> x = filled<MyDeque<int> >(n);
+    MyDeque<int> y = filled<MyDeque<int> >(n + 3);
+    y.pop_front();
+    y.pop_front();
+    y.pop_front();
+    std::copy(x.begin(), x.end(), y.begin());
+    for(auto _ : state)
+    {
+        benchmark::DoNotOptimize(x == y);
+    }
+    state.SetBytesProcessed(state.iterations() * n * sizeof(int));
+}
+
+/**
+ * min_element over n floats
+ */
+template <int Level>
+void BM_MinElement (benchmark::State& state)
+{
+    simd_level<Level> level;
+    const int n = state.range(0);
+    MyDeque<float> x;
+    for(int i = 0; i < n; ++i)
+    {
+        x.push_back(static_cast<float>((i * 7919) % 1000));
+    }
+    for(auto _ : state)
+    {
+        benchmark::DoNotOptimize(min_element(x.begin(), x.end()));
+    }
+    state.SetBytesProcessed(state.iterations() * n * sizeof(float));
+}
+
+// ------
+// reload
+// ------
+
+/**
+ * reload a checkpoint of n ints from the page cache and sum it
+ * Mode 0 reads element by element into push_back, 1 is read_snapshot, 2 maps it with MappedDeque
+ */
+template <int Mode>
+void BM_Reload (benchmark::State& state)
+{
+    const int n = state.range(0);
+    const char* path = "/tmp/DequeBench.snapshot";
+    {
+        ofstream out(path, ios::binary);
+        const MyDeque<int> x = filled<MyDeque<int> >(n);
+        if(Mode == 0)
+        {
+            for(int v : x)
+            {
+                out.write(reinterpret_cast<const char*>(&v), sizeof(v));
+            }
+        }
+        else
+        {
+            write_snapshot(out, x);
+        }
+    }
+    for(auto _ : state)
+    {
+        if(Mode == 2)
+        {
+            MappedDeque<int> m(path);
+            benchmark::DoNotOptimize(reduce(m.begin(), m.end(), 0));
+        }
+        else
+        {
+            ifstream in(path, ios::binary);
+            MyDeque<int> x;
+            if(Mode == 0)
+            {
+                int v;
+                while(in.read(reinterpret_cast<char*>(&v), sizeof(v)))
+                {
+                    x.push_back(v);
+                }
+            }
+            else
+            {
+                read_snapshot(in, x);
+            }
+            benchmark::DoNotOptimize(reduce(x.begin(), x.end(), 0));
+        }
+    }
+    remove(path);
+    state.SetBytesProcessed(state.iterations() * n * sizeof(int));
+}
+
+// ------------
+// registration
+// ------------
+
+#define DEQUE_BENCH_ARGS RangeMultiplier(16)->Range(16, 1 << 20)
+
+/**
+ * the operations every container supports
+ */
+#define DEQUE_BENCH_COMMON(C)                                                   \
+    BENCHMARK_TEMPLATE(BM_PushBack, C)->DEQUE_BENCH_ARGS;                       \
+    BENCHMARK_TEMPLATE(BM_PopBack, C)->DEQUE_BENCH_ARGS;                        \
+    BENCHMARK_TEMPLATE(BM_RandomIndex, C)->DEQUE_BENCH_ARGS;                    \
+    BENCHMARK_TEMPLATE(BM_Iterate, C)->DEQUE_BENCH_ARGS;                        \
+    BENCHMARK_TEMPLATE(BM_MiddleInsertErase, C)->RangeMultiplier(16)->Range(16, 1 << 16); \
+    BENCHMARK_TEMPLATE(BM_Copy, C)->DEQUE_BENCH_ARGS;                           \
+    BENCHMARK_TEMPLATE(BM_Assign, C)->DEQUE_BENCH_ARGS;
+
+/**
+ * the operations at the front, which std::vector does not have
+ */
+#define DEQUE_BENCH_FRONT(C)                                                    \
+    BENCHMARK_TEMPLATE(BM_PushFront, C)->DEQUE_BENCH_ARGS;                      \
+    BENCHMARK_TEMPLATE(BM_PopFront, C)->DEQUE_BENCH_ARGS;                       \
+    BENCHMARK_TEMPLATE(BM_FifoChurn, C)->DEQUE_BENCH_ARGS;
+
+#define DEQUE_BENCH_ALL(T)      \
+    DEQUE_BENCH_COMMON(MyDeque<T>) \
+    DEQUE_BENCH_FRONT(MyDeque<T>)  \
+    DEQUE_BENCH_COMMON(deque<T>)   \
+    DEQUE_BENCH_FRONT(deque<T>)    \
+    DEQUE_BENCH_COMMON(vector<T>)
+
+/**
+ * the cost of the tracing policy against the default, which should match MyDeque<int> exactly
+ */
+typedef MyDeque<int, allocator<int>, MyDeque<int>::block_size, deque_no_instrumentation> UntracedDeque;
+typedef MyDeque<int, allocator<int>, MyDeque<int>::block_size, deque_tracing<> >        TracedDeque;
+
+/**
+ * deques that mostly stay under the inline capacity
+ */
+typedef SmallDeque<int, 32> Small32Deque;
+
+/**
+ * the fixed ring against the block map for a steady queue
+ */
+typedef BoundedDeque<int, 1 << 14> BoundedIntDeque;
+
+typedef Payload<16>  Payload16;
+typedef Payload<64>  Payload64;
+typedef Payload<256> Payload256;
+
+DEQUE_BENCH_ALL(int)
+DEQUE_BENCH_ALL(Payload16)
+DEQUE_BENCH_ALL(Payload64)
+DEQUE_BENCH_ALL(Payload256)
+
+BENCHMARK_TEMPLATE(BM_MapGrowth, false)->RangeMultiplier(16)->Range(16, 1 << 20);
+BENCHMARK_TEMPLATE(BM_MapGrowth, true)->RangeMultiplier(16)->Range(16, 1 << 20);
+
+BENCHMARK_TEMPLATE(BM_PushBack, MyDeque<int>)->Arg(8)->Arg(32)->Arg(128);
+BENCHMARK_TEMPLATE(BM_PushBack, Small32Deque)->Arg(8)->Arg(32)->Arg(128);
+BENCHMARK_TEMPLATE(BM_FifoChurn, Small32Deque)->Arg(16);
+
+BENCHMARK_TEMPLATE(BM_FifoChurn, BoundedIntDeque)->RangeMultiplier(16)->Range(16, 4096);
+BENCHMARK_TEMPLATE(BM_Iterate, BoundedIntDeque)->RangeMultiplier(16)->Range(16, 4096);
+
+BENCHMARK_TEMPLATE(BM_MiddleInsertErase, TieredDeque<int>)->RangeMultiplier(16)->Range(16, 1 << 20);
+BENCHMARK_TEMPLATE(BM_RandomIndex, TieredDeque<int>)->RangeMultiplier(16)->Range(16, 1 << 20);
+BENCHMARK_TEMPLATE(BM_Iterate, TieredDeque<int>)->RangeMultiplier(16)->Range(16, 1 << 20);
+BENCHMARK_TEMPLATE(BM_PushBack, TieredDeque<int>)->RangeMultiplier(16)->Range(16, 1 << 20);
+DEQUE_BENCH_FRONT(TieredDeque<int>)
+
+DEQUE_BENCH_FRONT(UntracedDeque)
+DEQUE_BENCH_FRONT(TracedDeque)
+
+BENCHMARK_TEMPLATE(BM_ShortLived, 0)->RangeMultiplier(16)->Range(16, 1 << 16);
+BENCHMARK_TEMPLATE(BM_ShortLived, 1)->RangeMultiplier(16)->Range(16, 1 << 16);
+BENCHMARK_TEMPLATE(BM_ShortLived, 2)->RangeMultiplier(16)->Range(16, 1 << 16);
+
+#define DEQUE_BENCH_SIMD(Level)                                                 \
+    BENCHMARK_TEMPLATE(BM_Find, Level)->RangeMultiplier(64)->Range(64, 1 << 20);   \
+    BENCHMARK_TEMPLATE(BM_Count, Level)->RangeMultiplier(64)->Range(64, 1 << 20);  \
+    BENCHMARK_TEMPLATE(BM_Equal, Level)->RangeMultiplier(64)->Range(64, 1 << 20);  \
+    BENCHMARK_TEMPLATE(BM_MinElement, Level)->RangeMultiplier(64)->Range(64, 1 << 20);
+
+DEQUE_BENCH_SIMD(0)
+DEQUE_BENCH_SIMD(1)
+DEQUE_BENCH_SIMD(2)
+
+BENCHMARK_TEMPLATE(BM_Reload, 0)->RangeMultiplier(64)->Range(1 << 10, 1 << 22);
+BENCHMARK_TEMPLATE(BM_Reload, 1)->RangeMultiplier(64)->Range(1 << 10, 1 << 22);
+BENCHMARK_TEMPLATE(BM_Reload, 2)->RangeMultiplier(64)->Range(1 << 10, 1 << 22);
+
+BENCHMARK_MAIN();
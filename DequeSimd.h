@@ -0,0 +1,467 @@
+// --------------------------
+// projects/deque/DequeSimd.h
+// --------------------------
+
+#ifndef DequeSimd_h
+#define DequeSimd_h
+
+// --------
+// includes
+// --------
+
+#include <algorithm>   // find, count, min_element, max_element, mismatch
+#include <atomic>      // atomic, memory_order_relaxed
+#include <cstddef>     // size_t
+#include <type_traits> // false_type, integral_constant, is_same, remove_cv, remove_pointer, true_type
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__)) && defined(__SSE2__)
+#define DEQUE_SIMD 1
+#include <immintrin.h>
+#endif
+
+// --------------
+// deque_simd_isa
+// --------------
+
+/**
+ * the instruction sets the kernels are written for, in increasing order
+ */
+enum deque_simd_isa {
+    deque_isa_scalar,
+    deque_isa_sse2,
+    deque_isa_avx2};
+
+// ---------------
+// deque_simd_type
+// ---------------
+
+/**
+ * the element types with vector kernels
+ */
+template <typename T>
+struct deque_simd_type : std::false_type {};
+
+template <>
+struct deque_simd_type<int> : std::true_type {};
+
+template <>
+struct deque_simd_type<float> : std::true_type {};
+
+template <>
+struct deque_simd_type<double> : std::true_type {};
+
+#ifdef DEQUE_SIMD
+
+// ---------------
+// deque_simd_sse2
+// ---------------
+
+namespace deque_simd_sse2 {
+
+/**
+ * @return the number of set bits in m, without the popcnt instruction SSE2 does not promise
+ */
+inline unsigned count_bits (unsigned m) {
+    m = m - ((m >> 1) & 0x55555555u);
+    m = (m & 0x33333333u) + ((m >> 2) & 0x33333333u);
+    return (((m + (m >> 4)) & 0x0f0f0f0fu) * 0x01010101u) >> 24;}
+
+template <typename T>
+struct lanes;
+
+template <>
+struct lanes<int> {
+    typedef __m128i reg;
+    static const std::size_t width = 4;
+    static reg load (const int* p) {
+        return _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));}
+    static void store (int* p, reg a) {
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(p), a);}
+    static reg set1 (int v) {
+        return _mm_set1_epi32(v);}
+    static unsigned eq (reg a, reg b) {
+        return _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(a, b)));}
+    static reg add (reg a, reg b) {
+        return _mm_add_epi32(a, b);}
+    // SSE2 has no 32-bit min and max: select through the comparison mask
+    static reg min (reg a, reg b) {
+        reg lt = _mm_cmplt_epi32(a, b);
+        return _mm_or_si128(_mm_and_si128(lt, a), _mm_andnot_si128(lt, b));}
+    static reg max (reg a, reg b) {
+        reg gt = _mm_cmpgt_epi32(a, b);
+        return _mm_or_si128(_mm_and_si128(gt, a), _mm_andnot_si128(gt, b));}};
+
+template <>
+struct lanes<float> {
+    typedef __m128 reg;
+    static const std::size_t width = 4;
+    static reg load (const float* p) {
+        return _mm_loadu_ps(p);}
+    static void store (float* p, reg a) {
+        _mm_storeu_ps(p, a);}
+    static reg set1 (float v) {
+        return _mm_set1_ps(v);}
+    static unsigned eq (reg a, reg b) {
+        return _mm_movemask_ps(_mm_cmpeq_ps(a, b));}
+    static reg add (reg a, reg b) {
+        return _mm_add_ps(a, b);}
+    static reg min (reg a, reg b) {
+        return _mm_min_ps(a, b);}
+    static reg max (reg a, reg b) {
+        return _mm_max_ps(a, b);}};
+
+template <>
+struct lanes<double> {
+    typedef __m128d reg;
+    static const std::size_t width = 2;
+    static reg load (const double* p) {
+        return _mm_loadu_pd(p);}
+    static void store (double* p, reg a) {
+        _mm_storeu_pd(p, a);}
+    static reg set1 (double v) {
+        return _mm_set1_pd(v);}
+    static unsigned eq (reg a, reg b) {
+        return _mm_movemask_pd(_mm_cmpeq_pd(a, b));}
+    static reg add (reg a, reg b) {
+        return _mm_add_pd(a, b);}
+    static reg min (reg a, reg b) {
+        return _mm_min_pd(a, b);}
+    static reg max (reg a, reg b) {
+        return _mm_max_pd(a, b);}};
+
+#include "DequeSimdKernels.h"
+
+} // deque_simd_sse2
+
+// ---------------
+// deque_simd_avx2
+// ---------------
+
+#if defined(__clang__)
+#pragma clang attribute push (__attribute__((target("avx2,popcnt"))), apply_to = function)
+#else
+#pragma GCC push_options
+#pragma GCC target("avx2,popcnt")
+#endif
+
+namespace deque_simd_avx2 {
+
+// every processor with AVX2 has popcnt
+inline unsigned count_bits (unsigned m) {
+    return __builtin_popcount(m);}
+
+template <typename T>
+struct lanes;
+
+template <>
+struct lanes<int> {
+    typedef __m256i reg;
+    static const std::size_t width = 8;
+    static reg load (const int* p) {
+        return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));}
+    static void store (int* p, reg a) {
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(p), a);}
+    static reg set1 (int v) {
+        return _mm256_set1_epi32(v);}
+    static unsigned eq (reg a, reg b) {
+        return _mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpeq_epi32(a, b)));}
+    static reg add (reg a, reg b) {
+        return _mm256_add_epi32(a, b);}
+    static reg min (reg a, reg b) {
+        return _mm256_min_epi32(a, b);}
+    static reg max (reg a, reg b) {
+        return _mm256_max_epi32(a, b);}};
+
+template <>
+struct lanes<float> {
+    typedef __m256 reg;
+    static const std::size_t width = 8;
+    static reg load (const float* p) {
+        return _mm256_loadu_ps(p);}
+    static void store (float* p, reg a) {
+        _mm256_storeu_ps(p, a);}
+    static reg set1 (float v) {
+        return _mm256_set1_ps(v);}
+    static unsigned eq (reg a, reg b) {
+        return _mm256_movemask_ps(_mm256_cmp_ps(a, b, _CMP_EQ_OQ));}
+    static reg add (reg a, reg b) {
+        return _mm256_add_ps(a, b);}
+    static reg min (reg a, reg b) {
+        return _mm256_min_ps(a, b);}
+    static reg max (reg a, reg b) {
+        return _mm256_max_ps(a, b);}};
+
+template <>
+struct lanes<double> {
+    typedef __m256d reg;
+    static const std::size_t width = 4;
+    static reg load (const double* p) {
+        return _mm256_loadu_pd(p);}
+    static void store (double* p, reg a) {
+        _mm256_storeu_pd(p, a);}
+    static reg set1 (double v) {
+        return _mm256_set1_pd(v);}
+    static unsigned eq (reg a, reg b) {
+        return _mm256_movemask_pd(_mm256_cmp_pd(a, b, _CMP_EQ_OQ));}
+    static reg add (reg a, reg b) {
+        return _mm256_add_pd(a, b);}
+    static reg min (reg a, reg b) {
+        return _mm256_min_pd(a, b);}
+    static reg max (reg a, reg b) {
+        return _mm256_max_pd(a, b);}};
+
+#include "DequeSimdKernels.h"
+
+} // deque_simd_avx2
+
+#if defined(__clang__)
+#pragma clang attribute pop
+#else
+#pragma GCC pop_options
+#endif
+
+#endif // DEQUE_SIMD
+
+// -----------------
+// deque_simd_detect
+// -----------------
+
+/**
+ * @return the best instruction set this processor runs
+ */
+inline deque_simd_isa deque_simd_detect () {
+#ifdef DEQUE_SIMD
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2") ? deque_isa_avx2 : deque_isa_sse2;
+#else
+    return deque_isa_scalar;
+#endif
+    }
+
+// -------------------
+// deque_simd_detected
+// -------------------
+
+/**
+ * @return deque_simd_detect, run once
+ */
+inline deque_simd_isa deque_simd_detected () {
+    static const deque_simd_isa detected = deque_simd_detect();
+    return detected;}
+
+// ----------------
+// deque_simd_level
+// ----------------
+
+inline std::atomic<int>& deque_simd_level_storage () {
+    static std::atomic<int> level(deque_simd_detected());
+    return level;}
+
+/**
+ * @return the instruction set the kernels use; each dispatch reads it once, so a change made
+ * while kernels run takes effect from their next span
+ */
+inline deque_simd_isa deque_simd_level () {
+    return static_cast<deque_simd_isa>(deque_simd_level_storage().load(std::memory_order_relaxed));}
+
+/**
+ * choose the instruction set the kernels use (to compare the paths, or to keep AVX2 off a
+ * machine that throttles under it); safe to call while other threads run kernels
+ * @param level the wanted instruction set, lowered to what deque_simd_detect reports
+ * @return the instruction set now in use
+ */
+inline deque_simd_isa set_deque_simd_level (deque_simd_isa level) {
+    if (level > deque_simd_detected())
+        level = deque_simd_detected();
+    deque_simd_level_storage().store(level, std::memory_order_relaxed);
+    return level;}
+
+// ---------------
+// deque_simd_pick
+// ---------------
+
+/**
+ * whether a kernel can stand in for the std algorithm on P (a possibly const T*) and value type U
+ */
+template <typename P, typename U = typename std::remove_cv<typename std::remove_pointer<P>::type>::type>
+struct deque_simd_pick :
+        std::integral_constant<bool,
+            deque_simd_type<typename std::remove_cv<typename std::remove_pointer<P>::type>::type>::value &&
+            std::is_same<typename std::remove_cv<typename std::remove_pointer<P>::type>::type, U>::value> {};
+
+// the kernels behind MyDeque's segmented algorithms: each takes one contiguous span [p, q)
+// of a block, runs the vector kernel for the current deque_simd_level when the element type
+// has one, and the std algorithm otherwise
+
+// ----------
+// deque_find
+// ----------
+
+template <typename P, typename U>
+P deque_find (P p, P q, const U& v, std::false_type) {
+    return std::find(p, q, v);}
+
+template <typename P, typename U>
+P deque_find (P p, P q, const U& v, std::true_type) {
+#ifdef DEQUE_SIMD
+    const deque_simd_isa level = deque_simd_level();
+    if (level == deque_isa_avx2)
+        return p + (deque_simd_avx2::find<U>(p, q, v) - p);
+    if (level == deque_isa_sse2)
+        return p + (deque_simd_sse2::find<U>(p, q, v) - p);
+#endif
+    return std::find(p, q, v);}
+
+/**
+ * @return the first p in [p, q) equal to v, or q
+ */
+template <typename P, typename U>
+P deque_find (P p, P q, const U& v) {
+    return deque_find(p, q, v, deque_simd_pick<P, U>());}
+
+// -----------
+// deque_count
+// -----------
+
+template <typename P, typename U>
+std::size_t deque_count (P p, P q, const U& v, std::false_type) {
+    return std::count(p, q, v);}
+
+template <typename P, typename U>
+std::size_t deque_count (P p, P q, const U& v, std::true_type) {
+#ifdef DEQUE_SIMD
+    const deque_simd_isa level = deque_simd_level();
+    if (level == deque_isa_avx2)
+        return deque_simd_avx2::count<U>(p, q, v);
+    if (level == deque_isa_sse2)
+        return deque_simd_sse2::count<U>(p, q, v);
+#endif
+    return std::count(p, q, v);}
+
+/**
+ * @return the number of elements of [p, q) equal to v
+ */
+template <typename P, typename U>
+std::size_t deque_count (P p, P q, const U& v) {
+    return deque_count(p, q, v, deque_simd_pick<P, U>());}
+
+// --------------
+// deque_mismatch
+// --------------
+
+template <typename P, typename R>
+P deque_mismatch (P p, P q, R r, std::false_type) {
+    return std::mismatch(p, q, r).first;}
+
+template <typename P, typename R>
+P deque_mismatch (P p, P q, R r, std::true_type) {
+#ifdef DEQUE_SIMD
+    const deque_simd_isa level = deque_simd_level();
+    if (level == deque_isa_avx2)
+        return p + deque_simd_avx2::mismatch(p, q, r);
+    if (level == deque_isa_sse2)
+        return p + deque_simd_sse2::mismatch(p, q, r);
+#endif
+    return std::mismatch(p, q, r).first;}
+
+/**
+ * @return the first p in [p, q) that differs (by ==) from its counterpart at r, or q
+ */
+template <typename P, typename R>
+P deque_mismatch (P p, P q, R r) {
+    return deque_mismatch(p, q, r, deque_simd_pick<P, typename std::remove_cv<typename std::remove_pointer<R>::type>::type>());}
+
+// -----------------
+// deque_min_element
+// -----------------
+
+template <typename P>
+P deque_min_element (P p, P q, std::false_type) {
+    return std::min_element(p, q);}
+
+/**
+ * the vector minimum, then the first element equal to it; a range holding a NaN has no
+ * strict weak order, so whatever the search misses is left to the std algorithm
+ */
+template <typename P>
+P deque_min_element (P p, P q, std::true_type) {
+    typedef typename std::remove_cv<typename std::remove_pointer<P>::type>::type value_type;
+    if (p == q)
+        return q;
+#ifdef DEQUE_SIMD
+    const deque_simd_isa level = deque_simd_level();
+    if (level != deque_isa_scalar) {
+        value_type v = (level == deque_isa_avx2) ? deque_simd_avx2::min<value_type>(p, q) : deque_simd_sse2::min<value_type>(p, q);
+        P r = deque_find(p, q, v);
+        if (r != q)
+            return r;}
+#endif
+    return std::min_element(p, q);}
+
+/**
+ * @return the first smallest element of [p, q), or q if it is empty
+ */
+template <typename P>
+P deque_min_element (P p, P q) {
+    return deque_min_element(p, q, deque_simd_pick<P>());}
+
+// -----------------
+// deque_max_element
+// -----------------
+
+template <typename P>
+P deque_max_element (P p, P q, std::false_type) {
+    return std::max_element(p, q);}
+
+template <typename P>
+P deque_max_element (P p, P q, std::true_type) {
+    typedef typename std::remove_cv<typename std::remove_pointer<P>::type>::type value_type;
+    if (p == q)
+        return q;
+#ifdef DEQUE_SIMD
+    const deque_simd_isa level = deque_simd_level();
+    if (level != deque_isa_scalar) {
+        value_type v = (level == deque_isa_avx2) ? deque_simd_avx2::max<value_type>(p, q) : deque_simd_sse2::max<value_type>(p, q);
+        P r = deque_find(p, q, v);
+        if (r != q)
+            return r;}
+#endif
+    return std::max_element(p, q);}
+
+/**
+ * @return the first largest element of [p, q), or q if it is empty
+ */
+template <typename P>
+P deque_max_element (P p, P q) {
+    return deque_max_element(p, q, deque_simd_pick<P>());}
+
+// ---------
+// deque_sum
+// ---------
+
+template <typename P, typename U>
+U deque_sum (P p, P q, U init, std::false_type) {
+    for (; p != q; ++p)
+        init = init + *p;
+    return init;}
+
+template <typename P, typename U>
+U deque_sum (P p, P q, U init, std::true_type) {
+#ifdef DEQUE_SIMD
+    const deque_simd_isa level = deque_simd_level();
+    if (level == deque_isa_avx2)
+        return init + deque_simd_avx2::sum<U>(p, q);
+    if (level == deque_isa_sse2)
+        return init + deque_simd_sse2::sum<U>(p, q);
+#endif
+    return deque_sum(p, q, init, std::false_type());}
+
+/**
+ * @return init plus the elements of [p, q), grouped arbitrarily (floating-point sums may round
+ * differently from a left-to-right loop)
+ */
+template <typename P, typename U>
+U deque_sum (P p, P q, U init) {
+    return deque_sum(p, q, init, deque_simd_pick<P, U>());}
+
+#endif // DequeSimd_h
@@ -0,0 +1,146 @@
+// ----------------------------------
+// projects/deque/DequeSimdKernels.h
+// ----------------------------------
+
+// no include guard: DequeSimd.h includes this once per instruction set, inside a namespace
+// that already defines lanes<T> for that instruction set and under its target pragma
+// lanes<T> provides
+//   reg, width        the register type and the number of T in it
+//   load, store, set1 unaligned moves and a broadcast
+//   eq(a, b)          one bit per lane, set where a == b
+//   add, min, max     lane-wise arithmetic
+// and the namespace provides count_bits(m), the number of set bits in a word
+
+// ----
+// find
+// ----
+
+/**
+ * @return the first p in [p, q) with *p == v, or q
+ */
+template <typename T>
+const T* find (const T* p, const T* q, T v) {
+    typedef lanes<T> L;
+    const typename L::reg needle = L::set1(v);
+    for (; static_cast<std::size_t>(q - p) >= L::width; p += L::width) {
+        unsigned m = L::eq(L::load(p), needle);
+        if (m)
+            return p + __builtin_ctz(m);}
+    for (; p != q; ++p)
+        if (*p == v)
+            return p;
+    return q;}
+
+// -----
+// count
+// -----
+
+/**
+ * @return the number of elements of [p, q) equal to v
+ */
+template <typename T>
+std::size_t count (const T* p, const T* q, T v) {
+    typedef lanes<T> L;
+    const typename L::reg needle = L::set1(v);
+    std::size_t n = 0;
+    // four lane masks side by side make one word, counted at once
+    for (; static_cast<std::size_t>(q - p) >= 4 * L::width; p += 4 * L::width)
+        n += count_bits(
+            L::eq(L::load(p),                needle)                    |
+            L::eq(L::load(p +     L::width), needle) <<      L::width   |
+            L::eq(L::load(p + 2 * L::width), needle) << (2 * L::width)  |
+            L::eq(L::load(p + 3 * L::width), needle) << (3 * L::width));
+    for (; static_cast<std::size_t>(q - p) >= L::width; p += L::width)
+        n += count_bits(L::eq(L::load(p), needle));
+    for (; p != q; ++p)
+        n += (*p == v);
+    return n;}
+
+// --------
+// mismatch
+// --------
+
+/**
+ * @return the offset of the first element of [p, q) that differs from its counterpart at r, or q - p
+ */
+template <typename T>
+std::size_t mismatch (const T* p, const T* q, const T* r) {
+    typedef lanes<T> L;
+    const unsigned all = (1u << L::width) - 1;
+    const std::size_t n = q - p;
+    std::size_t i = 0;
+    for (; n - i >= L::width; i += L::width) {
+        unsigned m = L::eq(L::load(p + i), L::load(r + i));
+        if (m != all)
+            return i + __builtin_ctz(~m);}
+    for (; i != n; ++i)
+        if (!(p[i] == r[i]))
+            return i;
+    return n;}
+
+// ----------
+// fold_lanes
+// ----------
+
+/**
+ * spill a register and fold its lanes with f
+ */
+template <typename T, typename F>
+T fold_lanes (typename lanes<T>::reg a, F f) {
+    T spill[lanes<T>::width];
+    lanes<T>::store(spill, a);
+    T x = spill[0];
+    for (std::size_t i = 1; i != lanes<T>::width; ++i)
+        x = f(x, spill[i]);
+    return x;}
+
+// -------
+// min/max
+// -------
+
+/**
+ * @return the smallest value of the non-empty [p, q); the last vector overlaps the one before it
+ */
+template <typename T>
+T min (const T* p, const T* q) {
+    typedef lanes<T> L;
+    if (static_cast<std::size_t>(q - p) < L::width) {
+        T x = *p;
+        for (++p; p != q; ++p)
+            x = (*p < x) ? *p : x;
+        return x;}
+    typename L::reg a = L::load(q - L::width);
+    for (; static_cast<std::size_t>(q - p) >= L::width; p += L::width)
+        a = L::min(a, L::load(p));
+    return fold_lanes<T>(a, [] (T x, T y) {return (y < x) ? y : x;});}
+
+template <typename T>
+T max (const T* p, const T* q) {
+    typedef lanes<T> L;
+    if (static_cast<std::size_t>(q - p) < L::width) {
+        T x = *p;
+        for (++p; p != q; ++p)
+            x = (x < *p) ? *p : x;
+        return x;}
+    typename L::reg a = L::load(q - L::width);
+    for (; static_cast<std::size_t>(q - p) >= L::width; p += L::width)
+        a = L::max(a, L::load(p));
+    return fold_lanes<T>(a, [] (T x, T y) {return (x < y) ? y : x;});}
+
+// ---
+// sum
+// ---
+
+/**
+ * @return the sum of [p, q), added in width interleaved running sums
+ */
+template <typename T>
+T sum (const T* p, const T* q) {
+    typedef lanes<T> L;
+    typename L::reg a = L::set1(T());
+    for (; static_cast<std::size_t>(q - p) >= L::width; p += L::width)
+        a = L::add(a, L::load(p));
+    T x = fold_lanes<T>(a, [] (T x, T y) {return x + y;});
+    for (; p != q; ++p)
+        x += *p;
+    return x;}
@@ -0,0 +1,391 @@
+// ------------------------------
+// projects/deque/DequeSnapshot.h
+// ------------------------------
+
+#ifndef DequeSnapshot_h
+#define DequeSnapshot_h
+
+// --------
+// includes
+// --------
+
+#include <cassert>      // assert
+#include <cerrno>       // errno
+#include <cstddef>      // ptrdiff_t, size_t
+#include <cstdint>      // uint32_t, uint64_t
+#include <cstring>      // memcmp, memcpy
+#include <ios>          // ios
+#include <istream>      // istream
+#include <limits>       // numeric_limits
+#include <memory>       // allocator, allocator_traits
+#include <ostream>      // ostream
+#include <stdexcept>    // out_of_range, runtime_error
+#include <system_error> // generic_category, system_error
+#include <type_traits>  // is_trivially_copyable
+#include <utility>      // move, swap
+#include <vector>       // vector
+
+#include <fcntl.h>    // open
+#include <sys/mman.h> // mmap, munmap
+#include <sys/stat.h> // fstat
+#include <unistd.h>   // close
+
+#include "Deque.h"
+
+// ---------------------
+// deque_snapshot_header
+// ---------------------
+
+/**
+ * the first 64 bytes of a snapshot; the blocks follow, each block_size elements, the first
+ * starting begin_offset elements before the front and the last padded to a whole block,
+ * unused slots zeroed
+ * the layout is the writing machine's (byte order, sizeof(T)): a snapshot is a restart file,
+ * not an interchange format
+ */
+struct deque_snapshot_header {
+    char          magic[8];
+    std::uint32_t version;
+    std::uint32_t element_size;
+    std::uint64_t block_size;
+    std::uint64_t size;
+    std::uint64_t begin_offset;
+    std::uint64_t reserved[3];
+
+    static const std::uint32_t current_version = 1;
+
+    static const char* expected_magic () {
+        return "MyDeque";}
+
+    /**
+     * @return the number of blocks behind the elements
+     */
+    std::uint64_t blocks () const {
+        return (begin_offset + size + block_size - 1) / block_size;}
+
+    /**
+     * @throws runtime_error unless this is a version 1 header for elements of element bytes,
+     * with a size and layout whose block count does not overflow
+     */
+    void check (std::size_t element) const {
+        if (std::memcmp(magic, expected_magic(), sizeof(magic)) != 0)
+            throw std::runtime_error("deque snapshot: bad magic");
+        if (version != current_version)
+            throw std::runtime_error("deque snapshot: unknown version");
+        if (element_size != element)
+            throw std::runtime_error("deque snapshot: element size mismatch");
+        if ((block_size == 0) || (begin_offset >= block_size))
+            throw std::runtime_error("deque snapshot: bad block layout");
+        //blocks() adds size to begin_offset + block_size - 1, which must not wrap
+        if (size > std::numeric_limits<std::uint64_t>::max() - begin_offset - block_size)
+            throw std::runtime_error("deque snapshot: bad size");
+        if (size > blocks() * block_size - begin_offset)
+            throw std::runtime_error("deque snapshot: bad size");}};
+
+static_assert(sizeof(deque_snapshot_header) == 64, "deque_snapshot_header must stay 64 bytes");
+
+// -----------
+// write_zeros
+// -----------
+
+/**
+ * write n zero bytes, the padding around the used part of the first and last blocks
+ */
+inline void write_zeros (std::ostream& out, std::size_t n) {
+    static const char zeros[512] = {};
+    for (; n > sizeof(zeros); n -= sizeof(zeros))
+        out.write(zeros, sizeof(zeros));
+    out.write(zeros, n);}
+
+// --------------
+// write_snapshot
+// --------------
+
+/**
+ * write x's blocks as they sit in memory, behind a deque_snapshot_header
+ * @param out a binary stream
+ * @param x a MyDeque of trivially copyable elements
+ * @return out
+ */
+template <typename T, typename A, std::size_t B, typename P>
+std::ostream& write_snapshot (std::ostream& out, const MyDeque<T, A, B, P>& x) {
+    static_assert(std::is_trivially_copyable<T>::value, "snapshots hold trivially copyable elements");
+    deque_snapshot_header h = {};
+    std::memcpy(h.magic, deque_snapshot_header::expected_magic(), sizeof(h.magic));
+    h.version      = deque_snapshot_header::current_version;
+    h.element_size = sizeof(T);
+    h.block_size   = B;
+    h.size         = x.size();
+    h.begin_offset = x.empty() ? 0 : x.begin().get_block_index();
+    out.write(reinterpret_cast<const char*>(&h), sizeof(h));
+    write_zeros(out, h.begin_offset * sizeof(T));
+    for_each_segment(x.begin(), x.end(), [&out] (const T* p, const T* q) {
+        out.write(reinterpret_cast<const char*>(p), (q - p) * sizeof(T));});
+    write_zeros(out, (h.blocks() * B - h.begin_offset - h.size) * sizeof(T));
+    return out;}
+
+// -------------
+// read_snapshot
+// -------------
+
+/**
+ * replace x's elements with a snapshot's, read a block span at a time straight into x;
+ * x's block size need not match the snapshot's
+ * @param in a binary stream positioned at a snapshot, left just past it
+ * @param x a MyDeque of the same trivially copyable element type
+ * @return in
+ * @throws runtime_error if the snapshot is malformed or cut short
+ */
+template <typename T, typename A, std::size_t B, typename P>
+std::istream& read_snapshot (std::istream& in, MyDeque<T, A, B, P>& x) {
+    static_assert(std::is_trivially_copyable<T>::value, "snapshots hold trivially copyable elements");
+    deque_snapshot_header h;
+    if (!in.read(reinterpret_cast<char*>(&h), sizeof(h)))
+        throw std::runtime_error("deque snapshot: truncated header");
+    h.check(sizeof(T));
+    //refuse a size the blocks cannot hold before resize tries to allocate it
+    if (h.size > std::allocator_traits<A>::max_size(x.get_allocator()))
+        throw std::runtime_error("deque snapshot: bad size");
+    const std::istream::pos_type here = in.tellg();
+    if (here != std::istream::pos_type(-1)) {
+        in.seekg(0, std::ios::end);
+        const std::uint64_t left = static_cast<std::uint64_t>(in.tellg() - here);
+        in.seekg(here);
+        if (left / sizeof(T) / h.block_size < h.blocks())
+            throw std::runtime_error("deque snapshot: truncated blocks");}
+    x.clear();
+    x.resize(h.size);
+    in.ignore(h.begin_offset * sizeof(T));
+    for_each_segment(x.begin(), x.end(), [&in] (T* p, T* q) {
+        in.read(reinterpret_cast<char*>(p), (q - p) * sizeof(T));});
+    in.ignore((h.blocks() * h.block_size - h.begin_offset - h.size) * sizeof(T));
+    if (!in)
+        throw std::runtime_error("deque snapshot: truncated blocks");
+    return in;}
+
+// -----------
+// MappedDeque
+// -----------
+
+/**
+ * read-only view of a snapshot file, mapped rather than read: opening costs a page-table setup
+ * and one pointer per block, and pages load as they are touched
+ * iterators are MyDeque's const_iterator over the mapped blocks, so the segmented algorithms
+ * (find, count, equal, copy, ...) run on it unchanged
+ * the snapshot's block size must be B
+ */
+template <typename T, std::size_t B = deque_block_size<T>::value>
+class MappedDeque {
+    static_assert(std::is_trivially_copyable<T>::value, "snapshots hold trivially copyable elements");
+    static_assert(alignof(T) <= sizeof(deque_snapshot_header), "the blocks are aligned to the header size");
+
+    public:
+        // ---------
+        // constants
+        // ---------
+
+        static const std::size_t block_size = B;
+
+        // --------
+        // typedefs
+        // --------
+
+        typedef T              value_type;
+        typedef std::size_t    size_type;
+        typedef std::ptrdiff_t difference_type;
+        typedef const T&       const_reference;
+        typedef const T&       reference;
+
+        typedef typename MyDeque<T, std::allocator<T>, B>::const_iterator const_iterator;
+        typedef const_iterator                                            iterator;
+
+    private:
+        // ----
+        // data
+        // ----
+
+        void*           _mapping;
+        std::size_t     _bytes;
+        std::size_t     _size;
+        std::size_t     _offset;
+        std::vector<const T*> _blocks;
+
+    public:
+        // ------------
+        // constructors
+        // ------------
+
+        /**
+         * map the snapshot at path
+         * @throws system_error if the file cannot be opened or mapped
+         * @throws runtime_error if it is not a snapshot of T with block size B
+         */
+        explicit MappedDeque (const char* path) :
+                _mapping(0),
+                _bytes(0),
+                _size(0),
+                _offset(0) {
+            int fd = ::open(path, O_RDONLY);
+            if (fd == -1)
+                throw std::system_error(errno, std::generic_category(), path);
+            struct stat st;
+            if (::fstat(fd, &st) == -1) {
+                int e = errno;
+                ::close(fd);
+                throw std::system_error(e, std::generic_category(), path);}
+            _bytes = st.st_size;
+            if (_bytes < sizeof(deque_snapshot_header)) {
+                ::close(fd);
+                throw std::runtime_error("deque snapshot: truncated header");}
+            _mapping = ::mmap(0, _bytes, PROT_READ, MAP_PRIVATE, fd, 0);
+            int e = errno;
+            ::close(fd);
+            if (_mapping == MAP_FAILED) {
+                _mapping = 0;
+                throw std::system_error(e, std::generic_category(), path);}
+            try {
+                index();}
+            catch (...) {
+                ::munmap(_mapping, _bytes);
+                throw;}}
+
+        MappedDeque (MappedDeque&& rhs) noexcept :
+                _mapping(rhs._mapping),
+                _bytes(rhs._bytes),
+                _size(rhs._size),
+                _offset(rhs._offset),
+                _blocks(std::move(rhs._blocks)) {
+            rhs._mapping = 0;
+            rhs._bytes   = 0;
+            rhs._size    = 0;
+            rhs._offset  = 0;
+            rhs._blocks.clear();}
+
+        MappedDeque (const MappedDeque&)             = delete;
+        MappedDeque& operator = (const MappedDeque&) = delete;
+
+        MappedDeque& operator = (MappedDeque&& rhs) noexcept {
+            MappedDeque that(std::move(rhs));
+            swap(that);
+            return *this;}
+
+        ~MappedDeque () {
+            if (_mapping)
+                ::munmap(_mapping, _bytes);}
+
+        // -----------
+        // operator []
+        // -----------
+
+        /**
+         * @param index a position in [0, size())
+         * @return the element there
+         */
+        const_reference operator [] (size_type index) const {
+            assert(index < _size);
+            index += _offset;
+            return _blocks[index / B][index % B];}
+
+        // --
+        // at
+        // --
+
+        /**
+         * @throws out_of_range if index is not in [0, size())
+         */
+        const_reference at (size_type index) const {
+            if (index >= _size)
+                throw std::out_of_range("MappedDeque::at index out of range");
+            return (*this)[index];}
+
+        // -----
+        // front
+        // -----
+
+        const_reference front () const {
+            assert(!empty());
+            return (*this)[0];}
+
+        // ----
+        // back
+        // ----
+
+        const_reference back () const {
+            assert(!empty());
+            return (*this)[_size - 1];}
+
+        // -----
+        // begin
+        // -----
+
+        const_iterator begin () const {
+            return const_iterator(const_cast<const T**>(_blocks.data()), _offset);}
+
+        const_iterator cbegin () const {
+            return begin();}
+
+        // ---
+        // end
+        // ---
+
+        const_iterator end () const {
+            return begin() + _size;}
+
+        const_iterator cend () const {
+            return end();}
+
+        // -----
+        // empty
+        // -----
+
+        bool empty () const {
+            return _size == 0;}
+
+        // ----
+        // size
+        // ----
+
+        size_type size () const {
+            return _size;}
+
+        // ----
+        // swap
+        // ----
+
+        void swap (MappedDeque& rhs) noexcept {
+            std::swap(_mapping, rhs._mapping);
+            std::swap(_bytes,   rhs._bytes);
+            std::swap(_size,    rhs._size);
+            std::swap(_offset,  rhs._offset);
+            _blocks.swap(rhs._blocks);}
+
+    private:
+        // -----
+        // index
+        // -----
+
+        /**
+         * check the header against T, B and the file length, then point _blocks at the blocks,
+         * plus one past the last so end() has a block to sit on
+         */
+        void index () {
+            const char* base = static_cast<const char*>(_mapping);
+            deque_snapshot_header h;
+            std::memcpy(&h, base, sizeof(h));
+            h.check(sizeof(T));
+            if (h.block_size != B)
+                throw std::runtime_error("deque snapshot: block size mismatch");
+            const std::uint64_t blocks = h.blocks();
+            if ((_bytes - sizeof(h)) / (B * sizeof(T)) < blocks)
+                throw std::runtime_error("deque snapshot: truncated blocks");
+            const T* first = reinterpret_cast<const T*>(base + sizeof(h));
+            _blocks.reserve(blocks + 1);
+            for (std::uint64_t i = 0; i <= blocks; ++i)
+                _blocks.push_back(first + i * B);
+            _size   = h.size;
+            _offset = h.begin_offset;}};
+
+template <typename T, std::size_t B>
+const std::size_t MappedDeque<T, B>::block_size;
+
+#endif // DequeSnapshot_h
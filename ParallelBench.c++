@@ -0,0 +1,168 @@
+// --------------------------------
+// projects/deque/ParallelBench.c++
+// --------------------------------
+
+/*
+To run the benchmarks:
+    % make ParallelBench
+    % ./ParallelBench
+To record them for comparing two versions:
+    % make ParallelBench.json
+Every algorithm runs on 1, 2, 4, ... threads up to twice the number of cores,
+against the sequential std algorithm on the same deque.
+*/
+
+// --------
+// includes
+// --------
+
+#include <algorithm> // for_each, sort, transform
+#include <cstdlib>   // rand, srand
+#include <numeric>   // accumulate
+
+#include "benchmark/benchmark.h"
+
+#include "Deque.h"
+#include "ParallelDeque.h"
+
+using namespace std;
+
+/**
+ * the number of elements: 2^24, a little over 10^7
+ */
+const int bench_size = 1 << 24;
+
+/**
+ * a deque of bench_size pseudo-random ints, shared by the benchmarks
+ */
+const MyDeque<int>& source ()
+{
+    static MyDeque<int> x;
+    if(x.empty())
+    {
+        srand(378);
+        for(int i = 0; i < bench_size; ++i)
+        {
+            x.push_back(rand());
+        }
+    }
+    return x;
+}
+
+// --------
+// for_each
+// --------
+
+/**
+ * threads 0 is the sequential std::for_each
+ */
+void BM_ForEach (benchmark::State& state)
+{
+    const int threads = state.range(0);
+    DequeThreadPool pool(threads ? threads : 1);
+    MyDeque<int> x(source());
+    for(auto _ : state)
+    {
+        if(threads == 0)
+        {
+            std::for_each(x.begin(), x.end(), [] (int& v) { v = v * 3 + 1; });
+        }
+        else
+        {
+            parallel::for_each(x.begin(), x.end(), [] (int& v) { v = v * 3 + 1; }, pool);
+        }
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * bench_size);
+}
+
+// ---------
+// transform
+// ---------
+
+void BM_Transform (benchmark::State& state)
+{
+    const int threads = state.range(0);
+    DequeThreadPool pool(threads ? threads : 1);
+    const MyDeque<int>& x = source();
+    MyDeque<double> y(bench_size);
+    for(auto _ : state)
+    {
+        if(threads == 0)
+        {
+            std::transform(x.begin(), x.end(), y.begin(), [] (int v) { return v * 0.5; });
+        }
+        else
+        {
+            parallel::transform(x.begin(), x.end(), y.begin(), [] (int v) { return v * 0.5; }, pool);
+        }
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * bench_size);
+}
+
+// ------
+// reduce
+// ------
+
+void BM_Reduce (benchmark::State& state)
+{
+    const int threads = state.range(0);
+    DequeThreadPool pool(threads ? threads : 1);
+    const MyDeque<int>& x = source();
+    for(auto _ : state)
+    {
+        long long sum = (threads == 0) ? accumulate(x.begin(), x.end(), 0LL) : parallel::reduce(x.begin(), x.end(), 0LL, pool);
+        benchmark::DoNotOptimize(sum);
+    }
+    state.SetItemsProcessed(state.iterations() * bench_size);
+}
+
+// ----
+// sort
+// ----
+
+void BM_Sort (benchmark::State& state)
+{
+    const int threads = state.range(0);
+    DequeThreadPool pool(threads ? threads : 1);
+    for(auto _ : state)
+    {
+        state.PauseTiming();
+        MyDeque<int> x(source());
+        state.ResumeTiming();
+        if(threads == 0)
+        {
+            std::sort(x.begin(), x.end());
+        }
+        else
+        {
+            parallel::sort(x.begin(), x.end(), pool);
+        }
+        benchmark::DoNotOptimize(x);
+    }
+    state.SetItemsProcessed(state.iterations() * bench_size);
+}
+
+// ------------
+// registration
+// ------------
+
+/**
+ * 0 (sequential std), then 1, 2, 4, ... threads up to twice the cores
+ */
+void ThreadArguments (benchmark::internal::Benchmark* b)
+{
+    b->Arg(0);
+    for(int threads = 1; threads <= 2 * static_cast<int>(DequeThreadPool::default_concurrency()); threads *= 2)
+    {
+        b->Arg(threads);
+    }
+}
+
+BENCHMARK(BM_ForEach)->Apply(ThreadArguments)->UseRealTime()->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_Transform)->Apply(ThreadArguments)->UseRealTime()->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_Reduce)->Apply(ThreadArguments)->UseRealTime()->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_Sort)->Apply(ThreadArguments)->UseRealTime()->Unit(benchmark::kMillisecond);
+
+BENCHMARK_MAIN();
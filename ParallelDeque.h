@@ -0,0 +1,438 @@
+// ------------------------------
+// projects/deque/ParallelDeque.h
+// ------------------------------
+
+#ifndef ParallelDeque_h
+#define ParallelDeque_h
+
+// --------
+// includes
+// --------
+
+#include <algorithm>          // merge, min, move, sort
+#include <atomic>             // atomic
+#include <condition_variable> // condition_variable
+#include <cstddef>            // size_t
+#include <exception>          // current_exception, exception_ptr, rethrow_exception
+#include <functional>         // less
+#include <iterator>           // iterator_traits, make_move_iterator
+#include <mutex>              // lock_guard, mutex, unique_lock
+#include <thread>             // hardware_concurrency, thread
+#include <type_traits>        // remove_reference
+#include <vector>             // vector
+
+#include "Deque.h"
+
+// ---------------
+// DequeThreadPool
+// ---------------
+
+/**
+ * fixed set of worker threads that run fork-join jobs: run(n, f) calls f(0), ..., f(n - 1) across
+ * the workers and the calling thread, and returns when every call has finished
+ * one job runs at a time; a run from inside a job's task executes serially on the calling thread
+ */
+class DequeThreadPool {
+    public:
+        typedef std::size_t size_type;
+
+    private:
+        // ---
+        // job
+        // ---
+
+        /**
+         * one run: the tasks are claimed through next, so a fast thread takes more of them
+         */
+        struct job {
+            void                 (*call) (void*, size_type);
+            void*                  context;
+            size_type              n;
+            std::atomic<size_type> next;
+            size_type              users;
+            std::exception_ptr     error;
+            std::mutex             error_lock;
+
+            job (void (*c) (void*, size_type), void* x, size_type count) :
+                    call(c),
+                    context(x),
+                    n(count),
+                    next(0),
+                    users(0)
+            {}
+
+            void work ()
+            {
+                bool& flag = in_task();
+                bool outer = flag;
+                flag = true;
+                for(size_type i; (i = next.fetch_add(1, std::memory_order_relaxed)) < n;)
+                {
+                    try
+                    {
+                        call(context, i);
+                    }
+                    catch(...)
+                    {
+                        std::lock_guard<std::mutex> lock(error_lock);
+                        if(!error)
+                        {
+                            error = std::current_exception();
+                        }
+                    }
+                }
+                flag = outer;
+            }
+        };
+
+        // ----
+        // data
+        // ----
+
+        std::vector<std::thread> workers;
+        std::mutex               m;
+        std::condition_variable  wake;
+        std::condition_variable  finished;
+        job*                     current;
+        size_type                generation;
+        bool                     stopping;
+        std::mutex               run_lock;
+
+    public:
+        // ------------
+        // constructors
+        // ------------
+
+        /**
+         * @param threads the number of threads a job runs on, counting the caller of run
+         */
+        explicit DequeThreadPool (size_type threads = default_concurrency()) :
+                current(0),
+                generation(0),
+                stopping(false)
+        {
+            for(size_type i = 1; i < threads; ++i)
+            {
+                workers.push_back(std::thread(&DequeThreadPool::loop, this));
+            }
+        }
+
+        DequeThreadPool (const DequeThreadPool&) = delete;
+        DequeThreadPool& operator = (const DequeThreadPool&) = delete;
+
+        // ----------
+        // destructor
+        // ----------
+
+        ~DequeThreadPool ()
+        {
+            {
+                std::lock_guard<std::mutex> lock(m);
+                stopping = true;
+            }
+            wake.notify_all();
+            for(size_type i = 0; i != workers.size(); ++i)
+            {
+                workers[i].join();
+            }
+        }
+
+        // -----------
+        // concurrency
+        // -----------
+
+        /**
+         * @return the number of threads a job runs on, counting the caller
+         */
+        size_type concurrency () const
+        {
+            return workers.size() + 1;
+        }
+
+        // ---
+        // run
+        // ---
+
+        /**
+         * call f(i) for every i in [0, n), in no particular order and possibly concurrently
+         * @throw the first exception a call threw, after every call has finished
+         */
+        template <typename F>
+        void run (size_type n, F f)
+        {
+            if(workers.empty() || (n <= 1) || in_task())
+            {
+                for(size_type i = 0; i != n; ++i)
+                {
+                    f(i);
+                }
+                return;
+            }
+            std::lock_guard<std::mutex> serial(run_lock);
+            job j(&invoke<F>, &f, n);
+            {
+                std::lock_guard<std::mutex> lock(m);
+                current = &j;
+                ++generation;
+            }
+            wake.notify_all();
+            j.work();
+            {
+                //the job lives on this stack, so wait for every worker to let go of it
+                std::unique_lock<std::mutex> lock(m);
+                current = 0;
+                finished.wait(lock, [&j] () {return j.users == 0;});
+            }
+            if(j.error)
+            {
+                std::rethrow_exception(j.error);
+            }
+        }
+
+        // ------
+        // shared
+        // ------
+
+        /**
+         * @return a pool with a thread per core, started on first use
+         */
+        static DequeThreadPool& shared ()
+        {
+            static DequeThreadPool pool;
+            return pool;
+        }
+
+        // -------------------
+        // default_concurrency
+        // -------------------
+
+        static size_type default_concurrency ()
+        {
+            size_type n = std::thread::hardware_concurrency();
+            return (n == 0) ? 1 : n;
+        }
+
+    private:
+        // ------
+        // invoke
+        // ------
+
+        template <typename F>
+        static void invoke (void* f, size_type i)
+        {
+            (*static_cast<F*>(f))(i);
+        }
+
+        // -------
+        // in_task
+        // -------
+
+        /**
+         * @return whether this thread is running a task, so a nested run stays on it
+         */
+        static bool& in_task ()
+        {
+            static thread_local bool flag = false;
+            return flag;
+        }
+
+        // ----
+        // loop
+        // ----
+
+        void loop ()
+        {
+            size_type seen = 0;
+            std::unique_lock<std::mutex> lock(m);
+            while(true)
+            {
+                wake.wait(lock, [this, &seen] () {return stopping || (current && (generation != seen));});
+                if(stopping)
+                {
+                    return;
+                }
+                seen = generation;
+                job* j = current;
+                ++j->users;
+                lock.unlock();
+                j->work();
+                lock.lock();
+                if(--j->users == 0)
+                {
+                    finished.notify_all();
+                }
+            }
+        }
+};
+
+namespace parallel {
+
+// --------------
+// for_each_grain
+// --------------
+
+/**
+ * split [b, e) into at most grains pieces made of whole blocks (the first and last may be partial)
+ * and call f(g, gb, ge) for every piece on the pool
+ * I a MyDeque iterator or const_iterator
+ */
+template <typename I, typename F>
+void for_each_grain (I b, I e, std::size_t grains, DequeThreadPool& pool, F f) {
+    if (b == e)
+        return;
+    std::size_t blocks = (e.get_block_address() - b.get_block_address()) + (e.get_block_index() != 0);
+    grains = std::min(grains, blocks);
+    pool.run(grains, [&] (std::size_t g) {
+        std::size_t first = g * blocks / grains;
+        std::size_t last  = (g + 1) * blocks / grains;
+        I gb = (g == 0) ? b : I(b.get_block_address() + first, 0);
+        I ge = (g + 1 == grains) ? e : I(b.get_block_address() + last, 0);
+        f(g, gb, ge);});}
+
+// -----------
+// grain_count
+// -----------
+
+/**
+ * a few pieces per thread, so a slow thread does not hold up the rest
+ */
+inline std::size_t grain_count (const DequeThreadPool& pool) {
+    return 4 * pool.concurrency();}
+
+// --------
+// for_each
+// --------
+
+/**
+ * call f on every element of [b, e), a run of whole blocks per task
+ * @return f
+ */
+template <typename I, typename F>
+F for_each (I b, I e, F f, DequeThreadPool& pool = DequeThreadPool::shared()) {
+    for_each_grain(b, e, grain_count(pool), pool, [&f] (std::size_t, I gb, I ge) {
+        typedef typename std::iterator_traits<I>::reference reference;
+        for_each_segment(gb, ge, [&f] (typename std::remove_reference<reference>::type* p, typename std::remove_reference<reference>::type* q) {
+            for (; p != q; ++p)
+                f(*p);});});
+    return f;}
+
+// ---------
+// transform
+// ---------
+
+/**
+ * write f(x) for every x of [b, e) to the range starting at o
+ * O a random-access iterator (another MyDeque's, or the same as b for an in-place transform)
+ * @return the end of the output range
+ */
+template <typename I, typename O, typename F>
+O transform (I b, I e, O o, F f, DequeThreadPool& pool = DequeThreadPool::shared()) {
+    for_each_grain(b, e, grain_count(pool), pool, [&] (std::size_t, I gb, I ge) {
+        typedef typename std::iterator_traits<I>::reference reference;
+        O x = o + (gb - b);
+        for_each_segment(gb, ge, [&f, &x] (typename std::remove_reference<reference>::type* p, typename std::remove_reference<reference>::type* q) {
+            for (; p != q; ++p, ++x)
+                *x = f(*p);});});
+    return o + (e - b);}
+
+// ------
+// reduce
+// ------
+
+/**
+ * fold [b, e) with op, which must be associative; each task folds its blocks and the
+ * partial results are folded in order onto init
+ * @return init op x0 op x1 ... (grouped arbitrarily)
+ */
+template <typename I, typename T, typename Op>
+T reduce (I b, I e, T init, Op op, DequeThreadPool& pool = DequeThreadPool::shared()) {
+    std::size_t grains = grain_count(pool);
+    std::vector<T> partial(grains, init);
+    std::vector<char> used(grains, 0);
+    for_each_grain(b, e, grains, pool, [&] (std::size_t g, I gb, I ge) {
+        typedef typename std::iterator_traits<I>::reference reference;
+        T x = *gb;
+        for_each_segment(++gb, ge, [&x, &op] (typename std::remove_reference<reference>::type* p, typename std::remove_reference<reference>::type* q) {
+            for (; p != q; ++p)
+                x = op(x, *p);});
+        partial[g] = x;
+        used[g] = 1;});
+    for (std::size_t g = 0; g != grains; ++g)
+        if (used[g])
+            init = op(init, partial[g]);
+    return init;}
+
+/**
+ * reduce with +
+ */
+template <typename I, typename T>
+T reduce (I b, I e, T init, DequeThreadPool& pool = DequeThreadPool::shared()) {
+    return parallel::reduce(b, e, init, [] (const T& x, const T& y) {return x + y;}, pool);}
+
+// ----
+// sort
+// ----
+
+/**
+ * sort [b, e): each task sorts its run of blocks, then neighbouring runs are merged
+ * pairwise in parallel, alternating between the deque and a buffer of e - b elements
+ * the element type must be default constructible and move assignable
+ */
+template <typename I, typename C>
+void sort (I b, I e, C cmp, DequeThreadPool& pool = DequeThreadPool::shared()) {
+    typedef typename std::iterator_traits<I>::value_type value_type;
+    typedef typename std::vector<value_type>::iterator   buffer_iterator;
+    const std::size_t n = e - b;
+    std::size_t grains = grain_count(pool);
+    if (n < 2)
+        return;
+    //the runs are the grains: remember where each one starts
+    std::vector<std::size_t> starts(grains + 1, n);
+    std::vector<char> used(grains, 0);
+    for_each_grain(b, e, grains, pool, [&] (std::size_t g, I gb, I ge) {
+        starts[g] = gb - b;
+        used[g] = 1;
+        std::sort(gb, ge, cmp);});
+    std::vector<std::size_t> runs;
+    for (std::size_t g = 0; g != grains; ++g)
+        if (used[g])
+            runs.push_back(starts[g]);
+    runs.push_back(n);
+    if (runs.size() <= 2)
+        return;
+    std::vector<value_type> buffer(n);
+    bool in_buffer = false;
+    while (runs.size() > 2) {
+        std::size_t pairs = runs.size() / 2;
+        pool.run(pairs, [&] (std::size_t p) {
+            std::size_t lo  = runs[2 * p];
+            std::size_t mid = runs[std::min(2 * p + 1, runs.size() - 1)];
+            std::size_t hi  = runs[std::min(2 * p + 2, runs.size() - 1)];
+            if (in_buffer) {
+                buffer_iterator s = buffer.begin();
+                std::merge(std::make_move_iterator(s + lo), std::make_move_iterator(s + mid),
+                           std::make_move_iterator(s + mid), std::make_move_iterator(s + hi), b + lo, cmp);}
+            else {
+                std::merge(std::make_move_iterator(b + lo), std::make_move_iterator(b + mid),
+                           std::make_move_iterator(b + mid), std::make_move_iterator(b + hi), buffer.begin() + lo, cmp);}});
+        std::vector<std::size_t> merged;
+        for (std::size_t r = 0; r < runs.size() - 1; r += 2)
+            merged.push_back(runs[r]);
+        merged.push_back(n);
+        runs.swap(merged);
+        in_buffer = !in_buffer;}
+    //move back grain by grain, so no two tasks write into the same block
+    if (in_buffer)
+        for_each_grain(b, e, grains, pool, [&] (std::size_t, I gb, I ge) {
+            std::move(buffer.begin() + (gb - b), buffer.begin() + (ge - b), gb);});}
+
+/**
+ * sort with <
+ */
+template <typename I>
+void sort (I b, I e, DequeThreadPool& pool = DequeThreadPool::shared()) {
+    parallel::sort(b, e, std::less<typename std::iterator_traits<I>::value_type>(), pool);}
+
+} // parallel
+
+#endif // ParallelDeque_h
@@ -0,0 +1,855 @@
+// ---------------------------
+// projects/deque/SmallDeque.h
+// ---------------------------
+
+#ifndef SmallDeque_h
+#define SmallDeque_h
+
+// --------
+// includes
+// --------
+
+#include <algorithm>   // equal, lexicographical_compare, move, rotate
+#include <cassert>     // assert
+#include <cstddef>     // ptrdiff_t, size_t
+#include <iterator>    // random_access_iterator_tag
+#include <memory>      // allocator
+#include <new>         // placement new
+#include <stdexcept>   // out_of_range
+#include <type_traits> // aligned_storage, conditional, enable_if
+#include <utility>     // forward, move, move_if_noexcept
+
+#include "Deque.h"
+
+// ----------
+// SmallDeque
+// ----------
+
+/**
+ * deque that keeps up to N elements inline in a ring buffer and only moves them to a MyDeque
+ * (the spill) when it grows past N, so a deque that stays small never touches the allocator
+ * once spilled it stays spilled until clear or shrink_to_fit finds it small enough to go back
+ * T the element type
+ * N the number of elements held inline
+ * A the allocator of the spill
+ * B the block size of the spill
+ */
+template < typename T, std::size_t N, typename A = std::allocator<T>, std::size_t B = deque_block_size<T>::value >
+class SmallDeque {
+    static_assert(N != 0, "SmallDeque needs room for at least one inline element");
+
+    public:
+        // --------
+        // typedefs
+        // --------
+
+        typedef MyDeque<T, A, B>                       spill_type;
+
+        typedef typename spill_type::allocator_type    allocator_type;
+        typedef typename spill_type::value_type        value_type;
+
+        typedef typename spill_type::size_type         size_type;
+        typedef typename spill_type::difference_type   difference_type;
+
+        typedef value_type&                            reference;
+        typedef const value_type&                      const_reference;
+
+        // ---------------
+        // inline_capacity
+        // ---------------
+
+        static const size_type inline_capacity = N;
+
+    private:
+        // --------------
+        // basic_iterator
+        // --------------
+
+        /**
+         * random-access iterator holding the deque and an index, which works the same inline and spilled
+         * D the deque type (const for the const_iterator)
+         * V the element type (const for the const_iterator)
+         */
+        template <typename D, typename V>
+        class basic_iterator {
+            friend class SmallDeque;
+
+            template <typename, typename>
+            friend class basic_iterator;
+
+            public:
+                // --------
+                // typedefs
+                // --------
+
+                typedef std::random_access_iterator_tag iterator_category;
+                typedef typename std::remove_const<V>::type value_type;
+                typedef typename SmallDeque::difference_type difference_type;
+                typedef V*                              pointer;
+                typedef V&                              reference;
+
+            private:
+                D*        owner;
+                size_type index;
+
+            public:
+                // -----------
+                // constructor
+                // -----------
+
+                basic_iterator (D* o = 0, size_type i = 0) :
+                        owner(o),
+                        index(i)
+                {}
+
+                /**
+                 * iterator to const_iterator
+                 */
+                template <typename D2, typename V2, typename = typename std::enable_if<std::is_convertible<D2*, D*>::value>::type>
+                basic_iterator (const basic_iterator<D2, V2>& that) :
+                        owner(that.owner),
+                        index(that.index)
+                {}
+
+                // -----------
+                // operator ==
+                // -----------
+
+                friend bool operator == (const basic_iterator& lhs, const basic_iterator& rhs) {
+                    return (lhs.owner == rhs.owner) && (lhs.index == rhs.index);}
+
+                friend bool operator != (const basic_iterator& lhs, const basic_iterator& rhs) {
+                    return !(lhs == rhs);}
+
+                friend bool operator < (const basic_iterator& lhs, const basic_iterator& rhs) {
+                    return lhs.index < rhs.index;}
+
+                friend bool operator > (const basic_iterator& lhs, const basic_iterator& rhs) {
+                    return rhs < lhs;}
+
+                friend bool operator <= (const basic_iterator& lhs, const basic_iterator& rhs) {
+                    return !(rhs < lhs);}
+
+                friend bool operator >= (const basic_iterator& lhs, const basic_iterator& rhs) {
+                    return !(lhs < rhs);}
+
+                // ----------
+                // operator +
+                // ----------
+
+                friend basic_iterator operator + (basic_iterator lhs, difference_type rhs) {
+                    return lhs += rhs;}
+
+                friend basic_iterator operator + (difference_type lhs, basic_iterator rhs) {
+                    return rhs += lhs;}
+
+                friend basic_iterator operator - (basic_iterator lhs, difference_type rhs) {
+                    return lhs -= rhs;}
+
+                friend difference_type operator - (const basic_iterator& lhs, const basic_iterator& rhs) {
+                    return static_cast<difference_type>(lhs.index) - static_cast<difference_type>(rhs.index);}
+
+                // ----------
+                // operator *
+                // ----------
+
+                reference operator * () const {
+                    return (*owner)[index];}
+
+                pointer operator -> () const {
+                    return &**this;}
+
+                reference operator [] (difference_type n) const {
+                    return (*owner)[index + n];}
+
+                // -----------
+                // operator ++
+                // -----------
+
+                basic_iterator& operator ++ () {
+                    ++index;
+                    return *this;}
+
+                basic_iterator operator ++ (int) {
+                    basic_iterator x = *this;
+                    ++*this;
+                    return x;}
+
+                basic_iterator& operator -- () {
+                    --index;
+                    return *this;}
+
+                basic_iterator operator -- (int) {
+                    basic_iterator x = *this;
+                    --*this;
+                    return x;}
+
+                // -----------
+                // operator +=
+                // -----------
+
+                basic_iterator& operator += (difference_type d) {
+                    index += d;
+                    return *this;}
+
+                basic_iterator& operator -= (difference_type d) {
+                    index -= d;
+                    return *this;}};
+
+    public:
+        typedef basic_iterator<SmallDeque, value_type>             iterator;
+        typedef basic_iterator<const SmallDeque, const value_type> const_iterator;
+
+    private:
+        typedef typename std::aligned_storage<sizeof(value_type), alignof(value_type)>::type slot_type;
+
+        // ----
+        // data
+        // ----
+
+        slot_type  slots[N];
+        size_type  head;
+        size_type  count;
+        bool       spilled_mode;
+        spill_type spill;
+
+    private:
+        // -----
+        // valid
+        // -----
+
+        bool valid () const {
+            return (head < N) && (count <= N) && (!spilled_mode || count == 0);}
+
+        // ----
+        // slot
+        // ----
+
+        /**
+         * @return the inline element at position i of the ring, counting from head
+         */
+        value_type* slot (size_type i) {
+            size_type j = head + i;
+            return reinterpret_cast<value_type*>(&slots[(j < N) ? j : j - N]);}
+
+        const value_type* slot (size_type i) const {
+            return const_cast<SmallDeque*>(this)->slot(i);}
+
+    public:
+        // ------------
+        // constructors
+        // ------------
+
+        /**
+         * @param a the allocator the spill will use
+         * nothing is allocated until the deque grows past N
+         */
+        explicit SmallDeque (const allocator_type& a = allocator_type()) :
+                head(0),
+                count(0),
+                spilled_mode(false),
+                spill(a)
+        {
+            assert(valid());
+        }
+
+        /**
+         * @param s the number of value-initialized elements
+         */
+        explicit SmallDeque (size_type s, const allocator_type& a = allocator_type()) :
+                SmallDeque(a)
+        {
+            resize(s);
+        }
+
+        /**
+         * @param s the number of copies
+         * @param v the element to copy
+         */
+        SmallDeque (size_type s, const_reference v, const allocator_type& a = allocator_type()) :
+                SmallDeque(a)
+        {
+            resize(s, v);
+        }
+
+        /**
+         * @param b the beginning of a range
+         * @param e the end of a range
+         */
+        template <typename II, typename = typename std::enable_if<!std::is_integral<II>::value>::type>
+        SmallDeque (II b, II e, const allocator_type& a = allocator_type()) :
+                SmallDeque(a)
+        {
+            assign(b, e);
+        }
+
+        SmallDeque (const SmallDeque& that) :
+                SmallDeque(std::allocator_traits<allocator_type>::select_on_container_copy_construction(that.get_allocator()))
+        {
+            assign(that.begin(), that.end());
+        }
+
+        /**
+         * takes the spill's storage when that has spilled, otherwise moves the inline elements one by one
+         * that is left empty
+         */
+        SmallDeque (SmallDeque&& that) :
+                SmallDeque(that.get_allocator())
+        {
+            take(that);
+        }
+
+        // ----------
+        // destructor
+        // ----------
+
+        ~SmallDeque ()
+        {
+            destroy_inline();
+        }
+
+        // ----------
+        // operator =
+        // ----------
+
+        SmallDeque& operator = (const SmallDeque& that)
+        {
+            if(this != &that)
+            {
+                assign(that.begin(), that.end());
+            }
+            return *this;
+        }
+
+        SmallDeque& operator = (SmallDeque&& that)
+        {
+            if(this != &that)
+            {
+                clear();
+                take(that);
+            }
+            return *this;
+        }
+
+        // ------
+        // assign
+        // ------
+
+        /**
+         * @param b the beginning of a range
+         * @param e the end of a range
+         */
+        template <typename II, typename = typename std::enable_if<!std::is_integral<II>::value>::type>
+        void assign (II b, II e)
+        {
+            clear();
+            while(b != e)
+            {
+                emplace_back(*b);
+                ++b;
+            }
+        }
+
+        // -----------
+        // operator ==
+        // -----------
+
+        friend bool operator == (const SmallDeque& lhs, const SmallDeque& rhs) {
+            return (lhs.size() == rhs.size()) && std::equal(lhs.begin(), lhs.end(), rhs.begin());}
+
+        friend bool operator != (const SmallDeque& lhs, const SmallDeque& rhs) {
+            return !(lhs == rhs);}
+
+        // ----------
+        // operator <
+        // ----------
+
+        friend bool operator < (const SmallDeque& lhs, const SmallDeque& rhs) {
+            return std::lexicographical_compare(lhs.begin(), lhs.end(), rhs.begin(), rhs.end());}
+
+        // -----------
+        // operator []
+        // -----------
+
+        /**
+         * @param index the position of the element
+         * @return the element at index
+         */
+        reference operator [] (size_type index) {
+            return spilled_mode ? spill[index] : *slot(index);}
+
+        const_reference operator [] (size_type index) const {
+            return const_cast<SmallDeque*>(this)->operator[](index);}
+
+        // --
+        // at
+        // --
+
+        /**
+         * @param index the position of the element
+         * @return the element at index
+         * @throw out_of_range
+         */
+        reference at (size_type index) {
+            if (index >= size())
+                throw std::out_of_range("invalid index");
+            return (*this)[index];}
+
+        const_reference at (size_type index) const {
+            return const_cast<SmallDeque*>(this)->at(index);}
+
+        // -----
+        // front
+        // -----
+
+        reference front () {
+            return (*this)[0];}
+
+        const_reference front () const {
+            return (*this)[0];}
+
+        // ----
+        // back
+        // ----
+
+        reference back () {
+            return (*this)[size() - 1];}
+
+        const_reference back () const {
+            return (*this)[size() - 1];}
+
+        // -----
+        // begin
+        // -----
+
+        iterator begin () {
+            return iterator(this, 0);}
+
+        const_iterator begin () const {
+            return const_iterator(this, 0);}
+
+        const_iterator cbegin () const {
+            return begin();}
+
+        // ---
+        // end
+        // ---
+
+        iterator end () {
+            return iterator(this, size());}
+
+        const_iterator end () const {
+            return const_iterator(this, size());}
+
+        const_iterator cend () const {
+            return end();}
+
+        // -----
+        // clear
+        // -----
+
+        /**
+         * empty the deque and go back to inline storage; the spill keeps its blocks for the next time
+         */
+        void clear ()
+        {
+            destroy_inline();
+            spill.clear();
+            spilled_mode = false;
+            assert(valid());
+        }
+
+        // -----
+        // empty
+        // -----
+
+        bool empty () const {
+            return size() == 0;}
+
+        // ----
+        // size
+        // ----
+
+        size_type size () const {
+            return spilled_mode ? spill.size() : count;}
+
+        // -------
+        // spilled
+        // -------
+
+        /**
+         * @return whether the elements live in the spill rather than inline
+         */
+        bool spilled () const {
+            return spilled_mode;}
+
+        // -------------
+        // get_allocator
+        // -------------
+
+        allocator_type get_allocator () const {
+            return spill.get_allocator();}
+
+        // ------------
+        // emplace_back
+        // ------------
+
+        /**
+         * @param args the arguments forwarded to the constructor of the new element
+         * @return the new element
+         */
+        template <typename... Args>
+        reference emplace_back (Args&&... args)
+        {
+            if(!spilled_mode && count < N)
+            {
+                value_type* p = ::new (static_cast<void*>(slot(count))) value_type(std::forward<Args>(args)...);
+                ++count;
+                return *p;
+            }
+            if(!spilled_mode)
+            {
+                //args may refer to an inline element, so build the new one before moving them out
+                value_type v(std::forward<Args>(args)...);
+                spill_inline();
+                return spill.emplace_back(std::move(v));
+            }
+            return spill.emplace_back(std::forward<Args>(args)...);
+        }
+
+        // -------------
+        // emplace_front
+        // -------------
+
+        template <typename... Args>
+        reference emplace_front (Args&&... args)
+        {
+            if(!spilled_mode && count < N)
+            {
+                size_type new_head = (head == 0) ? N - 1 : head - 1;
+                value_type* p = ::new (static_cast<void*>(&slots[new_head])) value_type(std::forward<Args>(args)...);
+                head = new_head;
+                ++count;
+                return *p;
+            }
+            if(!spilled_mode)
+            {
+                value_type v(std::forward<Args>(args)...);
+                spill_inline();
+                return spill.emplace_front(std::move(v));
+            }
+            return spill.emplace_front(std::forward<Args>(args)...);
+        }
+
+        // ---------
+        // push_back
+        // ---------
+
+        void push_back (const_reference v) {
+            emplace_back(v);}
+
+        void push_back (value_type&& v) {
+            emplace_back(std::move(v));}
+
+        // ----------
+        // push_front
+        // ----------
+
+        void push_front (const_reference v) {
+            emplace_front(v);}
+
+        void push_front (value_type&& v) {
+            emplace_front(std::move(v));}
+
+        // --------
+        // pop_back
+        // --------
+
+        void pop_back ()
+        {
+            if(spilled_mode)
+            {
+                spill.pop_back();
+                return;
+            }
+            assert(count != 0);
+            slot(count - 1)->~value_type();
+            --count;
+        }
+
+        // ---------
+        // pop_front
+        // ---------
+
+        void pop_front ()
+        {
+            if(spilled_mode)
+            {
+                spill.pop_front();
+                return;
+            }
+            assert(count != 0);
+            slot(0)->~value_type();
+            head = (head + 1 == N) ? 0 : head + 1;
+            --count;
+        }
+
+        // -------
+        // emplace
+        // -------
+
+        /**
+         * construct an element before it; inline, the new element is added at the nearer end and rotated into place
+         * @param it the position of insertion
+         * @param args the arguments forwarded to the constructor of the new element
+         * @return an iterator to the new element
+         */
+        template <typename... Args>
+        iterator emplace (const_iterator it, Args&&... args)
+        {
+            size_type offset = it.index;
+            if(spilled_mode)
+            {
+                spill.emplace(spill.begin() + offset, std::forward<Args>(args)...);
+                return begin() + offset;
+            }
+            value_type v(std::forward<Args>(args)...);
+            if(count == N)
+            {
+                spill_inline();
+                spill.emplace(spill.begin() + offset, std::move(v));
+            }
+            else if(offset < count / 2)
+            {
+                emplace_front(std::move(v));
+                std::rotate(begin(), begin() + 1, begin() + (offset + 1));
+            }
+            else
+            {
+                emplace_back(std::move(v));
+                std::rotate(begin() + offset, end() - 1, end());
+            }
+            return begin() + offset;
+        }
+
+        // ------
+        // insert
+        // ------
+
+        iterator insert (const_iterator it, const_reference v) {
+            return emplace(it, v);}
+
+        iterator insert (const_iterator it, value_type&& v) {
+            return emplace(it, std::move(v));}
+
+        // -----
+        // erase
+        // -----
+
+        /**
+         * @param it the element to remove
+         * @return an iterator to the element after it
+         */
+        iterator erase (const_iterator it)
+        {
+            size_type offset = it.index;
+            if(spilled_mode)
+            {
+                spill.erase(spill.begin() + offset);
+            }
+            else if(offset < count / 2)
+            {
+                std::move_backward(begin(), begin() + offset, begin() + (offset + 1));
+                pop_front();
+            }
+            else
+            {
+                std::move(begin() + (offset + 1), end(), begin() + offset);
+                pop_back();
+            }
+            return begin() + offset;
+        }
+
+        // ------
+        // resize
+        // ------
+
+        /**
+         * @param s the new size, value-initializing the new elements
+         */
+        void resize (size_type s)
+        {
+            if(spilled_mode || s > N)
+            {
+                if(!spilled_mode)
+                {
+                    spill_inline();
+                }
+                spill.resize(s);
+                return;
+            }
+            while(count > s)
+            {
+                pop_back();
+            }
+            while(count < s)
+            {
+                emplace_back();
+            }
+        }
+
+        /**
+         * @param s the new size
+         * @param v the element to copy into the new space
+         */
+        void resize (size_type s, const_reference v)
+        {
+            if(spilled_mode || s > N)
+            {
+                if(!spilled_mode)
+                {
+                    //v may be an inline element
+                    value_type x(v);
+                    spill_inline();
+                    spill.resize(s, x);
+                    return;
+                }
+                spill.resize(s, v);
+                return;
+            }
+            while(count > s)
+            {
+                pop_back();
+            }
+            while(count < s)
+            {
+                emplace_back(v);
+            }
+        }
+
+        // -------------
+        // shrink_to_fit
+        // -------------
+
+        /**
+         * go back to inline storage if the elements fit, releasing everything the spill holds
+         */
+        void shrink_to_fit ()
+        {
+            if(!spilled_mode)
+            {
+                return;
+            }
+            if(spill.size() <= N)
+            {
+                size_type i = 0;
+                try
+                {
+                    for(; i != spill.size(); ++i)
+                    {
+                        ::new (static_cast<void*>(&slots[i])) value_type(std::move_if_noexcept(spill[i]));
+                    }
+                }
+                catch(...)
+                {
+                    while(i != 0)
+                    {
+                        reinterpret_cast<value_type*>(&slots[--i])->~value_type();
+                    }
+                    throw;
+                }
+                head = 0;
+                count = i;
+                spilled_mode = false;
+                spill.clear();
+            }
+            spill.shrink_to_fit();
+            assert(valid());
+        }
+
+        // ----
+        // swap
+        // ----
+
+        void swap (SmallDeque& that)
+        {
+            SmallDeque x(std::move(that));
+            that = std::move(*this);
+            *this = std::move(x);
+        }
+
+    private:
+        // --------------
+        // destroy_inline
+        // --------------
+
+        void destroy_inline ()
+        {
+            for(size_type i = 0; i != count; ++i)
+            {
+                slot(i)->~value_type();
+            }
+            head = 0;
+            count = 0;
+        }
+
+        // ------------
+        // spill_inline
+        // ------------
+
+        /**
+         * move the inline elements into the spill, which stays empty if a copy throws
+         */
+        void spill_inline ()
+        {
+            assert(!spilled_mode);
+            spill.reserve_back(count + 1);
+            try
+            {
+                for(size_type i = 0; i != count; ++i)
+                {
+                    spill.emplace_back(std::move_if_noexcept(*slot(i)));
+                }
+            }
+            catch(...)
+            {
+                spill.clear();
+                throw;
+            }
+            destroy_inline();
+            spilled_mode = true;
+            assert(valid());
+        }
+
+        // ----
+        // take
+        // ----
+
+        /**
+         * take that's elements into this empty deque, leaving that empty
+         */
+        void take (SmallDeque& that)
+        {
+            if(that.spilled_mode)
+            {
+                spill = std::move(that.spill);
+                spilled_mode = true;
+                that.spill.clear();
+                that.spilled_mode = false;
+            }
+            else
+            {
+                for(size_type i = 0; i != that.count; ++i)
+                {
+                    emplace_back(std::move(*that.slot(i)));
+                }
+                that.destroy_inline();
+            }
+            assert(valid());
+        }
+};
+
+template <typename T, std::size_t N, typename A, std::size_t B>
+const typename SmallDeque<T, N, A, B>::size_type SmallDeque<T, N, A, B>::inline_capacity;
+
+#endif // SmallDeque_h
@@ -21,21 +21,135 @@ To Test the program:
 // --------
 
 #include <algorithm> // equal
-#include <cstring>   // strcmp, NULL
+#include <atomic>    // atomic
+#include <chrono>    // milliseconds
+#include <cstdio>    // remove
+#include <cstring>   // strcmp, strcpy, NULL
+#include <fstream>   // ofstream
 #include <deque>     // deque
-#include <sstream>   // ostringstream
-#include <stdexcept> // invalid_argument
+#include <sstream>   // ostringstream, stringstream
+#include <stdexcept> // invalid_argument, runtime_error
+#include <system_error> // system_error
 #include <string>    // ==
+#include <thread>    // thread, sleep_for
+#include <type_traits> // is_empty
 #include <cstdlib>   //rand
 #include <climits>   //INT_MAX
 #include <iostream>
+#include <iterator>  // istream_iterator
+#include <limits>    // numeric_limits
+#include <list>      // list
+#include <memory>    // unique_ptr
+#include <memory_resource> // pmr
+#include <numeric>   // accumulate
+#include <utility>   // move, pair
+#include <vector>    // vector
+
+#include <stdlib.h>  // mkstemp
+#include <unistd.h>  // close
 
 #include "gtest/gtest.h" //g test
 
+#include "BoundedDeque.h"
+#include "ConcurrentDeque.h"
+#include "DequeArena.h"
+#include "DequeSnapshot.h"
+#include "ParallelDeque.h"
+#include "SmallDeque.h"
+#include "TieredDeque.h"
 #include "Deque.h"
 
 using namespace std;
 
+// ------------------
+// CountingAllocator
+// ------------------
+
+/**
+ * std::allocator that counts calls per value type, so tests can check
+ * how often MyDeque touches its block and map allocators
+ */
+template <typename T>
+struct CountingAllocator : public allocator<T>
+{
+    template <typename U>
+    struct rebind
+    {
+        typedef CountingAllocator<U> other;
+    };
+
+    static int allocations;
+    static int deallocations;
+
+    CountingAllocator () {}
+
+    template <typename U>
+    CountingAllocator (const CountingAllocator<U>&) {}
+
+    T* allocate (size_t n)
+    {
+        ++allocations;
+        return allocator<T>::allocate(n);
+    }
+
+    void deallocate (T* p, size_t n)
+    {
+        ++deallocations;
+        allocator<T>::deallocate(p, n);
+    }
+
+    static void reset ()
+    {
+        allocations = 0;
+        deallocations = 0;
+    }
+};
+
+template <typename T>
+int CountingAllocator<T>::allocations = 0;
+
+template <typename T>
+int CountingAllocator<T>::deallocations = 0;
+
+// -----------
+// CopyCounter
+// -----------
+
+/**
+ * value type that counts how often it is copied, so tests can check that
+ * MyDeque moves elements instead
+ */
+struct CopyCounter
+{
+    static int copies;
+
+    int value;
+
+    CopyCounter (int v = 0) : value(v) {}
+
+    CopyCounter (const CopyCounter& that) : value(that.value)
+    {
+        ++copies;
+    }
+
+    CopyCounter (CopyCounter&& that) : value(that.value) {}
+
+    CopyCounter& operator = (const CopyCounter& that)
+    {
+        ++copies;
+        value = that.value;
+        return *this;
+    }
+
+    CopyCounter& operator = (CopyCounter&& that)
+    {
+        value = that.value;
+        return *this;
+    }
+};
+
+int CopyCounter::copies = 0;
+
 // ---------
 // TestDeque
 // ---------
@@ -92,7 +206,7 @@ class TypeTest : public testing::Test
         }
 };
 
-typedef ::testing::Types<MyDeque<int> > MyTypes;
+typedef ::testing::Types<MyDeque<int>, MyDeque<int, allocator<int>, 1>, MyDeque<int, allocator<int>, 8> > MyTypes;
 
 TYPED_TEST_CASE(TypeTest, MyTypes);
 
@@ -104,7 +218,7 @@ TYPED_TEST(TypeTest, TEST_DEFAULT_CONSTRUCTOR)
 
 TYPED_TEST(TypeTest, TEST_CONSTRUCTOR_WITH_ALLOCATOR_1) 
 {
-    typename TestFixture::Container x(allocator<int>());
+    typename TestFixture::Container x((allocator<int>()));
 }
 
 
@@ -954,4 +1068,2711 @@ TYPED_TEST(TypeTest, TEST_COMBO)
     ASSERT_TRUE(x == this->full_of_1);
 }
 
+TYPED_TEST(TypeTest, TEST_BLOCK_SIZE_1) 
+{
+    typedef typename TestFixture::Container Container;
+    ASSERT_TRUE(Container::block_size != 0);
+    ASSERT_TRUE((Container::block_size & (Container::block_size - 1)) == 0);
+    ASSERT_TRUE((size_t(1) << Container::block_shift) == Container::block_size);
+    ASSERT_TRUE(Container::block_mask == Container::block_size - 1);
+}
+
+TYPED_TEST(TypeTest, TEST_BLOCK_SIZE_2) 
+{
+    ASSERT_TRUE(deque_block_size<int>::value * sizeof(int) <= deque_block_size<int>::block_bytes);
+    ASSERT_TRUE(deque_block_size<int>::value * sizeof(int) * 2 > deque_block_size<int>::block_bytes);
+    ASSERT_TRUE((deque_block_size<char[1000]>::value) == 1);
+    ASSERT_TRUE(MyDeque<int>::block_size == deque_block_size<int>::value);
+}
+
+TYPED_TEST(TypeTest, TEST_ITERATOR_RANDOM_ACCESS_1) 
+{
+    for(int i = 0; i < 50; ++i)
+    {
+        ASSERT_TRUE(*(this->non_full.begin() + i) == i + 1);
+        ASSERT_TRUE(*(this->non_full.end() - (50 - i)) == i + 1);
+        ASSERT_TRUE(this->non_full[i] == i + 1);
+    }
+}
+
+TYPED_TEST(TypeTest, TEST_ITERATOR_RANDOM_ACCESS_2) 
+{
+    typename TestFixture::Container::iterator it(this->non_full.begin() + 37);
+    it += -30;
+    ASSERT_TRUE(*it == 8);
+    it -= -25;
+    ASSERT_TRUE(*it == 33);
+}
+
+// --------------
+// AllocationTest
+// --------------
+
+typedef MyDeque<int, CountingAllocator<int>, 8> CountingDeque;
+
+TEST(AllocationTest, TEST_PUSH_BACK_AMORTIZED) 
+{
+    CountingAllocator<int>::reset();
+    CountingAllocator<int*>::reset();
+    {
+        CountingDeque x;
+        for(int i = 0; i < 100000; ++i)
+        {
+            x.push_back(i);
+        }
+        //the map grows geometrically and blocks are never freed while growing
+        ASSERT_TRUE(CountingAllocator<int*>::allocations < 20);
+        ASSERT_TRUE(CountingAllocator<int>::deallocations == 0);
+        ASSERT_TRUE(CountingAllocator<int>::allocations < 3 * 100000 / 8);
+        for(int i = 0; i < 100000; ++i)
+        {
+            ASSERT_TRUE(x[i] == i);
+        }
+    }
+    ASSERT_TRUE(CountingAllocator<int>::allocations == CountingAllocator<int>::deallocations);
+    ASSERT_TRUE(CountingAllocator<int*>::allocations == CountingAllocator<int*>::deallocations);
+}
+
+TEST(AllocationTest, TEST_PUSH_FRONT_AMORTIZED) 
+{
+    CountingAllocator<int>::reset();
+    CountingAllocator<int*>::reset();
+    {
+        CountingDeque x;
+        for(int i = 0; i < 100000; ++i)
+        {
+            x.push_front(i);
+        }
+        ASSERT_TRUE(CountingAllocator<int*>::allocations < 20);
+        ASSERT_TRUE(CountingAllocator<int>::deallocations == 0);
+        for(int i = 0; i < 100000; ++i)
+        {
+            ASSERT_TRUE(x[i] == 100000 - 1 - i);
+        }
+    }
+    ASSERT_TRUE(CountingAllocator<int>::allocations == CountingAllocator<int>::deallocations);
+}
+
+TEST(AllocationTest, TEST_FIFO_RECENTERS_IN_PLACE) 
+{
+    CountingDeque x;
+    for(int i = 0; i < 1000; ++i)
+    {
+        x.push_back(i);
+    }
+    for(int i = 0; i < 10000; ++i)
+    {
+        x.push_back(i);
+        x.pop_front();
+    }
+
+    //once the map has slack and every slot has a block, a steady queue only recenters it
+    CountingAllocator<int>::reset();
+    CountingAllocator<int*>::reset();
+    for(int i = 0; i < 100000; ++i)
+    {
+        x.push_back(i);
+        x.pop_front();
+    }
+    ASSERT_TRUE(CountingAllocator<int*>::allocations == 0);
+    ASSERT_TRUE(CountingAllocator<int>::allocations == 0);
+    ASSERT_TRUE(x.size() == 1000);
+    ASSERT_TRUE(x.front() == 100000 - 1000);
+    ASSERT_TRUE(x.back() == 100000 - 1);
+}
+
+TEST(AllocationTest, TEST_LAZY_EMPTY) 
+{
+    CountingAllocator<int>::reset();
+    CountingAllocator<int*>::reset();
+    {
+        CountingDeque x;
+        CountingDeque y(0);
+        CountingDeque z(x);
+        ASSERT_TRUE(z.empty());
+    }
+    ASSERT_TRUE(CountingAllocator<int>::allocations == 0);
+    ASSERT_TRUE(CountingAllocator<int*>::allocations == 0);
+}
+
+TEST(AllocationTest, TEST_LAZY_BLOCKS) 
+{
+    CountingAllocator<int>::reset();
+    {
+        CountingDeque x;
+        x.push_back(1);
+        ASSERT_TRUE(CountingAllocator<int>::allocations == 1);
+        x.push_front(2);
+        ASSERT_TRUE(CountingAllocator<int>::allocations == 2);
+
+        //only the blocks that hold elements are allocated
+        CountingDeque y(100, 7);
+        ASSERT_TRUE(CountingAllocator<int>::allocations == 2 + (100 + 7) / 8);
+        CountingDeque z(y);
+        ASSERT_TRUE(CountingAllocator<int>::allocations == 2 + 2 * ((100 + 7) / 8));
+        ASSERT_TRUE(y == z);
+    }
+    ASSERT_TRUE(CountingAllocator<int>::allocations == CountingAllocator<int>::deallocations);
+}
+
+TEST(AllocationTest, TEST_BLOCK_CACHE_FIFO) 
+{
+    CountingDeque x;
+    for(int i = 0; i < 100; ++i)
+    {
+        x.push_back(i);
+    }
+    for(int i = 0; i < 100; ++i)
+    {
+        x.push_back(i);
+        x.pop_front();
+    }
+
+    //blocks drained at the front feed the back without touching the allocator
+    CountingAllocator<int>::reset();
+    for(int i = 0; i < 100000; ++i)
+    {
+        x.push_back(i);
+        x.pop_front();
+    }
+    ASSERT_TRUE(CountingAllocator<int>::allocations == 0);
+    ASSERT_TRUE(CountingAllocator<int>::deallocations == 0);
+    ASSERT_TRUE(x.block_cache_statistics().hits >= 100000 / 8 - 1);
+    ASSERT_TRUE(x.block_cache_statistics().hit_rate() > 0.9);
+}
+
+TEST(AllocationTest, TEST_BLOCK_CACHE_CAPACITY) 
+{
+    CountingDeque x;
+    ASSERT_TRUE(x.block_cache_capacity() == CountingDeque::default_block_cache_capacity);
+    for(int i = 0; i < 800; ++i)
+    {
+        x.push_back(i);
+    }
+
+    //popping everything retires 100 blocks, but only the capacity is kept
+    CountingAllocator<int>::reset();
+    x.set_block_cache_capacity(10);
+    while(!x.empty())
+    {
+        x.pop_back();
+    }
+    ASSERT_TRUE(CountingAllocator<int>::deallocations == 100 - 10);
+
+    x.set_block_cache_capacity(3);
+    ASSERT_TRUE(CountingAllocator<int>::deallocations == 100 - 3);
+
+    x.set_block_cache_capacity(0);
+    ASSERT_TRUE(CountingAllocator<int>::deallocations == 100);
+    x.push_front(1);
+    x.pop_front();
+    ASSERT_TRUE(CountingAllocator<int>::allocations == 1);
+    ASSERT_TRUE(CountingAllocator<int>::deallocations == 101);
+    ASSERT_TRUE(x.block_cache_statistics().misses > 0);
+}
+
+TYPED_TEST(TypeTest, TEST_ERASE_4) 
+{
+    typename TestFixture::Container::iterator it = this->non_full.erase(this->non_full.end() - 10);
+    ASSERT_TRUE(*it == 42);
+    it = this->non_full.erase(this->non_full.begin() + 10);
+    ASSERT_TRUE(*it == 12);
+    ASSERT_TRUE(this->non_full.size() == 48);
+}
+
+TYPED_TEST(TypeTest, TEST_MOVE_CONSTRUCTOR_1) 
+{
+    typename TestFixture::Container copy(this->random_packed);
+    typename TestFixture::Container x(std::move(this->random_packed));
+    ASSERT_TRUE(x == copy);
+    ASSERT_TRUE(this->random_packed.empty());
+    this->random_packed.push_back(5);
+    ASSERT_TRUE(this->random_packed.front() == 5);
+}
+
+TYPED_TEST(TypeTest, TEST_MOVE_ASSIGN_1) 
+{
+    typename TestFixture::Container copy(this->non_full);
+    this->full_of_1 = std::move(this->non_full);
+    ASSERT_TRUE(this->full_of_1 == copy);
+    ASSERT_TRUE(this->non_full.empty());
+    this->non_full.push_front(5);
+    ASSERT_TRUE(this->non_full.back() == 5);
+}
+
+TYPED_TEST(TypeTest, TEST_EMPLACE_1) 
+{
+    this->non_full.emplace(this->non_full.begin() + 5, 100);
+    this->non_full.emplace(this->non_full.end() - 5, 200);
+    this->non_full.emplace(this->non_full.begin(), 300);
+    this->non_full.emplace(this->non_full.end(), 400);
+    ASSERT_TRUE(this->non_full.size() == 54);
+    ASSERT_TRUE(this->non_full[0] == 300);
+    ASSERT_TRUE(this->non_full[6] == 100);
+    ASSERT_TRUE(this->non_full[7] == 6);
+    ASSERT_TRUE(this->non_full[47] == 200);
+    ASSERT_TRUE(this->non_full[48] == 46);
+    ASSERT_TRUE(this->non_full[53] == 400);
+}
+
+TYPED_TEST(TypeTest, TEST_EMPLACE_2) 
+{
+    //the argument refers to an element that moves during the shift
+    this->non_full.emplace(this->non_full.begin() + 1, this->non_full.front());
+    this->non_full.emplace(this->non_full.end() - 1, this->non_full.back());
+    ASSERT_TRUE(this->non_full[1] == 1);
+    ASSERT_TRUE(this->non_full[50] == 50);
+    ASSERT_TRUE(this->non_full.size() == 52);
+}
+
+TEST(MoveTest, TEST_EMPLACE_BACK) 
+{
+    MyDeque<pair<int, string> > x;
+    x.emplace_back(1, "one");
+    x.emplace_front(0, "zero");
+    ASSERT_TRUE(x.emplace_back(2, "two").second == "two");
+    ASSERT_TRUE(x.size() == 3);
+    ASSERT_TRUE(x[0].second == "zero");
+    ASSERT_TRUE(x[1].first == 1);
+}
+
+TEST(MoveTest, TEST_MOVE_ONLY) 
+{
+    MyDeque<unique_ptr<int>, allocator<unique_ptr<int> >, 4> x;
+    for(int i = 0; i < 20; ++i)
+    {
+        x.push_back(unique_ptr<int>(new int(i)));
+    }
+    x.push_front(unique_ptr<int>(new int(-1)));
+    x.emplace(x.begin() + 3, new int(100));
+    x.insert(x.end() - 3, unique_ptr<int>(new int(200)));
+    x.erase(x.begin() + 1);
+    x.erase(x.end() - 2);
+    ASSERT_TRUE(x.size() == 21);
+    ASSERT_TRUE(*x[0] == -1);
+    ASSERT_TRUE(*x[2] == 100);
+    ASSERT_TRUE(*x[3] == 2);
+    ASSERT_TRUE(*x[18] == 200);
+    ASSERT_TRUE(*x[19] == 17);
+    ASSERT_TRUE(*x[20] == 19);
+
+    MyDeque<unique_ptr<int>, allocator<unique_ptr<int> >, 4> y(std::move(x));
+    ASSERT_TRUE(x.empty());
+    ASSERT_TRUE(*y.back() == 19);
+    x = std::move(y);
+    ASSERT_TRUE(*x.front() == -1);
+    x.resize(30);
+    ASSERT_TRUE(!x.back());
+}
+
+TEST(MoveTest, TEST_NO_COPIES) 
+{
+    MyDeque<CopyCounter, allocator<CopyCounter>, 4> x;
+    CopyCounter::copies = 0;
+    for(int i = 0; i < 100; ++i)
+    {
+        x.push_back(CopyCounter(i));
+        x.emplace_front(i);
+    }
+    x.insert(x.begin() + 10, CopyCounter(1000));
+    x.insert(x.end() - 10, CopyCounter(2000));
+    x.emplace(x.begin() + 50, 3000);
+    x.erase(x.begin() + 20);
+    x.erase(x.end() - 20);
+    MyDeque<CopyCounter, allocator<CopyCounter>, 4> y(std::move(x));
+    x = std::move(y);
+    ASSERT_TRUE(CopyCounter::copies == 0);
+    ASSERT_TRUE(x.size() == 201);
+    ASSERT_TRUE(x[10].value == 1000);
+    ASSERT_TRUE(x[49].value == 3000);
+}
+
+// -----------
+// TrivialTest
+// -----------
+
+struct Pod
+{
+    int a;
+    int b;
+    double c;
+};
+
+bool operator == (const Pod& lhs, const Pod& rhs)
+{
+    return lhs.a == rhs.a && lhs.b == rhs.b && lhs.c == rhs.c;
+}
+
+/**
+ * apply the same random inserts, erases, copies and assignments to a MyDeque and a std::deque
+ */
+template <typename D, typename V>
+void random_operations (D& x, deque<V>& y, V (*make)(int))
+{
+    srand(378);
+    for(int i = 0; i < 2000; ++i)
+    {
+        int op = rand() % 6;
+        int position = y.empty() ? 0 : rand() % (y.size() + 1);
+        if(op < 2)
+        {
+            x.insert(x.begin() + position, make(i));
+            y.insert(y.begin() + position, make(i));
+        }
+        else if(op < 3 && !y.empty())
+        {
+            position = rand() % y.size();
+            x.erase(x.begin() + position);
+            y.erase(y.begin() + position);
+        }
+        else if(op < 4)
+        {
+            x.push_front(make(i));
+            y.push_front(make(i));
+        }
+        else if(op < 5)
+        {
+            x.push_back(make(i));
+            y.push_back(make(i));
+        }
+        else if(i % 50 == 0)
+        {
+            D copy(x);
+            D shorter(y.size() / 2, make(-1));
+            shorter = copy;
+            x = shorter;
+        }
+    }
+    ASSERT_TRUE(x.size() == y.size());
+    ASSERT_TRUE(equal(y.begin(), y.end(), x.begin()));
+}
+
+Pod make_pod (int i)
+{
+    Pod p = {i, -i, i / 2.0};
+    return p;
+}
+
+string make_string (int i)
+{
+    ostringstream out;
+    out << "element " << i;
+    return out.str();
+}
+
+TEST(TrivialTest, TEST_POD_MATCHES_STD_DEQUE) 
+{
+    MyDeque<Pod, allocator<Pod>, 4> x;
+    deque<Pod> y;
+    random_operations(x, y, make_pod);
+}
+
+TEST(TrivialTest, TEST_STRING_MATCHES_STD_DEQUE) 
+{
+    MyDeque<string, allocator<string>, 4> x;
+    deque<string> y;
+    random_operations(x, y, make_string);
+}
+
+TEST(TrivialTest, TEST_COPY_UNALIGNED) 
+{
+    //the copy starts at a different offset within its blocks than the source
+    MyDeque<int, allocator<int>, 8> x;
+    for(int i = 0; i < 100; ++i)
+    {
+        x.push_front(i);
+    }
+    MyDeque<int, allocator<int>, 8> y(3, 0);
+    y = x;
+    MyDeque<int, allocator<int>, 8> z(x);
+    ASSERT_TRUE(x == y);
+    ASSERT_TRUE(x == z);
+}
+
+// ---------
+// Segmented
+// ---------
+
+struct SegmentCounter
+{
+    int spans;
+    long sum;
+
+    SegmentCounter () : spans(0), sum(0) {}
+
+    void operator () (const int* p, const int* q)
+    {
+        ++spans;
+        for(; p != q; ++p)
+        {
+            sum += *p;
+        }
+    }
+};
+
+TYPED_TEST(TypeTest, TEST_FOR_EACH_SEGMENT_1) 
+{
+    typedef typename TestFixture::Container Container;
+    const Container& x = this->non_full;
+    SegmentCounter counter = for_each_segment(x.begin() + 3, x.end() - 2, SegmentCounter());
+    ASSERT_TRUE(counter.sum == (48 * 49) / 2 - (1 + 2 + 3));
+    //every span stays inside one block
+    ASSERT_TRUE(counter.spans >= int(45 / Container::block_size));
+    ASSERT_TRUE(counter.spans <= int(45 / Container::block_size) + 2);
+}
+
+TYPED_TEST(TypeTest, TEST_FOR_EACH_SEGMENT_2) 
+{
+    SegmentCounter counter = for_each_segment(this->empty.begin(), this->empty.end(), SegmentCounter());
+    ASSERT_TRUE(counter.spans == 0);
+}
+
+TYPED_TEST(TypeTest, TEST_SEGMENTED_ALGORITHMS_1) 
+{
+    int sum = 0;
+    for_each(this->non_full.begin(), this->non_full.end(), [&sum] (int v) { sum += v; });
+    ASSERT_TRUE(sum == (50 * 51) / 2);
+
+    ASSERT_TRUE(find(this->non_full.begin(), this->non_full.end(), 37) == this->non_full.begin() + 36);
+    ASSERT_TRUE(find(this->non_full.begin(), this->non_full.end(), 51) == this->non_full.end());
+    ASSERT_TRUE(find(this->non_full.begin() + 10, this->non_full.end(), 5) == this->non_full.end());
+}
+
+TYPED_TEST(TypeTest, TEST_SEGMENTED_ALGORITHMS_2) 
+{
+    fill(this->full_of_0.begin() + 7, this->full_of_0.end() - 7, 1);
+    ASSERT_TRUE(this->full_of_0[6] == 0);
+    ASSERT_TRUE(this->full_of_0[7] == 1);
+    ASSERT_TRUE(this->full_of_0[92] == 1);
+    ASSERT_TRUE(this->full_of_0[93] == 0);
+
+    vector<int> v(50);
+    ASSERT_TRUE(copy(this->non_full.begin(), this->non_full.end(), v.begin()) == v.end());
+    ASSERT_TRUE(equal(this->non_full.begin(), this->non_full.end(), v.begin()));
+    v[25] = 0;
+    ASSERT_FALSE(equal(this->non_full.begin(), this->non_full.end(), v.begin()));
+
+    //the target starts at a different offset within its blocks
+    typename TestFixture::Container x(3, 0);
+    x.resize(53);
+    ASSERT_TRUE(copy(this->non_full.begin(), this->non_full.end(), x.begin() + 3) == x.end());
+    ASSERT_TRUE(equal(this->non_full.begin(), this->non_full.end(), x.begin() + 3));
+}
+
+TYPED_TEST(TypeTest, TEST_LESS_THAN_6) 
+{
+    //differences on either side of a block boundary
+    typename TestFixture::Container x(this->non_full);
+    for(int i = 0; i < 50; ++i)
+    {
+        x[i] -= 1;
+        ASSERT_TRUE(x < this->non_full);
+        ASSERT_FALSE(this->non_full < x);
+        x[i] += 1;
+    }
+    ASSERT_FALSE(x < this->non_full);
+}
+
+// ----------
+// OrderTest
+// ----------
+
+namespace {
+
+//ordered by key alone, with no ==: equivalent under < without being equal
+struct keyed {
+    int key;
+    int payload;};
+
+bool operator < (const keyed& lhs, const keyed& rhs) {
+    return lhs.key < rhs.key;}
+
+}
+
+TEST(OrderTest, TEST_LESS_THAN_NAN)
+{
+    //NaN is neither equal to nor ordered against itself, so the next element decides
+    const double nan = std::numeric_limits<double>::quiet_NaN();
+    const std::deque<double> sx = {nan, nan, 1};
+    const std::deque<double> sy = {nan, nan, 2};
+    MyDeque<double> x(sx.begin(), sx.end());
+    MyDeque<double> y(sy.begin(), sy.end());
+    ASSERT_EQ(x < y, sx < sy);
+    ASSERT_TRUE(x < y);
+    ASSERT_FALSE(y < x);
+
+    //the same across block boundaries
+    MyDeque<double, allocator<double>, 1> u(sx.begin(), sx.end());
+    MyDeque<double, allocator<double>, 1> v(sy.begin(), sy.end());
+    ASSERT_TRUE(u < v);
+    ASSERT_FALSE(v < u);
+}
+
+TEST(OrderTest, TEST_LESS_THAN_KEY_ONLY)
+{
+    const std::deque<keyed> sx = {{1, 5}, {1, 0}};
+    const std::deque<keyed> sy = {{1, 3}, {2, 0}};
+    MyDeque<keyed> x(sx.begin(), sx.end());
+    MyDeque<keyed> y(sy.begin(), sy.end());
+    ASSERT_EQ(x < y, sx < sy);
+    ASSERT_TRUE(x < y);
+    ASSERT_FALSE(y < x);
+
+    MyDeque<keyed, allocator<keyed>, 1> u(sx.begin(), sx.end());
+    MyDeque<keyed, allocator<keyed>, 1> v(sy.begin(), sy.end());
+    ASSERT_TRUE(u < v);
+    ASSERT_FALSE(v < u);
+    ASSERT_FALSE(u < u);
+}
+
+// -------------
+// RandomAccess
+// -------------
+
+TYPED_TEST(TypeTest, TEST_ITERATOR_DIFFERENCE_1) 
+{
+    typedef typename TestFixture::Container Container;
+    ASSERT_TRUE(this->non_full.end() - this->non_full.begin() == 50);
+    ASSERT_TRUE(this->non_full.begin() - this->non_full.end() == -50);
+    ASSERT_TRUE(distance(this->non_full.begin() + 7, this->non_full.end() - 3) == 40);
+    ASSERT_TRUE(this->empty.end() - this->empty.begin() == 0);
+
+    const Container& x = this->non_full;
+    ASSERT_TRUE(x.end() - x.begin() == 50);
+    typename Container::const_iterator it = this->non_full.begin() + 20;
+    ASSERT_TRUE(it - x.begin() == 20);
+}
+
+TYPED_TEST(TypeTest, TEST_ITERATOR_COMPARE_1) 
+{
+    typename TestFixture::Container::iterator b = this->non_full.begin();
+    typename TestFixture::Container::iterator e = this->non_full.end();
+    ASSERT_TRUE(b < e);
+    ASSERT_TRUE(b <= e);
+    ASSERT_TRUE(e > b);
+    ASSERT_TRUE(e >= b);
+    ASSERT_FALSE(b < b);
+    ASSERT_TRUE(b <= b);
+    for(int i = 0; i < 49; ++i)
+    {
+        ASSERT_TRUE(b + i < b + (i + 1));
+    }
+
+    typename TestFixture::Container::const_iterator c = b + 10;
+    ASSERT_TRUE(c > b);
+    ASSERT_TRUE(c < e);
+}
+
+TYPED_TEST(TypeTest, TEST_ITERATOR_SUBSCRIPT_1) 
+{
+    typename TestFixture::Container::iterator it = this->non_full.begin() + 10;
+    ASSERT_TRUE(it[0] == 11);
+    ASSERT_TRUE(it[25] == 36);
+    ASSERT_TRUE(it[-10] == 1);
+    ASSERT_TRUE(*(5 + it) == 16);
+    it[1] = 100;
+    ASSERT_TRUE(this->non_full[11] == 100);
+}
+
+TYPED_TEST(TypeTest, TEST_STL_ALGORITHMS_1) 
+{
+    typedef typename TestFixture::Container::iterator iterator;
+    ASSERT_TRUE((is_same<typename iterator_traits<iterator>::iterator_category, random_access_iterator_tag>::value));
+
+    sort(this->random_packed.begin(), this->random_packed.end());
+    ASSERT_TRUE(is_sorted(this->random_packed.begin(), this->random_packed.end()));
+
+    iterator it = lower_bound(this->non_full.begin(), this->non_full.end(), 25);
+    ASSERT_TRUE(it - this->non_full.begin() == 24);
+
+    reverse(this->non_full.begin(), this->non_full.end());
+    nth_element(this->non_full.begin(), this->non_full.begin() + 10, this->non_full.end());
+    ASSERT_TRUE(this->non_full[10] == 11);
+}
+
+// ---------
+// RangeTest
+// ---------
 
+/**
+ * apply the same random range inserts, range erases, bulk appends and assigns to a MyDeque and a std::deque
+ */
+template <typename D, typename V>
+void random_range_operations (D& x, deque<V>& y, V (*make)(int))
+{
+    srand(378);
+    for(int i = 0; i < 1000; ++i)
+    {
+        int op = rand() % 6;
+        int position = rand() % (y.size() + 1);
+        int n = rand() % 20;
+        vector<V> values;
+        for(int j = 0; j < n; ++j)
+        {
+            values.push_back(make(i * 20 + j));
+        }
+        if(op < 2)
+        {
+            x.insert(x.begin() + position, values.begin(), values.end());
+            y.insert(y.begin() + position, values.begin(), values.end());
+        }
+        else if(op < 3)
+        {
+            x.insert(x.begin() + position, n, make(i));
+            y.insert(y.begin() + position, n, make(i));
+        }
+        else if(op < 4)
+        {
+            int last = position + rand() % (y.size() - position + 1);
+            x.erase(x.begin() + position, x.begin() + last);
+            y.erase(y.begin() + position, y.begin() + last);
+        }
+        else if(op < 5)
+        {
+            x.append_range(values);
+            y.insert(y.end(), values.begin(), values.end());
+        }
+        else
+        {
+            x.prepend_range(values);
+            y.insert(y.begin(), values.begin(), values.end());
+        }
+        if(i % 100 == 99)
+        {
+            x.assign(values.begin(), values.end());
+            y.assign(values.begin(), values.end());
+        }
+        ASSERT_TRUE(x.size() == y.size());
+    }
+    ASSERT_TRUE(equal(y.begin(), y.end(), x.begin()));
+}
+
+TEST(RangeTest, TEST_POD_MATCHES_STD_DEQUE) 
+{
+    MyDeque<Pod, allocator<Pod>, 4> x;
+    deque<Pod> y;
+    random_range_operations(x, y, make_pod);
+}
+
+TEST(RangeTest, TEST_STRING_MATCHES_STD_DEQUE) 
+{
+    MyDeque<string, allocator<string>, 4> x;
+    deque<string> y;
+    random_range_operations(x, y, make_string);
+}
+
+TEST(RangeTest, TEST_INSERT_INPUT_ITERATOR) 
+{
+    istringstream in("1 2 3 4 5 6 7 8 9 10");
+    MyDeque<int, allocator<int>, 4> x(3, 0);
+    x.insert(x.begin() + 1, istream_iterator<int>(in), istream_iterator<int>());
+    ASSERT_TRUE(x.size() == 13);
+    ASSERT_TRUE(x[0] == 0);
+    ASSERT_TRUE(x[1] == 1);
+    ASSERT_TRUE(x[10] == 10);
+    ASSERT_TRUE(x[12] == 0);
+}
+
+TEST(RangeTest, TEST_INSERT_ALIASED_VALUE) 
+{
+    //the value to copy lives in the part of the deque that gets shifted
+    MyDeque<string, allocator<string>, 4> x;
+    for(int i = 0; i < 10; ++i)
+    {
+        x.push_back(make_string(i));
+    }
+    x.insert(x.begin() + 1, 5, x[0]);
+    x.insert(x.end() - 1, 5, x[x.size() - 1]);
+    ASSERT_TRUE(x.size() == 20);
+    ASSERT_TRUE(x[5] == make_string(0));
+    ASSERT_TRUE(x[6] == make_string(1));
+    ASSERT_TRUE(x[18] == make_string(9));
+}
+
+TEST(RangeTest, TEST_RANGE_CONSTRUCTOR) 
+{
+    list<int> l;
+    for(int i = 0; i < 30; ++i)
+    {
+        l.push_back(i);
+    }
+    MyDeque<int, allocator<int>, 8> x(l.begin(), l.end());
+    ASSERT_TRUE(x.size() == 30);
+    ASSERT_TRUE(equal(l.begin(), l.end(), x.begin()));
+
+    //integral arguments still pick the fill constructor
+    MyDeque<int, allocator<int>, 8> y(5, 7);
+    ASSERT_TRUE(y.size() == 5);
+    ASSERT_TRUE(y[4] == 7);
+}
+
+TEST(RangeTest, TEST_ASSIGN) 
+{
+    MyDeque<int, allocator<int>, 8> x(40, 1);
+    x.assign(10, 2);
+    ASSERT_TRUE(x.size() == 10);
+    ASSERT_TRUE(x[9] == 2);
+    x.assign(50, 3);
+    ASSERT_TRUE(x.size() == 50);
+    ASSERT_TRUE(x[0] == 3 && x[49] == 3);
+}
+
+TEST(RangeTest, TEST_ERASE_RETURN) 
+{
+    MyDeque<int, allocator<int>, 4> x;
+    for(int i = 0; i < 20; ++i)
+    {
+        x.push_back(i);
+    }
+    MyDeque<int, allocator<int>, 4>::iterator it = x.erase(x.begin() + 2, x.begin() + 5);
+    ASSERT_TRUE(*it == 5);
+    it = x.erase(x.begin() + 10, x.begin() + 15);
+    ASSERT_TRUE(*it == 18);
+    it = x.erase(x.begin(), x.end());
+    ASSERT_TRUE(it == x.end());
+    ASSERT_TRUE(x.empty());
+    x.push_back(1);
+    x.push_front(0);
+    ASSERT_TRUE(x.size() == 2 && x[1] == 1);
+}
+
+TEST(RangeTest, TEST_ERASE_EMPTY_RANGE) 
+{
+    MyDeque<vector<int>, allocator<vector<int> >, 4> x;
+    for(int i = 0; i < 10; ++i)
+    {
+        x.push_back(vector<int>(3, i));
+    }
+    MyDeque<vector<int>, allocator<vector<int> >, 4>::iterator it = x.erase(x.begin() + 2, x.begin() + 2);
+    ASSERT_TRUE(it == x.begin() + 2);
+    it = x.erase(x.begin() + 8, x.begin() + 8);
+    ASSERT_TRUE(it == x.begin() + 8);
+    it = x.erase(x.end(), x.end());
+    ASSERT_TRUE(it == x.end());
+    ASSERT_TRUE(x.size() == 10);
+    for(int i = 0; i < 10; ++i)
+    {
+        ASSERT_TRUE(x[i] == vector<int>(3, i));
+    }
+}
+
+TEST(AllocationTest, TEST_APPEND_RANGE_ONE_MAP_GROWTH) 
+{
+    vector<int> values(1000, 7);
+    CountingAllocator<int>::reset();
+    CountingAllocator<int*>::reset();
+    {
+        CountingDeque x(10, 1);
+        int maps = CountingAllocator<int*>::allocations;
+        x.append_range(values);
+        ASSERT_TRUE(CountingAllocator<int*>::allocations == maps + 1);
+        x.prepend_range(values);
+        ASSERT_TRUE(CountingAllocator<int*>::allocations <= maps + 2);
+        ASSERT_TRUE(x.size() == 2010);
+        ASSERT_TRUE(x[0] == 7 && x[1000] == 1 && x[2009] == 7);
+    }
+    ASSERT_TRUE(CountingAllocator<int>::allocations == CountingAllocator<int>::deallocations);
+    ASSERT_TRUE(CountingAllocator<int*>::allocations == CountingAllocator<int*>::deallocations);
+}
+
+// --------------
+// ConcurrentTest
+// --------------
+
+TEST(ConcurrentTest, TEST_SPSC_SINGLE_THREAD) 
+{
+    SPSCDeque<int, allocator<int>, 4> x;
+    int v = -1;
+    ASSERT_TRUE(x.empty());
+    ASSERT_FALSE(x.try_pop_front(v));
+    ASSERT_TRUE(v == -1);
+    for(int i = 0; i < 100; ++i)
+    {
+        x.push_back(i);
+    }
+    ASSERT_TRUE(x.size() == 100);
+    for(int i = 0; i < 100; ++i)
+    {
+        ASSERT_TRUE(x.try_pop_front(v));
+        ASSERT_TRUE(v == i);
+    }
+    ASSERT_TRUE(x.empty());
+}
+
+TEST(ConcurrentTest, TEST_SPSC_RECYCLES_BLOCKS) 
+{
+    //a queue that never holds more than a few blocks stops allocating once the cache is warm
+    CountingAllocator<int>::reset();
+    CountingAllocator<int*>::reset();
+    {
+        SPSCDeque<int, CountingAllocator<int>, 8> x;
+        int v;
+        for(int i = 0; i < 10000; ++i)
+        {
+            x.push_back(i);
+            if(i >= 20)
+            {
+                ASSERT_TRUE(x.try_pop_front(v));
+                ASSERT_TRUE(v == i - 20);
+            }
+        }
+        ASSERT_TRUE(CountingAllocator<int>::allocations <= 8);
+        ASSERT_TRUE(CountingAllocator<int*>::allocations <= 2);
+    }
+    ASSERT_TRUE(CountingAllocator<int>::allocations == CountingAllocator<int>::deallocations);
+    ASSERT_TRUE(CountingAllocator<int*>::allocations == CountingAllocator<int*>::deallocations);
+}
+
+TEST(ConcurrentTest, TEST_SPSC_DESTROYS_REMAINING) 
+{
+    SPSCDeque<string, allocator<string>, 4> x(0);
+    string v;
+    for(int i = 0; i < 50; ++i)
+    {
+        x.push_back(make_string(i));
+    }
+    for(int i = 0; i < 10; ++i)
+    {
+        ASSERT_TRUE(x.try_pop_front(v));
+    }
+    ASSERT_TRUE(v == make_string(9));
+    ASSERT_TRUE(x.size() == 40);
+}
+
+TEST(ConcurrentTest, TEST_SPSC_TWO_THREADS) 
+{
+    //a small block size makes the map grow and blocks cycle while the consumer reads
+    const int n = 200000;
+    SPSCDeque<string, allocator<string>, 4> x;
+    thread producer([&x, n] () {
+        for(int i = 0; i < n; ++i)
+        {
+            x.push_back(make_string(i));
+        }});
+    string v;
+    for(int i = 0; i < n; ++i)
+    {
+        while(!x.try_pop_front(v))
+        {
+            this_thread::yield();
+        }
+        ASSERT_TRUE(v == make_string(i));
+    }
+    producer.join();
+    ASSERT_TRUE(x.empty());
+}
+
+TEST(ConcurrentTest, TEST_WORK_STEALING_SINGLE_THREAD) 
+{
+    //the owner sees a stack, thieves see a queue
+    WorkStealingDeque<int, allocator<int>, 4> x(1);
+    int v = -1;
+    ASSERT_FALSE(x.try_pop_back(v));
+    ASSERT_FALSE(x.try_steal_front(v));
+    for(int i = 0; i < 100; ++i)
+    {
+        x.push_back(i);
+    }
+    ASSERT_TRUE(x.size() == 100);
+    for(int i = 0; i < 50; ++i)
+    {
+        ASSERT_TRUE(x.try_steal_front(v));
+        ASSERT_TRUE(v == i);
+        ASSERT_TRUE(x.try_pop_back(v));
+        ASSERT_TRUE(v == 99 - i);
+    }
+    ASSERT_TRUE(x.empty());
+    ASSERT_FALSE(x.try_pop_back(v));
+    x.push_back(7);
+    ASSERT_TRUE(x.try_pop_back(v));
+    ASSERT_TRUE(v == 7);
+}
+
+TEST(ConcurrentTest, TEST_WORK_STEALING_FREES_EVERYTHING) 
+{
+    CountingAllocator<int>::reset();
+    CountingAllocator<atomic<int> >::reset();
+    {
+        WorkStealingDeque<int, CountingAllocator<int>, 8> x;
+        for(int i = 0; i < 1000; ++i)
+        {
+            x.push_back(i);
+        }
+        //the ring only grows when it is full
+        ASSERT_TRUE(CountingAllocator<atomic<int> >::allocations == 128);
+    }
+    ASSERT_TRUE(CountingAllocator<atomic<int> >::allocations == CountingAllocator<atomic<int> >::deallocations);
+}
+
+TEST(ConcurrentTest, TEST_WORK_STEALING_EACH_ELEMENT_ONCE) 
+{
+    //the owner pushes and pops while thieves steal; every element must be taken exactly once
+    const int n = 100000;
+    const int thieves = 3;
+    WorkStealingDeque<int, allocator<int>, 4> x(1);
+    vector<atomic<int> > taken(n);
+    for(int i = 0; i < n; ++i)
+    {
+        taken[i].store(0);
+    }
+    atomic<bool> done(false);
+    vector<thread> threads;
+    for(int j = 0; j < thieves; ++j)
+    {
+        threads.push_back(thread([&] () {
+            int v;
+            while(!done.load())
+            {
+                if(x.try_steal_front(v))
+                {
+                    ++taken[v];
+                }
+            }}));
+    }
+    int v;
+    for(int i = 0; i < n; ++i)
+    {
+        x.push_back(i);
+        if(i % 3 == 0 && x.try_pop_back(v))
+        {
+            ++taken[v];
+        }
+    }
+    while(x.try_pop_back(v))
+    {
+        ++taken[v];
+    }
+    while(!x.empty())
+    {
+        this_thread::yield();
+    }
+    done.store(true);
+    for(int j = 0; j < thieves; ++j)
+    {
+        threads[j].join();
+    }
+    for(int i = 0; i < n; ++i)
+    {
+        ASSERT_TRUE(taken[i].load() == 1);
+    }
+}
+
+TEST(ConcurrentTest, TEST_MPMC_SINGLE_THREAD) 
+{
+    MPMCDeque<string, allocator<string>, 4> x(10);
+    string v;
+    ASSERT_TRUE(x.capacity() == 16);
+    ASSERT_FALSE(x.try_pop_front(v));
+    for(int i = 0; i < 16; ++i)
+    {
+        ASSERT_TRUE(x.try_push_back(make_string(i)));
+    }
+    ASSERT_FALSE(x.try_push_back(make_string(16)));
+    ASSERT_TRUE(x.size() == 16);
+    for(int i = 0; i < 40; ++i)
+    {
+        ASSERT_TRUE(x.try_pop_front(v));
+        ASSERT_TRUE(v == make_string(i));
+        ASSERT_TRUE(x.try_emplace_back(make_string(i + 16)));
+    }
+    //the destructor cleans up the 16 that are left
+    ASSERT_TRUE(x.size() == 16);
+}
+
+TEST(ConcurrentTest, TEST_MPMC_FULL_LEAVES_RVALUE)
+{
+    //a push that finds the deque full must not move from its argument
+    MPMCDeque<string, allocator<string>, 4> x(4);
+    for(int i = 0; i < 4; ++i)
+    {
+        ASSERT_TRUE(x.try_push_back(make_string(i)));
+    }
+    string v = make_string(100);
+    ASSERT_FALSE(x.try_push_back(std::move(v)));
+    ASSERT_TRUE(v == make_string(100));
+    ASSERT_FALSE(x.try_emplace_back(std::move(v)));
+    ASSERT_TRUE(v == make_string(100));
+    string w;
+    ASSERT_TRUE(x.try_pop_front(w));
+    ASSERT_TRUE(x.try_push_back(std::move(v)));
+    for(int i = 1; i < 4; ++i)
+    {
+        ASSERT_TRUE(x.try_pop_front(w));
+        ASSERT_TRUE(w == make_string(i));
+    }
+    ASSERT_TRUE(x.try_pop_front(w));
+    ASSERT_TRUE(w == make_string(100));
+}
+
+TEST(ConcurrentTest, TEST_MPMC_EACH_ELEMENT_ONCE) 
+{
+    //several producers and consumers on a queue much smaller than the traffic
+    const int per_producer = 50000;
+    const int producers = 3;
+    const int consumers = 3;
+    MPMCDeque<int, allocator<int>, 8> x(64);
+    vector<atomic<int> > taken(per_producer * producers);
+    for(int i = 0; i < per_producer * producers; ++i)
+    {
+        taken[i].store(0);
+    }
+    vector<thread> threads;
+    for(int j = 0; j < producers; ++j)
+    {
+        threads.push_back(thread([&, j] () {
+            for(int i = 0; i < per_producer; ++i)
+            {
+                x.push_back(j * per_producer + i);
+            }}));
+    }
+    for(int j = 0; j < consumers; ++j)
+    {
+        threads.push_back(thread([&] () {
+            int v;
+            for(int i = 0; i < per_producer * producers / consumers; ++i)
+            {
+                x.pop_front(v);
+                ++taken[v];
+            }}));
+    }
+    for(size_t j = 0; j < threads.size(); ++j)
+    {
+        threads[j].join();
+    }
+    ASSERT_TRUE(x.empty());
+    for(int i = 0; i < per_producer * producers; ++i)
+    {
+        ASSERT_TRUE(taken[i].load() == 1);
+    }
+}
+
+// ---------
+// ArenaTest
+// ---------
+
+typedef MyDeque<int, DequeArenaAllocator<int>, 128> ArenaDeque;
+
+TEST(ArenaTest, TEST_MATCHES_STD_DEQUE) 
+{
+    DequeArena arena(128 * sizeof(int));
+    ArenaDeque x((DequeArenaAllocator<int>(arena)));
+    deque<int> y;
+    for(int i = 0; i < 10000; ++i)
+    {
+        x.push_back(i);
+        y.push_front(i);
+        x.push_front(-i);
+        y.push_back(-i);
+    }
+    for(int i = 0; i < 5000; ++i)
+    {
+        x.pop_front();
+        y.pop_back();
+    }
+    ArenaDeque z(x);
+    ASSERT_TRUE(z.size() == y.size());
+    ASSERT_TRUE(equal(y.rbegin(), y.rend(), z.begin()));
+}
+
+TEST(ArenaTest, TEST_REUSES_FREED_BLOCKS) 
+{
+    //short-lived deques keep cycling through the same chunk
+    DequeArena arena(128 * sizeof(int));
+    for(int j = 0; j < 1000; ++j)
+    {
+        ArenaDeque x((DequeArenaAllocator<int>(arena)));
+        for(int i = 0; i < 1000; ++i)
+        {
+            x.push_back(i);
+        }
+        ASSERT_TRUE(x[999] == 999);
+    }
+    ASSERT_TRUE(arena.bytes_reserved() == DequeArena::default_chunk_bytes);
+}
+
+TEST(ArenaTest, TEST_MONOTONIC_RESET) 
+{
+    DequeArena arena(128 * sizeof(int), true);
+    ASSERT_TRUE(arena.monotonic());
+    for(int j = 0; j < 100; ++j)
+    {
+        {
+            ArenaDeque x((DequeArenaAllocator<int>(arena)));
+            for(int i = 0; i < 5000; ++i)
+            {
+                x.push_front(i);
+            }
+            ASSERT_TRUE(x[0] == 4999);
+        }
+        //nothing is reused until the reset, and then everything is
+        arena.reset();
+    }
+    ASSERT_TRUE(arena.bytes_reserved() <= 2 * DequeArena::default_chunk_bytes);
+}
+
+TEST(ArenaTest, TEST_LARGE_AND_ODD_SIZES) 
+{
+    DequeArena arena(64);
+    void* a = arena.allocate(1);
+    void* b = arena.allocate(100000);
+    void* c = arena.allocate(64);
+    ASSERT_TRUE(reinterpret_cast<size_t>(a) % DequeArena::alignment == 0);
+    ASSERT_TRUE(reinterpret_cast<size_t>(b) % DequeArena::alignment == 0);
+    arena.deallocate(c, 64);
+    ASSERT_TRUE(arena.allocate(64) == c);
+    arena.deallocate(b, 100000);
+    arena.deallocate(a, 1);
+    ASSERT_TRUE(arena.allocate(1) == a);
+}
+
+// -------
+// PmrTest
+// -------
+
+/**
+ * memory_resource that counts the bytes it hands out and takes back
+ */
+struct CountingResource : public std::pmr::memory_resource
+{
+    size_t allocated = 0;
+    size_t deallocated = 0;
+
+    void* do_allocate (size_t bytes, size_t alignment) override
+    {
+        allocated += bytes;
+        return std::pmr::new_delete_resource()->allocate(bytes, alignment);
+    }
+
+    void do_deallocate (void* p, size_t bytes, size_t alignment) override
+    {
+        deallocated += bytes;
+        std::pmr::new_delete_resource()->deallocate(p, bytes, alignment);
+    }
+
+    bool do_is_equal (const std::pmr::memory_resource& that) const noexcept override
+    {
+        return this == &that;
+    }
+};
+
+TEST(PmrTest, TEST_USES_RESOURCE) 
+{
+    CountingResource r;
+    {
+        ::pmr::MyDeque<int> x(&r);
+        for(int i = 0; i < 1000; ++i)
+        {
+            x.push_back(i);
+            x.push_front(i);
+        }
+        ASSERT_TRUE(x.get_allocator().resource() == &r);
+        ASSERT_TRUE(r.allocated > 2000 * sizeof(int));
+    }
+    ASSERT_TRUE(r.allocated == r.deallocated);
+}
+
+TEST(PmrTest, TEST_MONOTONIC_BUFFER) 
+{
+    char buffer[1 << 16];
+    std::pmr::monotonic_buffer_resource r(buffer, sizeof(buffer), std::pmr::null_memory_resource());
+    ::pmr::MyDeque<int> x(&r);
+    for(int i = 0; i < 5000; ++i)
+    {
+        x.push_back(i);
+    }
+    ASSERT_TRUE(x[4999] == 4999);
+}
+
+TEST(PmrTest, TEST_COPY_DOES_NOT_PROPAGATE) 
+{
+    CountingResource r1;
+    CountingResource r2;
+    {
+        ::pmr::MyDeque<int> x(&r1);
+        ::pmr::MyDeque<int> y(&r2);
+        x.push_back(1);
+        x.push_back(2);
+        y = x;
+        ASSERT_TRUE(y.get_allocator().resource() == &r2);
+        ASSERT_TRUE(y.size() == 2 && y[1] == 2);
+
+        //a copy gets the default resource, unless one is given
+        ::pmr::MyDeque<int> z(x);
+        ASSERT_TRUE(z.get_allocator().resource() == std::pmr::get_default_resource());
+        ::pmr::MyDeque<int> w(x, &r2);
+        ASSERT_TRUE(w.get_allocator().resource() == &r2);
+    }
+    ASSERT_TRUE(r1.allocated == r1.deallocated);
+    ASSERT_TRUE(r2.allocated == r2.deallocated);
+}
+
+TEST(PmrTest, TEST_MOVE_BETWEEN_RESOURCES) 
+{
+    CountingResource r1;
+    CountingResource r2;
+    {
+        ::pmr::MyDeque<string> x(&r1);
+        for(int i = 0; i < 100; ++i)
+        {
+            x.push_back(make_string(i));
+        }
+        //different resources: the elements move, the storage stays with each resource
+        ::pmr::MyDeque<string> y(&r2);
+        y = std::move(x);
+        ASSERT_TRUE(y.get_allocator().resource() == &r2);
+        ASSERT_TRUE(y.size() == 100 && y[99] == make_string(99));
+        ASSERT_TRUE(x.empty());
+
+        //the same resource: the storage is taken over without allocating
+        size_t before = r2.allocated;
+        ::pmr::MyDeque<string> z(std::move(y), &r2);
+        ASSERT_TRUE(r2.allocated == before);
+        ASSERT_TRUE(z.size() == 100 && z[0] == make_string(0));
+
+        ::pmr::MyDeque<string> w(std::move(z), &r1);
+        ASSERT_TRUE(w.size() == 100 && w[50] == make_string(50));
+        ASSERT_TRUE(w.get_allocator().resource() == &r1);
+    }
+    ASSERT_TRUE(r1.allocated == r1.deallocated);
+    ASSERT_TRUE(r2.allocated == r2.deallocated);
+}
+
+/**
+ * allocator that propagates on copy, move and swap, identified by id
+ */
+template <typename T>
+struct PropagatingAllocator : public allocator<T>
+{
+    typedef true_type propagate_on_container_copy_assignment;
+    typedef true_type propagate_on_container_move_assignment;
+    typedef true_type propagate_on_container_swap;
+
+    template <typename U>
+    struct rebind
+    {
+        typedef PropagatingAllocator<U> other;
+    };
+
+    int id;
+
+    PropagatingAllocator (int i = 0) : id(i) {}
+
+    template <typename U>
+    PropagatingAllocator (const PropagatingAllocator<U>& that) : id(that.id) {}
+
+    friend bool operator == (const PropagatingAllocator& lhs, const PropagatingAllocator& rhs)
+    {
+        return lhs.id == rhs.id;
+    }
+
+    friend bool operator != (const PropagatingAllocator& lhs, const PropagatingAllocator& rhs)
+    {
+        return lhs.id != rhs.id;
+    }
+};
+
+TEST(PmrTest, TEST_PROPAGATING_ALLOCATOR) 
+{
+    typedef MyDeque<int, PropagatingAllocator<int>, 4> D;
+    D x((PropagatingAllocator<int>(1)));
+    D y((PropagatingAllocator<int>(2)));
+    for(int i = 0; i < 10; ++i)
+    {
+        x.push_back(i);
+        y.push_back(-i);
+    }
+    y = x;
+    ASSERT_TRUE(y.get_allocator().id == 1);
+    ASSERT_TRUE(y == x);
+
+    D z((PropagatingAllocator<int>(3)));
+    z.push_back(7);
+    z.swap(y);
+    ASSERT_TRUE(z.get_allocator().id == 1);
+    ASSERT_TRUE(y.get_allocator().id == 3);
+    ASSERT_TRUE(y.size() == 1);
+
+    D w((PropagatingAllocator<int>(4)));
+    w = std::move(z);
+    ASSERT_TRUE(w.get_allocator().id == 1);
+    ASSERT_TRUE(w == x);
+}
+
+// --------
+// TrimTest
+// --------
+
+/**
+ * @return how many blocks or maps are allocated right now
+ */
+template <typename T>
+int live_allocations ()
+{
+    return CountingAllocator<T>::allocations - CountingAllocator<T>::deallocations;
+}
+
+TEST(TrimTest, TEST_SHRINK_TO_FIT) 
+{
+    CountingAllocator<int>::reset();
+    CountingAllocator<int*>::reset();
+    {
+        CountingDeque x;
+        for(int i = 0; i < 10000; ++i)
+        {
+            x.push_back(i);
+        }
+        for(int i = 0; i < 9990; ++i)
+        {
+            x.pop_front();
+        }
+        x.shrink_to_fit();
+        //the 10 elements left span at most 2 blocks of 8, under a map of exactly those blocks
+        ASSERT_TRUE(live_allocations<int>() <= 2);
+        ASSERT_TRUE(live_allocations<int*>() == 1);
+        ASSERT_TRUE(x.size() == 10);
+        ASSERT_TRUE(x.front() == 9990 && x.back() == 9999);
+
+        //the deque keeps working after the map has been cut down
+        x.push_front(-1);
+        x.push_back(-2);
+        ASSERT_TRUE(x[0] == -1 && x[11] == -2);
+
+        x.clear();
+        x.shrink_to_fit();
+        ASSERT_TRUE(live_allocations<int>() == 0);
+        ASSERT_TRUE(live_allocations<int*>() == 0);
+        x.push_back(5);
+        ASSERT_TRUE(x.front() == 5);
+    }
+    ASSERT_TRUE(live_allocations<int>() == 0);
+    ASSERT_TRUE(live_allocations<int*>() == 0);
+}
+
+TEST(TrimTest, TEST_AUTOMATIC_TRIM) 
+{
+    CountingAllocator<int>::reset();
+    CountingAllocator<int*>::reset();
+    {
+        CountingDeque x;
+        x.set_trim_threshold(0.25);
+        ASSERT_TRUE(x.trim_threshold() == 0.25);
+        for(int j = 0; j < 3; ++j)
+        {
+            //a burst, then a drain back down to a handful of elements
+            for(int i = 0; i < 10000; ++i)
+            {
+                x.push_back(i);
+            }
+            while(x.size() > 5)
+            {
+                x.pop_front();
+            }
+            //the two blocks in use and the spare-block cache, which trimming leaves alone
+            ASSERT_TRUE(live_allocations<int>() <= 2 + static_cast<int>(CountingDeque::default_block_cache_capacity));
+            ASSERT_TRUE(x.memory_statistics().map_capacity < 2 + CountingDeque::trim_slack_blocks);
+        }
+        x.erase(x.begin(), x.end());
+        ASSERT_TRUE(live_allocations<int>() <= 1 + static_cast<int>(CountingDeque::default_block_cache_capacity));
+        x.shrink_to_fit();
+        ASSERT_TRUE(live_allocations<int>() == 0);
+        ASSERT_TRUE(live_allocations<int*>() == 0);
+    }
+    ASSERT_TRUE(live_allocations<int>() == 0);
+}
+
+TEST(TrimTest, TEST_STEADY_FIFO_DOES_NOT_THRASH) 
+{
+    CountingAllocator<int>::reset();
+    CountingAllocator<int*>::reset();
+    {
+        CountingDeque x;
+        x.set_trim_threshold(0.25);
+        for(int i = 0; i < 4; ++i)
+        {
+            x.push_back(i);
+        }
+        for(int i = 0; i < 100000; ++i)
+        {
+            x.push_back(i);
+            x.pop_front();
+        }
+        ASSERT_TRUE(x.size() == 4);
+        ASSERT_TRUE(CountingAllocator<int>::allocations <= 8);
+        ASSERT_TRUE(CountingAllocator<int*>::allocations <= 8);
+        ASSERT_TRUE(x.memory_statistics().map_rebuilds <= 8);
+    }
+    ASSERT_TRUE(live_allocations<int>() == 0);
+    ASSERT_TRUE(live_allocations<int*>() == 0);
+}
+
+TEST(TrimTest, TEST_NO_TRIM_BY_DEFAULT) 
+{
+    CountingDeque x;
+    ASSERT_TRUE(x.trim_threshold() == 0);
+    for(int i = 0; i < 1000; ++i)
+    {
+        x.push_back(i);
+    }
+    CountingAllocator<int*>::reset();
+    while(!x.empty())
+    {
+        x.pop_back();
+    }
+    ASSERT_TRUE(CountingAllocator<int*>::deallocations == 0);
+}
+
+TEST(TrimTest, TEST_MOVE_KEEPS_THRESHOLD) 
+{
+    //the threshold goes with the elements, whether the storage moves or they do
+    CountingResource r1;
+    CountingResource r2;
+    ::pmr::MyDeque<int> x(&r1);
+    x.set_trim_threshold(0.25);
+    for(int i = 0; i < 1000; ++i)
+    {
+        x.push_back(i);
+    }
+    ::pmr::MyDeque<int> same(std::move(x), &r1);
+    ASSERT_TRUE(same.trim_threshold() == 0.25);
+    ::pmr::MyDeque<int> other(std::move(same), &r2);
+    ASSERT_TRUE(other.get_allocator().resource() == &r2);
+    ASSERT_TRUE(other.trim_threshold() == 0.25);
+    ASSERT_TRUE(other.size() == 1000);
+}
+
+TEST(TrimTest, TEST_RESERVE) 
+{
+    CountingDeque x;
+    x.push_back(0);
+    x.reserve_back(1000);
+    x.reserve_front(500);
+    CountingAllocator<int>::reset();
+    CountingAllocator<int*>::reset();
+    for(int i = 1; i <= 1000; ++i)
+    {
+        x.push_back(i);
+    }
+    for(int i = 1; i <= 500; ++i)
+    {
+        x.push_front(-i);
+    }
+    ASSERT_TRUE(CountingAllocator<int>::allocations == 0);
+    ASSERT_TRUE(CountingAllocator<int*>::allocations == 0);
+    ASSERT_TRUE(x.size() == 1501);
+    ASSERT_TRUE(x.front() == -500 && x.back() == 1000 && x[500] == 0);
+}
+
+TYPED_TEST(TypeTest, TEST_SHRINK_TO_FIT_1) 
+{
+    this->non_full.reserve_back(100);
+    this->non_full.reserve_front(100);
+    this->non_full.shrink_to_fit();
+    ASSERT_TRUE(this->non_full.size() == 50);
+    for(int i = 0; i < 50; ++i)
+    {
+        ASSERT_TRUE(this->non_full[i] == i + 1);
+    }
+    this->empty.shrink_to_fit();
+    ASSERT_TRUE(this->empty.empty());
+    this->empty.push_front(1);
+    ASSERT_TRUE(this->empty.back() == 1);
+}
+
+// ----------
+// MemoryTest
+// ----------
+
+TEST(MemoryTest, TEST_EMPTY) 
+{
+    MyDeque<int, allocator<int>, 8> x;
+    MyDeque<int, allocator<int>, 8>::memory_stats stats = x.memory_statistics();
+    ASSERT_TRUE(stats.size == 0);
+    ASSERT_TRUE(stats.blocks == 0);
+    ASSERT_TRUE(stats.map_capacity == 0);
+    ASSERT_TRUE(stats.bytes == 0);
+    ASSERT_TRUE(stats.occupancy() == 0);
+}
+
+TEST(MemoryTest, TEST_MATCHES_ALLOCATOR) 
+{
+    typedef CountingDeque::memory_stats stats_type;
+    CountingAllocator<int>::reset();
+    CountingAllocator<int*>::reset();
+    CountingDeque x;
+    for(int i = 0; i < 1000; ++i)
+    {
+        x.push_back(i);
+    }
+    stats_type stats = x.memory_statistics();
+    ASSERT_TRUE(stats.size == 1000);
+    ASSERT_TRUE(stats.blocks == 125);
+    ASSERT_TRUE(stats.occupancy() == 1.0);
+    ASSERT_TRUE(stats.block_allocations == static_cast<size_t>(CountingAllocator<int>::allocations));
+    ASSERT_TRUE(stats.map_rebuilds == static_cast<size_t>(CountingAllocator<int*>::allocations));
+    ASSERT_TRUE(stats.bytes >= 125 * 8 * sizeof(int) + stats.map_capacity * sizeof(int*));
+    ASSERT_TRUE(stats.front_capacity + stats.size + stats.back_capacity == stats.map_capacity * 8);
+
+    for(int i = 0; i < 500; ++i)
+    {
+        x.pop_front();
+    }
+    stats = x.memory_statistics();
+    ASSERT_TRUE(stats.blocks == 63);
+    ASSERT_TRUE(stats.cached_blocks == CountingDeque::default_block_cache_capacity);
+    ASSERT_TRUE(stats.block_frees == static_cast<size_t>(CountingAllocator<int>::deallocations));
+    ASSERT_TRUE(stats.front_capacity >= 500);
+
+    x.shrink_to_fit();
+    stats = x.memory_statistics();
+    ASSERT_TRUE(stats.map_capacity == 63);
+    ASSERT_TRUE(stats.cached_blocks == 0);
+    ASSERT_TRUE(stats.front_capacity == 4);
+    ASSERT_TRUE(stats.back_capacity == 0);
+    ASSERT_TRUE(stats.bytes == 63 * 8 * sizeof(int) + 63 * sizeof(int*));
+    ASSERT_TRUE(stats.block_frees == static_cast<size_t>(CountingAllocator<int>::deallocations));
+}
+
+TEST(MemoryTest, TEST_RECENTERS) 
+{
+    MyDeque<int, allocator<int>, 8> x;
+    for(int i = 0; i < 100; ++i)
+    {
+        x.push_back(i);
+    }
+    size_t rebuilds = x.memory_statistics().map_rebuilds;
+    for(int i = 0; i < 100000; ++i)
+    {
+        x.push_back(i);
+        x.pop_front();
+    }
+    //a steady FIFO slides along the map, recentering it in place instead of growing it
+    ASSERT_TRUE(x.memory_statistics().map_rebuilds == rebuilds);
+    ASSERT_TRUE(x.memory_statistics().map_recenters > 0);
+}
+
+// -----------
+// TracingTest
+// -----------
+
+struct TracingTag;
+typedef deque_tracing<TracingTag> Tracing;
+typedef MyDeque<int, allocator<int>, 8, Tracing> TracedDeque;
+
+TEST(TracingTest, TEST_NO_INSTRUMENTATION_IS_EMPTY) 
+{
+    ASSERT_TRUE(is_empty<deque_no_instrumentation::scope>::value);
+    ASSERT_TRUE(sizeof(MyDeque<int>) == sizeof(MyDeque<int, allocator<int>, MyDeque<int>::block_size, deque_no_instrumentation>));
+}
+
+TEST(TracingTest, TEST_COUNTS_OPERATIONS) 
+{
+    Tracing::reset();
+    TracedDeque x;
+    for(int i = 0; i < 100; ++i)
+    {
+        x.push_back(i);
+        x.push_front(i);
+    }
+    for(int i = 0; i < 30; ++i)
+    {
+        x.pop_back();
+    }
+    x.pop_front();
+    ASSERT_TRUE(Tracing::latency(deque_push_back).count == 100);
+    ASSERT_TRUE(Tracing::latency(deque_push_front).count == 100);
+    ASSERT_TRUE(Tracing::latency(deque_pop_back).count == 30);
+    ASSERT_TRUE(Tracing::latency(deque_pop_front).count == 1);
+    ASSERT_TRUE(Tracing::latency(deque_insert).count == 0);
+    ASSERT_TRUE(Tracing::latency(deque_map_rebuild).count == x.memory_statistics().map_rebuilds);
+    ASSERT_TRUE(Tracing::latency(deque_map_recenter).count == x.memory_statistics().map_recenters);
+    ASSERT_TRUE(Tracing::latency(deque_map_rebuild).count > 0);
+}
+
+TEST(TracingTest, TEST_SHIFTS) 
+{
+    TracedDeque x(100, 0);
+    Tracing::reset();
+    x.insert(x.begin() + 10, 1);
+    x.erase(x.begin() + 80, x.begin() + 85);
+    x.insert(x.begin() + 50, 3, 2);
+    ASSERT_TRUE(Tracing::latency(deque_insert).count == 2);
+    ASSERT_TRUE(Tracing::latency(deque_erase).count == 1);
+    ASSERT_TRUE(Tracing::latency(deque_shift).units == 10 + 16 + 46);
+    ASSERT_TRUE(x.size() == 99);
+}
+
+TEST(TracingTest, TEST_HISTOGRAM) 
+{
+    Tracing::reset();
+    TracedDeque x;
+    x.resize(10000);
+    for(int i = 0; i < 1000; ++i)
+    {
+        x.push_back(i);
+    }
+    const Tracing::histogram& h = Tracing::latency(deque_push_back);
+    uint64_t total = 0;
+    for(size_t i = 0; i != Tracing::histogram::bucket_count; ++i)
+    {
+        total += h.buckets[i];
+    }
+    ASSERT_TRUE(total == h.count);
+    ASSERT_TRUE(h.quantile(0.5) <= h.quantile(0.99));
+    ASSERT_TRUE(h.quantile(1.0) > 0);
+    ASSERT_TRUE(h.mean() <= h.quantile(1.0));
+    //resize grows the map through reserve_map_back, which the rebuild histogram sees
+    ASSERT_TRUE(Tracing::latency(deque_map_rebuild).count > 0);
+    Tracing::reset();
+    ASSERT_TRUE(h.count == 0);
+    ASSERT_TRUE(h.quantile(0.5) == 0);
+}
+
+// ---------
+// SmallTest
+// ---------
+
+typedef SmallDeque<int, 8, CountingAllocator<int>, 4> CountingSmallDeque;
+
+TEST(SmallTest, TEST_STAYS_INLINE) 
+{
+    CountingAllocator<int>::reset();
+    CountingAllocator<int*>::reset();
+    {
+        CountingSmallDeque x;
+        for(int i = 0; i < 1000; ++i)
+        {
+            x.push_back(i);
+            x.push_front(-i);
+            if(x.size() == 8)
+            {
+                x.pop_back();
+                x.pop_front();
+            }
+        }
+        x.insert(x.begin() + 2, 42);
+        x.erase(x.begin() + 1);
+        ASSERT_TRUE(!x.spilled());
+    }
+    ASSERT_TRUE(CountingAllocator<int>::allocations == 0);
+    ASSERT_TRUE(CountingAllocator<int*>::allocations == 0);
+}
+
+TEST(SmallTest, TEST_MATCHES_STD_DEQUE) 
+{
+    SmallDeque<int, 5, allocator<int>, 4> x;
+    deque<int> y;
+    srand(19);
+    for(int i = 0; i < 5000; ++i)
+    {
+        int op = rand() % 8;
+        if(op == 0 || (op == 1 && y.size() < 3))
+        {
+            x.push_back(i);
+            y.push_back(i);
+        }
+        else if(op == 1 || op == 2)
+        {
+            x.push_front(i);
+            y.push_front(i);
+        }
+        else if(op == 3 && !y.empty())
+        {
+            x.pop_back();
+            y.pop_back();
+        }
+        else if(op == 4 && !y.empty())
+        {
+            x.pop_front();
+            y.pop_front();
+        }
+        else if(op == 5)
+        {
+            size_t p = rand() % (y.size() + 1);
+            ASSERT_TRUE(*x.insert(x.begin() + p, i) == i);
+            y.insert(y.begin() + p, i);
+        }
+        else if(op == 6 && !y.empty())
+        {
+            size_t p = rand() % y.size();
+            x.erase(x.begin() + p);
+            y.erase(y.begin() + p);
+        }
+        else if(op == 7 && y.size() > 20)
+        {
+            x.clear();
+            y.clear();
+            ASSERT_TRUE(!x.spilled());
+        }
+        ASSERT_TRUE(x.size() == y.size());
+        ASSERT_TRUE(equal(x.begin(), x.end(), y.begin()));
+    }
+}
+
+TEST(SmallTest, TEST_SPILL_AND_SHRINK) 
+{
+    SmallDeque<string, 4> x;
+    x.push_back("b");
+    x.push_front("a");
+    x.push_back("c");
+    x.push_back("d");
+    ASSERT_TRUE(!x.spilled());
+    //the argument is an inline element that the spill moves away
+    x.push_back(x.front());
+    ASSERT_TRUE(x.spilled());
+    ASSERT_TRUE(x.size() == 5);
+    ASSERT_TRUE(x.front() == "a");
+    ASSERT_TRUE(x.back() == "a");
+    ASSERT_TRUE(x.at(3) == "d");
+    x.pop_back();
+    x.pop_front();
+    ASSERT_TRUE(x.spilled());
+    x.shrink_to_fit();
+    ASSERT_TRUE(!x.spilled());
+    ASSERT_TRUE(x.size() == 3);
+    ASSERT_TRUE(x[0] == "b");
+    ASSERT_TRUE(x[2] == "d");
+    x.resize(10, "e");
+    ASSERT_TRUE(x.spilled());
+    ASSERT_TRUE(x[9] == "e");
+    x.resize(2);
+    ASSERT_TRUE(x.size() == 2);
+    ASSERT_THROW(x.at(2), out_of_range);
+}
+
+TEST(SmallTest, TEST_COPY_MOVE_SWAP) 
+{
+    typedef SmallDeque<string, 4> small_type;
+    small_type x(3, "x");
+    small_type y(10, "y");
+    small_type z(x);
+    ASSERT_TRUE(z == x);
+    z = y;
+    ASSERT_TRUE(z == y);
+    ASSERT_TRUE(z.spilled());
+    small_type w(std::move(z));
+    ASSERT_TRUE(w == y);
+    ASSERT_TRUE(z.empty());
+    ASSERT_TRUE(!z.spilled());
+    w = std::move(x);
+    ASSERT_TRUE(w.size() == 3);
+    ASSERT_TRUE(x.empty());
+    w.swap(y);
+    ASSERT_TRUE(w.size() == 10);
+    ASSERT_TRUE(y.size() == 3);
+    ASSERT_TRUE(y < w);
+    ASSERT_TRUE(y != w);
+    small_type::const_iterator it = w.begin();
+    ASSERT_TRUE(*(it + 9) == "y");
+    ASSERT_TRUE(w.end() - it == 10);
+}
+
+// -----------
+// BoundedTest
+// -----------
+
+TEST(BoundedTest, TEST_REJECT) 
+{
+    BoundedDeque<int, 4> x;
+    static_assert(BoundedDeque<int, 4>::capacity() == 4, "capacity is a constant expression");
+    ASSERT_TRUE(x.push_back(1));
+    ASSERT_TRUE(x.push_back(2));
+    ASSERT_TRUE(x.push_front(0));
+    ASSERT_TRUE(x.push_back(3));
+    ASSERT_TRUE(x.full());
+    ASSERT_TRUE(!x.push_back(4));
+    ASSERT_TRUE(!x.push_front(-1));
+    ASSERT_TRUE(x.insert(x.begin() + 1, 9) == x.end());
+    ASSERT_TRUE(x.front() == 0);
+    ASSERT_TRUE(x.back() == 3);
+    int v = 0;
+    ASSERT_TRUE(x.try_pop_front(v));
+    ASSERT_TRUE(v == 0);
+    ASSERT_TRUE(*x.insert(x.begin() + 1, 9) == 9);
+    ASSERT_TRUE(x[0] == 1);
+    ASSERT_TRUE(x[1] == 9);
+    ASSERT_TRUE(x.at(3) == 3);
+    ASSERT_THROW(x.at(4), out_of_range);
+}
+
+TEST(BoundedTest, TEST_OVERWRITE) 
+{
+    BoundedDeque<int, 3, deque_overwrite> x;
+    for(int i = 0; i < 10; ++i)
+    {
+        ASSERT_TRUE(x.push_back(i));
+    }
+    ASSERT_TRUE(x.size() == 3);
+    ASSERT_TRUE(x[0] == 7);
+    ASSERT_TRUE(x[2] == 9);
+    x.push_front(6);
+    ASSERT_TRUE(x[0] == 6);
+    ASSERT_TRUE(x[2] == 8);
+    x.insert(x.begin() + 2, 5);
+    ASSERT_TRUE(x[0] == 7);
+    ASSERT_TRUE(x[1] == 5);
+    ASSERT_TRUE(x[2] == 8);
+}
+
+TEST(BoundedTest, TEST_MATCHES_STD_DEQUE) 
+{
+    BoundedDeque<string, 7> x;
+    deque<string> y;
+    srand(20);
+    for(int i = 0; i < 5000; ++i)
+    {
+        string s = to_string(i);
+        int op = rand() % 6;
+        if(op == 0)
+        {
+            ASSERT_TRUE(x.push_back(s) == (y.size() < 7));
+            if(y.size() < 7)
+            {
+                y.push_back(s);
+            }
+        }
+        else if(op == 1)
+        {
+            ASSERT_TRUE(x.push_front(s) == (y.size() < 7));
+            if(y.size() < 7)
+            {
+                y.push_front(s);
+            }
+        }
+        else if(op == 2 && !y.empty())
+        {
+            x.pop_back();
+            y.pop_back();
+        }
+        else if(op == 3 && !y.empty())
+        {
+            x.pop_front();
+            y.pop_front();
+        }
+        else if(op == 4 && !y.empty())
+        {
+            size_t p = rand() % y.size();
+            x.erase(x.begin() + p);
+            y.erase(y.begin() + p);
+        }
+        else if(op == 5 && y.size() < 7)
+        {
+            size_t p = rand() % (y.size() + 1);
+            x.insert(x.begin() + p, s);
+            y.insert(y.begin() + p, s);
+        }
+        ASSERT_TRUE(x.size() == y.size());
+        ASSERT_TRUE(equal(x.begin(), x.end(), y.begin()));
+    }
+    BoundedDeque<string, 7> z(x);
+    ASSERT_TRUE(z == x);
+    BoundedDeque<string, 7> w(std::move(z));
+    ASSERT_TRUE(w == x);
+    ASSERT_TRUE(z.empty());
+}
+
+TEST(BoundedTest, TEST_BLOCK) 
+{
+    BoundedDeque<int, 4, deque_block> x;
+    const int n = 20000;
+    thread producer([&x] () {
+        for(int i = 0; i < n; ++i)
+        {
+            x.push_back(i);
+        }});
+    long long sum = 0;
+    for(int i = 0; i < n; ++i)
+    {
+        int v;
+        x.pop_front(v);
+        ASSERT_TRUE(v == i);
+        sum += v;
+    }
+    producer.join();
+    ASSERT_TRUE(x.empty());
+    ASSERT_TRUE(sum == static_cast<long long>(n) * (n - 1) / 2);
+}
+
+TEST(BoundedTest, TEST_OVERWRITE_ALIASING) 
+{
+    BoundedDeque<string, 4, deque_overwrite> x;
+    for(int i = 0; i < 4; ++i)
+    {
+        x.push_back(string(40, static_cast<char>('a' + i)));
+    }
+    //the argument is the element the push drops
+    x.push_back(x.front());
+    ASSERT_TRUE(x.back() == string(40, 'a'));
+    ASSERT_TRUE(x.front() == string(40, 'b'));
+    x.push_front(x.back());
+    ASSERT_TRUE(x.front() == string(40, 'a'));
+    ASSERT_TRUE(x.back() == string(40, 'd'));
+    x.emplace_back(x.front());
+    ASSERT_TRUE(x.back() == string(40, 'a'));
+    ASSERT_TRUE(x.size() == 4);
+}
+
+TEST(BoundedTest, TEST_CLEAR_WAKES_EVERY_PUSH) 
+{
+    BoundedDeque<int, 2, deque_block> x;
+    x.push_back(0);
+    x.push_back(1);
+    atomic<int> pushed(0);
+    thread a([&] () { x.push_back(2); ++pushed; });
+    thread b([&] () { x.push_back(3); ++pushed; });
+    this_thread::sleep_for(chrono::milliseconds(50));
+    x.clear();
+    for(int i = 0; i < 500 && pushed != 2; ++i)
+    {
+        this_thread::sleep_for(chrono::milliseconds(10));
+    }
+    int both = pushed;
+    //free any push still waiting so the threads can be joined either way
+    int v;
+    while(pushed != 2)
+    {
+        x.try_pop_front(v);
+        this_thread::sleep_for(chrono::milliseconds(1));
+    }
+    a.join();
+    b.join();
+    ASSERT_TRUE(both == 2);
+}
+
+TEST(BoundedTest, TEST_RESIZE_AND_ASSIGN_WAKE_WAITERS) 
+{
+    //resize fills an empty deque under a waiting pop
+    BoundedDeque<int, 2, deque_block> x;
+    atomic<int> popped(0);
+    thread c([&] () { int v; x.pop_front(v); ++popped; });
+    this_thread::sleep_for(chrono::milliseconds(50));
+    x.resize(2, 7);
+    for(int i = 0; i < 500 && popped != 1; ++i)
+    {
+        this_thread::sleep_for(chrono::milliseconds(10));
+    }
+    int woken = popped;
+    if(popped != 1)
+    {
+        //a push is what wakes a pop, so make room for one
+        x.pop_back();
+        x.push_back(7);
+    }
+    c.join();
+    ASSERT_TRUE(woken == 1);
+
+    //assigning an empty deque to a full one frees room for a waiting push
+    x.push_back(8);
+    ASSERT_TRUE(x.full());
+    atomic<int> pushed(0);
+    thread p([&] () { x.push_back(9); ++pushed; });
+    this_thread::sleep_for(chrono::milliseconds(50));
+    const BoundedDeque<int, 2, deque_block> empty;
+    x = empty;
+    for(int i = 0; i < 500 && pushed != 1; ++i)
+    {
+        this_thread::sleep_for(chrono::milliseconds(10));
+    }
+    woken = pushed;
+    while(pushed != 1)
+    {
+        x.clear();
+        this_thread::sleep_for(chrono::milliseconds(1));
+    }
+    p.join();
+    ASSERT_TRUE(woken == 1);
+}
+
+TEST(BoundedTest, TEST_COPY_WHILE_IN_USE) 
+{
+    //copies and assignments lock the deque they read, so they race with no push or pop
+    typedef BoundedDeque<int, 8, deque_block> bounded;
+    bounded x;
+    const int n = 20000;
+    thread producer([&x] () {
+        for(int i = 0; i < n; ++i)
+        {
+            x.push_back(i);
+        }});
+    thread consumer([&x] () {
+        int v;
+        for(int i = 0; i < n; ++i)
+        {
+            x.pop_front(v);
+        }});
+    bounded y;
+    for(int i = 0; i < 200; ++i)
+    {
+        bounded z(x);
+        ASSERT_TRUE(z.size() <= 8);
+        y = x;
+        ASSERT_TRUE(y.size() <= 8);
+        for(bounded::size_type j = 1; j < z.size(); ++j)
+        {
+            ASSERT_TRUE(z[j] == z[j - 1] + 1);
+        }
+    }
+    producer.join();
+    consumer.join();
+    ASSERT_TRUE(x.empty());
+}
+
+// ----------
+// TieredTest
+// ----------
+
+TEST(TieredTest, TEST_MATCHES_STD_DEQUE) 
+{
+    TieredDeque<int, allocator<int>, 8> x;
+    deque<int> y;
+    srand(21);
+    for(int i = 0; i < 20000; ++i)
+    {
+        int op = rand() % 8;
+        if(op == 0)
+        {
+            x.push_back(i);
+            y.push_back(i);
+        }
+        else if(op == 1)
+        {
+            x.push_front(i);
+            y.push_front(i);
+        }
+        else if(op == 2 && !y.empty())
+        {
+            x.pop_back();
+            y.pop_back();
+        }
+        else if(op == 3 && !y.empty())
+        {
+            x.pop_front();
+            y.pop_front();
+        }
+        else if(op == 4 || op == 5)
+        {
+            size_t p = rand() % (y.size() + 1);
+            ASSERT_TRUE(*x.insert(x.begin() + p, i) == i);
+            y.insert(y.begin() + p, i);
+        }
+        else if(op == 6 && !y.empty())
+        {
+            size_t p = rand() % y.size();
+            TieredDeque<int, allocator<int>, 8>::iterator it = x.erase(x.begin() + p);
+            y.erase(y.begin() + p);
+            ASSERT_TRUE(it - x.begin() == static_cast<ptrdiff_t>(p));
+            ASSERT_TRUE(p == y.size() || *it == y[p]);
+        }
+        else if(op == 7 && !y.empty())
+        {
+            size_t p = rand() % y.size();
+            ASSERT_TRUE(x[p] == y[p]);
+            ASSERT_TRUE(*(x.end() - (y.size() - p)) == y[p]);
+        }
+        ASSERT_TRUE(x.size() == y.size());
+    }
+    ASSERT_TRUE(equal(x.begin(), x.end(), y.begin()));
+    ASSERT_TRUE(x.block_count() <= 4 * x.size() / 8 + 1);
+}
+
+/**
+ * counts move assignments and move constructions, to see how far an edit reaches
+ */
+struct MoveCounter
+{
+    static int moves;
+
+    int value;
+
+    MoveCounter (int v = 0) : value(v) {}
+
+    MoveCounter (MoveCounter&& that) : value(that.value)
+    {
+        ++moves;
+    }
+
+    MoveCounter& operator = (MoveCounter&& that)
+    {
+        ++moves;
+        value = that.value;
+        return *this;
+    }
+};
+
+int MoveCounter::moves = 0;
+
+TEST(TieredTest, TEST_MIDDLE_INSERT_STAYS_IN_BLOCK) 
+{
+    TieredDeque<MoveCounter, allocator<MoveCounter>, 16> x;
+    for(int i = 0; i < 1024; ++i)
+    {
+        x.push_back(MoveCounter(i));
+    }
+    MoveCounter::moves = 0;
+    for(int i = 0; i < 100; ++i)
+    {
+        x.insert(x.begin() + 512, MoveCounter(-i));
+        x.erase(x.begin() + 300);
+    }
+    //an insert moves at most half a block (or splits one), an erase at most half a block (or merges two)
+    ASSERT_TRUE(MoveCounter::moves <= 100 * (16 + 16 + 2));
+    ASSERT_TRUE(x.size() == 1024);
+    ASSERT_TRUE(x[511].value == -99);
+}
+
+TEST(TieredTest, TEST_STRINGS_COPY_MOVE) 
+{
+    typedef TieredDeque<string, allocator<string>, 4> tiered_type;
+    tiered_type x;
+    for(int i = 0; i < 100; ++i)
+    {
+        x.insert(x.begin() + x.size() / 2, to_string(i));
+    }
+    ASSERT_TRUE(x.size() == 100);
+    ASSERT_TRUE(x.at(49) == "99");
+    ASSERT_THROW(x.at(100), out_of_range);
+    tiered_type y(x);
+    ASSERT_TRUE(x == y);
+    y.erase(y.begin());
+    ASSERT_TRUE(x != y);
+    ASSERT_TRUE(y < x || x < y);
+    tiered_type z(std::move(y));
+    ASSERT_TRUE(y.empty());
+    ASSERT_TRUE(z.size() == 99);
+    y = x;
+    ASSERT_TRUE(y == x);
+    z = std::move(x);
+    ASSERT_TRUE(z == y);
+    ASSERT_TRUE(x.empty());
+    z.swap(x);
+    ASSERT_TRUE(x == y);
+    ASSERT_TRUE(z.empty());
+    tiered_type::const_iterator it = x.end();
+    --it;
+    ASSERT_TRUE(*it == x.back());
+    ASSERT_TRUE(x.end() - x.begin() == 100);
+}
+
+TEST(TieredTest, TEST_INDEX_AFTER_MIDDLE_EDITS) 
+{
+    TieredDeque<int, allocator<int>, 16> x;
+    vector<int> y;
+    srand(22);
+    for(int i = 0; i < 3000; ++i)
+    {
+        size_t p = rand() % (y.size() + 1);
+        x.insert(x.begin() + p, i);
+        y.insert(y.begin() + p, i);
+        if(i % 3 == 0)
+        {
+            size_t q = rand() % y.size();
+            x.erase(x.begin() + q);
+            y.erase(y.begin() + q);
+        }
+        if(i % 7 == 0)
+        {
+            x.push_front(-i);
+            y.insert(y.begin(), -i);
+        }
+    }
+    ASSERT_TRUE(x.size() == y.size());
+    for(size_t i = 0; i != y.size(); ++i)
+    {
+        ASSERT_TRUE(x[i] == y[i]);
+        ASSERT_TRUE(x.at(i) == y[i]);
+    }
+    const TieredDeque<int, allocator<int>, 16>& c = x;
+    for(size_t i = 0; i < y.size(); i += 97)
+    {
+        ASSERT_TRUE(*(c.begin() + i) == y[i]);
+        ASSERT_TRUE((c.begin() + i) - c.begin() == static_cast<ptrdiff_t>(i));
+    }
+    while(!x.empty())
+    {
+        x.erase(x.begin() + x.size() / 2);
+        y.erase(y.begin() + y.size() / 2);
+        if(!y.empty())
+        {
+            ASSERT_TRUE(x[y.size() / 3] == y[y.size() / 3]);
+        }
+    }
+    ASSERT_TRUE(x.block_count() == 0);
+}
+
+TEST(TieredTest, TEST_VERIFY) 
+{
+    TieredDeque<int, allocator<int>, 8> x;
+    srand(21);
+    for(int i = 0; i < 2000; ++i)
+    {
+        x.insert(x.begin() + rand() % (x.size() + 1), i);
+        if(i % 4 == 0)
+        {
+            x.erase(x.begin() + rand() % x.size());
+        }
+        if(i % 100 == 0)
+        {
+            ASSERT_TRUE(x.verify());
+        }
+    }
+    TieredDeque<int, allocator<int>, 8> y(x);
+    ASSERT_TRUE(y.verify());
+}
+
+TEST(TieredTest, TEST_END_BLOCKS_SKIP_THE_INDEX_REBUILD) 
+{
+    //a FIFO over 512 blocks drops and adds a block every 8 cycles
+    TieredDeque<int, allocator<int>, 8> x;
+    for(int i = 0; i < 4096; ++i)
+    {
+        x.push_back(i);
+    }
+    size_t before = x.index_rebuilds();
+    for(int i = 0; i < 100000; ++i)
+    {
+        x.push_back(i);
+        x.pop_front();
+    }
+    ASSERT_TRUE(x.index_rebuilds() - before <= 50);
+    ASSERT_TRUE(x.front() == 100000 - 4096);
+    ASSERT_TRUE(x[4095] == 99999);
+    //growing at the front rebuilds only when the slack runs out, which doubles it
+    TieredDeque<int, allocator<int>, 8> y;
+    for(int i = 0; i < 100000; ++i)
+    {
+        y.push_front(i);
+        y.pop_back();
+        y.push_front(i);
+    }
+    ASSERT_TRUE(y.index_rebuilds() <= 40);
+    ASSERT_TRUE(y.verify());
+    for(size_t i = 0; i < y.size(); i += 997)
+    {
+        ASSERT_TRUE(y[i] == 99999 - static_cast<int>(i / 2));
+    }
+}
+
+/**
+ * the allocations still outstanding from the allocators with each id
+ */
+int& outstanding_by_id (int id)
+{
+    static int outstanding[8] = {};
+    return outstanding[id];
+}
+
+/**
+ * PropagatingAllocator that counts what each id hands out and takes back
+ */
+template <typename T>
+struct TrackingAllocator : public PropagatingAllocator<T>
+{
+    template <typename U>
+    struct rebind
+    {
+        typedef TrackingAllocator<U> other;
+    };
+
+    TrackingAllocator (int i = 0) : PropagatingAllocator<T>(i) {}
+
+    template <typename U>
+    TrackingAllocator (const TrackingAllocator<U>& that) : PropagatingAllocator<T>(that.id) {}
+
+    T* allocate (size_t n)
+    {
+        ++outstanding_by_id(this->id);
+        return allocator<T>::allocate(n);
+    }
+
+    void deallocate (T* p, size_t n)
+    {
+        --outstanding_by_id(this->id);
+        allocator<T>::deallocate(p, n);
+    }
+};
+
+TEST(TieredTest, TEST_ASSIGNMENT_REBINDS_EVERY_ALLOCATOR) 
+{
+    typedef TieredDeque<int, TrackingAllocator<int>, 8> D;
+    {
+        D x((TrackingAllocator<int>(1)));
+        D y((TrackingAllocator<int>(2)));
+        D z((TrackingAllocator<int>(3)));
+        for(int i = 0; i < 100; ++i)
+        {
+            x.push_back(i);
+            y.push_front(i);
+            z.push_back(-i);
+        }
+        y = x;
+        ASSERT_TRUE(outstanding_by_id(2) == 0);
+        ASSERT_TRUE(y.get_allocator().id == 1);
+        ASSERT_TRUE(y == x);
+        z = std::move(y);
+        ASSERT_TRUE(outstanding_by_id(3) == 0);
+        ASSERT_TRUE(z == x);
+        z.push_front(5);
+        ASSERT_TRUE(outstanding_by_id(3) == 0);
+    }
+    ASSERT_TRUE(outstanding_by_id(1) == 0);
+    ASSERT_TRUE(outstanding_by_id(2) == 0);
+    ASSERT_TRUE(outstanding_by_id(3) == 0);
+}
+
+// ------------
+// ParallelTest
+// ------------
+
+TEST(ParallelTest, TEST_FOR_EACH_AND_TRANSFORM) 
+{
+    DequeThreadPool pool(4);
+    ASSERT_TRUE(pool.concurrency() == 4);
+    MyDeque<int, allocator<int>, 16> x;
+    for(int i = 0; i < 10000; ++i)
+    {
+        x.push_back(i);
+    }
+    parallel::for_each(x.begin() + 3, x.end() - 5, [] (int& v) { v *= 2; }, pool);
+    for(int i = 0; i < 10000; ++i)
+    {
+        ASSERT_TRUE(x[i] == ((i < 3 || i >= 9995) ? i : 2 * i));
+    }
+    MyDeque<long, allocator<long>, 8> y(10000);
+    const MyDeque<int, allocator<int>, 16>& c = x;
+    MyDeque<long, allocator<long>, 8>::iterator end = parallel::transform(c.begin(), c.end(), y.begin(), [] (int v) { return v + 1L; }, pool);
+    ASSERT_TRUE(end == y.end());
+    for(int i = 0; i < 10000; ++i)
+    {
+        ASSERT_TRUE(y[i] == x[i] + 1L);
+    }
+    parallel::for_each(x.end(), x.end(), [] (int&) { FAIL(); }, pool);
+}
+
+TEST(ParallelTest, TEST_REDUCE) 
+{
+    DequeThreadPool pool(3);
+    MyDeque<long long, allocator<long long>, 32> x;
+    for(int i = 1; i <= 100000; ++i)
+    {
+        x.push_front(i);
+    }
+    ASSERT_TRUE(parallel::reduce(x.begin(), x.end(), 0LL, pool) == 100000LL * 100001 / 2);
+    ASSERT_TRUE(parallel::reduce(x.begin() + 10, x.begin() + 11, 5LL, pool) == 5 + x[10]);
+    ASSERT_TRUE(parallel::reduce(x.begin(), x.begin(), 7LL, pool) == 7);
+    long long m = parallel::reduce(x.begin(), x.end(), 0LL, [] (long long a, long long b) { return max(a, b); }, pool);
+    ASSERT_TRUE(m == 100000);
+}
+
+TEST(ParallelTest, TEST_SORT) 
+{
+    DequeThreadPool pool(4);
+    srand(23);
+    for(int n : {0, 1, 7, 100, 5000, 40000})
+    {
+        MyDeque<int, allocator<int>, 64> x;
+        vector<int> y;
+        for(int i = 0; i < n; ++i)
+        {
+            int v = rand() % 1000;
+            x.push_back(v);
+            y.push_back(v);
+        }
+        parallel::sort(x.begin(), x.end(), pool);
+        std::sort(y.begin(), y.end());
+        ASSERT_TRUE(equal(x.begin(), x.end(), y.begin()));
+    }
+    //12 runs take an odd number of merge passes, ending in the buffer and moving back grain by grain
+    DequeThreadPool three(3);
+    MyDeque<int, allocator<int>, 64> w;
+    for(int i = 0; i < 40000; ++i)
+    {
+        w.push_front(rand() % 1000);
+    }
+    vector<int> v(w.begin(), w.end());
+    parallel::sort(w.begin(), w.end(), three);
+    std::sort(v.begin(), v.end());
+    ASSERT_TRUE(equal(w.begin(), w.end(), v.begin()));
+    MyDeque<string> z;
+    for(int i = 0; i < 3000; ++i)
+    {
+        z.push_back(to_string(rand()));
+    }
+    parallel::sort(z.begin(), z.end(), greater<string>(), pool);
+    ASSERT_TRUE(is_sorted(z.begin(), z.end(), greater<string>()));
+}
+
+TEST(ParallelTest, TEST_EXCEPTIONS_AND_NESTING) 
+{
+    DequeThreadPool pool(4);
+    atomic<int> calls(0);
+    ASSERT_THROW(pool.run(100, [&calls] (size_t i) {
+        ++calls;
+        if(i == 37)
+        {
+            throw invalid_argument("37");
+        }}), invalid_argument);
+    ASSERT_TRUE(calls == 100);
+    atomic<int> inner(0);
+    pool.run(8, [&pool, &inner] (size_t) {
+        pool.run(8, [&inner] (size_t) { ++inner; });});
+    ASSERT_TRUE(inner == 64);
+}
+
+// --------
+// SimdTest
+// --------
+
+// run f at every instruction set this machine has, then restore the detected one
+template <typename F>
+void at_every_simd_level (F f)
+{
+    const deque_simd_isa detected = deque_simd_detected();
+    for(int level = deque_isa_scalar; level <= detected; ++level)
+    {
+        ASSERT_TRUE(set_deque_simd_level(static_cast<deque_simd_isa>(level)) == level);
+        f();
+    }
+    set_deque_simd_level(detected);
+}
+
+template <typename T>
+void check_simd_algorithms ()
+{
+    srand(24);
+    for(int n : {0, 1, 3, 8, 17, 100, 1003})
+    {
+        for(int offset : {0, 5})
+        {
+            MyDeque<T, allocator<T>, 16> x;
+            deque<T> y;
+            for(int i = 0; i < n + offset; ++i)
+            {
+                T v = static_cast<T>(rand() % 50);
+                x.push_back(v);
+                y.push_back(v);
+            }
+            for(int i = 0; i < offset; ++i)
+            {
+                x.pop_front();
+                y.pop_front();
+            }
+            const MyDeque<T, allocator<T>, 16>& cx = x;
+            for(T v : {T(0), T(7), T(49), T(50)})
+            {
+                ASSERT_EQ(find(x.begin(), x.end(), v) - x.begin(), std::find(y.begin(), y.end(), v) - y.begin());
+                ASSERT_EQ(count(cx.begin(), cx.end(), v), std::count(y.begin(), y.end(), v));
+            }
+            ASSERT_EQ(min_element(x.begin(), x.end()) - x.begin(), std::min_element(y.begin(), y.end()) - y.begin());
+            ASSERT_EQ(max_element(cx.begin(), cx.end()) - cx.begin(), std::max_element(y.begin(), y.end()) - y.begin());
+            ASSERT_EQ(reduce(x.begin(), x.end(), T(1)), std::accumulate(y.begin(), y.end(), T(1)));
+            MyDeque<T, allocator<T>, 16> z(x);
+            z.push_front(T(3));
+            z.pop_front();
+            ASSERT_TRUE(x == z);
+            ASSERT_FALSE(x < z);
+            if(n != 0)
+            {
+                z[n - 1] = z[n - 1] + T(1);
+                ASSERT_FALSE(x == z);
+                ASSERT_TRUE(x < z);
+                ASSERT_TRUE(equal(z.begin(), z.end() - 1, x.begin()));
+            }
+        }
+    }
+}
+
+TEST(SimdTest, TEST_INT) 
+{
+    at_every_simd_level(check_simd_algorithms<int>);
+}
+
+TEST(SimdTest, TEST_FLOAT) 
+{
+    at_every_simd_level(check_simd_algorithms<float>);
+}
+
+TEST(SimdTest, TEST_DOUBLE) 
+{
+    at_every_simd_level(check_simd_algorithms<double>);
+}
+
+TEST(SimdTest, TEST_LEVEL_IS_CLAMPED) 
+{
+    const deque_simd_isa detected = deque_simd_detected();
+    ASSERT_TRUE(set_deque_simd_level(deque_isa_scalar) == deque_isa_scalar);
+    ASSERT_TRUE(deque_simd_level() == deque_isa_scalar);
+    ASSERT_TRUE(set_deque_simd_level(deque_isa_avx2) == detected);
+    ASSERT_TRUE(deque_simd_level() == detected);
+}
+
+TEST(SimdTest, TEST_LEVEL_CHANGES_WHILE_KERNELS_RUN) 
+{
+    const deque_simd_isa detected = deque_simd_detected();
+    MyDeque<int, allocator<int>, 64> x;
+    for(int i = 0; i < 10000; ++i)
+    {
+        x.push_back(i % 10);
+    }
+    atomic<bool> done(false);
+    thread toggler([&] () {
+        for(int i = 0; !done; ++i)
+        {
+            set_deque_simd_level(static_cast<deque_simd_isa>(i % 3));
+        }});
+    int wrong = 0;
+    for(int i = 0; i < 200; ++i)
+    {
+        wrong += (count(x.begin(), x.end(), 3) != 1000);
+    }
+    done = true;
+    toggler.join();
+    set_deque_simd_level(detected);
+    ASSERT_TRUE(wrong == 0);
+}
+
+TEST(SimdTest, TEST_NON_SIMD_TYPES) 
+{
+    MyDeque<string> x;
+    MyDeque<long> y;
+    for(int i = 0; i < 300; ++i)
+    {
+        x.push_back(to_string(i % 37));
+        y.push_back(i % 37);
+    }
+    ASSERT_EQ(count(x.begin(), x.end(), string("5")), 8);
+    ASSERT_EQ(*max_element(x.begin(), x.end()), "9");
+    ASSERT_EQ(min_element(y.begin(), y.end()) - y.begin(), 0);
+    ASSERT_EQ(reduce(y.begin(), y.end(), 0L), accumulate(y.begin(), y.end(), 0L));
+    ASSERT_EQ(reduce(x.begin(), x.begin() + 3, string()), "012");
+}
+
+// ------------
+// SnapshotTest
+// ------------
+
+// a snapshot file in /tmp, removed when it goes out of scope
+struct snapshot_file
+{
+    char path[32];
+    snapshot_file ()
+    {
+        strcpy(path, "/tmp/dequeXXXXXX");
+        ::close(mkstemp(path));
+    }
+    ~snapshot_file ()
+    {
+        remove(path);
+    }
+};
+
+TEST(SnapshotTest, TEST_ROUND_TRIP) 
+{
+    for(int n : {0, 1, 63, 64, 1000})
+    {
+        for(int offset : {0, 5})
+        {
+            MyDeque<int, allocator<int>, 64> x;
+            for(int i = 0; i < n + offset; ++i)
+            {
+                x.push_back(i * 3);
+            }
+            for(int i = 0; i < offset; ++i)
+            {
+                x.pop_front();
+            }
+            stringstream s(ios::in | ios::out | ios::binary);
+            write_snapshot(s, x);
+            write_snapshot(s, x);
+            const size_t blocks = x.empty() ? 0 : (x.begin().get_block_index() + n + 63) / 64;
+            ASSERT_EQ(s.str().size(), 2 * (sizeof(deque_snapshot_header) + blocks * 64 * sizeof(int)));
+            MyDeque<int, allocator<int>, 64> y(3, 7);
+            MyDeque<int, allocator<int>, 16> z;
+            read_snapshot(s, y);
+            read_snapshot(s, z);
+            ASSERT_TRUE(x == y);
+            ASSERT_EQ(z.size(), x.size());
+            ASSERT_TRUE(equal(z.begin(), z.end(), x.begin()));
+        }
+    }
+}
+
+TEST(SnapshotTest, TEST_MAPPED) 
+{
+    MyDeque<int, allocator<int>, 64> x;
+    for(int i = 0; i < 1000; ++i)
+    {
+        x.push_front(i);
+    }
+    snapshot_file f;
+    {
+        ofstream out(f.path, ios::binary);
+        write_snapshot(out, x);
+    }
+    MappedDeque<int, 64> m(f.path);
+    ASSERT_EQ(m.size(), 1000u);
+    ASSERT_EQ(m.front(), 999);
+    ASSERT_EQ(m.back(), 0);
+    for(int i = 0; i < 1000; i += 7)
+    {
+        ASSERT_EQ(m[i], x[i]);
+        ASSERT_EQ(m.begin()[i], x[i]);
+    }
+    ASSERT_THROW(m.at(1000), out_of_range);
+    ASSERT_EQ(m.end() - m.begin(), 1000);
+    ASSERT_TRUE(equal(m.begin(), m.end(), x.begin()));
+    ASSERT_EQ(find(m.begin(), m.end(), 500) - m.begin(), 499);
+    ASSERT_EQ(count(m.begin(), m.end(), 42), 1);
+    MappedDeque<int, 64> n(move(m));
+    ASSERT_TRUE(m.empty());
+    ASSERT_EQ(n[998], 1);
+}
+
+TEST(SnapshotTest, TEST_REJECTS_BAD_SNAPSHOTS) 
+{
+    MyDeque<int, allocator<int>, 64> x(100, 1);
+    stringstream s(ios::in | ios::out | ios::binary);
+    write_snapshot(s, x);
+    const string good = s.str();
+    MyDeque<double> d;
+    stringstream wrong_type(good, ios::in | ios::binary);
+    ASSERT_THROW(read_snapshot(wrong_type, d), runtime_error);
+    MyDeque<int> y;
+    stringstream truncated(good.substr(0, good.size() - 300), ios::in | ios::binary);
+    ASSERT_THROW(read_snapshot(truncated, y), runtime_error);
+    stringstream bad_magic("x" + good.substr(1), ios::in | ios::binary);
+    ASSERT_THROW(read_snapshot(bad_magic, y), runtime_error);
+    snapshot_file f;
+    {
+        ofstream out(f.path, ios::binary);
+        out << good;
+    }
+    ASSERT_THROW((MappedDeque<int, 32>(f.path)), runtime_error);
+    {
+        ofstream out(f.path, ios::binary);
+        out << good.substr(0, good.size() - 4);
+    }
+    ASSERT_THROW((MappedDeque<int, 64>(f.path)), runtime_error);
+    ASSERT_THROW((MappedDeque<int, 64>("/nonexistent/deque")), system_error);
+}
+
+TEST(SnapshotTest, TEST_REJECTS_CORRUPT_SIZES) 
+{
+    MyDeque<int, allocator<int>, 64> x(100, 1);
+    stringstream s(ios::in | ios::out | ios::binary);
+    write_snapshot(s, x);
+    const string good = s.str();
+    //sizes that wrap the block count, that no allocator could hold, and that the file is too short for
+    for(uint64_t size : {~uint64_t(0) - 2, ~uint64_t(0) / 2, uint64_t(1) << 40})
+    {
+        string bad = good;
+        memcpy(&bad[offsetof(deque_snapshot_header, size)], &size, sizeof(size));
+        MyDeque<int, allocator<int>, 64> y;
+        stringstream in(bad, ios::in | ios::binary);
+        ASSERT_THROW(read_snapshot(in, y), runtime_error);
+        snapshot_file f;
+        {
+            ofstream out(f.path, ios::binary);
+            out << bad;
+        }
+        ASSERT_THROW((MappedDeque<int, 64>(f.path)), runtime_error);
+    }
+}
@@ -0,0 +1,1171 @@
+// ----------------------------
+// projects/deque/TieredDeque.h
+// ----------------------------
+
+#ifndef TieredDeque_h
+#define TieredDeque_h
+
+// --------
+// includes
+// --------
+
+#include <algorithm>   // equal, fill, lexicographical_compare, move, move_backward
+#include <cassert>     // assert
+#include <cstddef>     // size_t
+#include <iterator>    // random_access_iterator_tag
+#include <memory>      // allocator, allocator_traits
+#include <new>         // placement new
+#include <stdexcept>   // out_of_range
+#include <type_traits> // enable_if, is_convertible, remove_const
+#include <utility>     // forward, move, move_if_noexcept, swap
+
+#include "Deque.h"
+
+// -----------
+// TieredDeque
+// -----------
+
+/**
+ * deque of partially filled blocks (a tiered vector): block k holds its elements contiguously
+ * in slots [lo, hi) of B, and the blocks are kept in a MyDeque of tiers
+ * a middle insert or erase shifts the shorter side of one block and never touches the others;
+ * a full block splits in two, and a block that gets small merges with a neighbour,
+ * so the only cost beyond the block is the O(number of blocks) bookkeeping on the tier list
+ * a Fenwick tree over the block sizes finds the block of an index in O(log(number of blocks));
+ * an edit inside a block updates it in O(log), a split or merge rebuilds it in O(number of blocks)
+ * the tree keeps empty nodes in front of the first block, so a block added or dropped at
+ * either end costs O(log) amortized, and push and pop at either end stay amortized O(log(number of blocks))
+ * T the element type
+ * A the allocator
+ * B the number of slots per block
+ */
+template < typename T, typename A = std::allocator<T>, std::size_t B = deque_block_size<T>::value >
+class TieredDeque {
+    static_assert(B >= 4, "TieredDeque blocks need room to split and merge");
+
+    public:
+        // --------
+        // typedefs
+        // --------
+
+        typedef A                                          allocator_type;
+        typedef std::allocator_traits<allocator_type>      allocator_traits;
+        typedef typename allocator_traits::value_type      value_type;
+
+        typedef typename allocator_traits::size_type       size_type;
+        typedef typename allocator_traits::difference_type difference_type;
+
+        typedef typename allocator_traits::pointer         pointer;
+        typedef typename allocator_traits::const_pointer   const_pointer;
+
+        typedef value_type&                                reference;
+        typedef const value_type&                          const_reference;
+
+        // ----------
+        // block_size
+        // ----------
+
+        static const size_type block_size = B;
+
+    private:
+        // ----
+        // tier
+        // ----
+
+        /**
+         * one block and the slots [lo, hi) its elements occupy
+         */
+        struct tier {
+            pointer   data;
+            size_type lo;
+            size_type hi;
+
+            size_type size () const {
+                return hi - lo;}};
+
+        typedef typename allocator_traits::template rebind_alloc<tier> tier_allocator_type;
+        typedef MyDeque<tier, tier_allocator_type>                     tier_list;
+
+        typedef typename allocator_traits::template rebind_alloc<size_type> index_allocator_type;
+        typedef MyDeque<size_type, index_allocator_type>                    index_tree;
+
+        // --------------
+        // basic_iterator
+        // --------------
+
+        /**
+         * random-access iterator holding the deque, a block and a slot in it
+         * stepping stays in the block until it runs out; jumping goes through the element's index
+         * D the deque type (const for the const_iterator)
+         * V the element type (const for the const_iterator)
+         */
+        template <typename D, typename V>
+        class basic_iterator {
+            friend class TieredDeque;
+
+            template <typename, typename>
+            friend class basic_iterator;
+
+            public:
+                // --------
+                // typedefs
+                // --------
+
+                typedef std::random_access_iterator_tag       iterator_category;
+                typedef typename std::remove_const<V>::type   value_type;
+                typedef typename TieredDeque::difference_type difference_type;
+                typedef V*                                    pointer;
+                typedef V&                                    reference;
+
+            private:
+                D*        owner;
+                size_type block;
+                size_type slot;
+
+                size_type index () const {
+                    return owner->index_of(block, slot);}
+
+            public:
+                // -----------
+                // constructor
+                // -----------
+
+                basic_iterator (D* o = 0, size_type k = 0, size_type p = 0) :
+                        owner(o),
+                        block(k),
+                        slot(p)
+                {}
+
+                /**
+                 * iterator to const_iterator
+                 */
+                template <typename D2, typename V2, typename = typename std::enable_if<std::is_convertible<D2*, D*>::value>::type>
+                basic_iterator (const basic_iterator<D2, V2>& that) :
+                        owner(that.owner),
+                        block(that.block),
+                        slot(that.slot)
+                {}
+
+                // -----------
+                // operator ==
+                // -----------
+
+                friend bool operator == (const basic_iterator& lhs, const basic_iterator& rhs) {
+                    return (lhs.block == rhs.block) && (lhs.slot == rhs.slot);}
+
+                friend bool operator != (const basic_iterator& lhs, const basic_iterator& rhs) {
+                    return !(lhs == rhs);}
+
+                friend bool operator < (const basic_iterator& lhs, const basic_iterator& rhs) {
+                    return (lhs.block < rhs.block) || ((lhs.block == rhs.block) && (lhs.slot < rhs.slot));}
+
+                friend bool operator > (const basic_iterator& lhs, const basic_iterator& rhs) {
+                    return rhs < lhs;}
+
+                friend bool operator <= (const basic_iterator& lhs, const basic_iterator& rhs) {
+                    return !(rhs < lhs);}
+
+                friend bool operator >= (const basic_iterator& lhs, const basic_iterator& rhs) {
+                    return !(lhs < rhs);}
+
+                // ----------
+                // operator +
+                // ----------
+
+                friend basic_iterator operator + (basic_iterator lhs, difference_type rhs) {
+                    return lhs += rhs;}
+
+                friend basic_iterator operator + (difference_type lhs, basic_iterator rhs) {
+                    return rhs += lhs;}
+
+                friend basic_iterator operator - (basic_iterator lhs, difference_type rhs) {
+                    return lhs -= rhs;}
+
+                friend difference_type operator - (const basic_iterator& lhs, const basic_iterator& rhs) {
+                    if (lhs.block == rhs.block)
+                        return static_cast<difference_type>(lhs.slot) - static_cast<difference_type>(rhs.slot);
+                    return static_cast<difference_type>(lhs.index()) - static_cast<difference_type>(rhs.index());}
+
+                // ----------
+                // operator *
+                // ----------
+
+                reference operator * () const {
+                    return owner->tiers[block].data[slot];}
+
+                pointer operator -> () const {
+                    return &**this;}
+
+                reference operator [] (difference_type n) const {
+                    return *(*this + n);}
+
+                // -----------
+                // operator ++
+                // -----------
+
+                basic_iterator& operator ++ () {
+                    if (++slot == owner->tiers[block].hi) {
+                        ++block;
+                        slot = (block < owner->tiers.size()) ? owner->tiers[block].lo : 0;}
+                    return *this;}
+
+                basic_iterator operator ++ (int) {
+                    basic_iterator x = *this;
+                    ++*this;
+                    return x;}
+
+                basic_iterator& operator -- () {
+                    if ((block == owner->tiers.size()) || (slot == owner->tiers[block].lo)) {
+                        --block;
+                        slot = owner->tiers[block].hi;}
+                    --slot;
+                    return *this;}
+
+                basic_iterator operator -- (int) {
+                    basic_iterator x = *this;
+                    --*this;
+                    return x;}
+
+                // -----------
+                // operator +=
+                // -----------
+
+                basic_iterator& operator += (difference_type d) {
+                    if (block < owner->tiers.size()) {
+                        difference_type s = static_cast<difference_type>(slot) + d;
+                        const tier& t = owner->tiers[block];
+                        if ((s >= static_cast<difference_type>(t.lo)) && (s < static_cast<difference_type>(t.hi))) {
+                            slot = s;
+                            return *this;}}
+                    owner->locate(index() + d, block, slot);
+                    return *this;}
+
+                basic_iterator& operator -= (difference_type d) {
+                    return *this += -d;}};
+
+    public:
+        typedef basic_iterator<TieredDeque, value_type>             iterator;
+        typedef basic_iterator<const TieredDeque, const value_type> const_iterator;
+
+    private:
+        // ----
+        // data
+        // ----
+
+        allocator_type _a;
+        tier_list      tiers;
+        index_tree     counts;        //Fenwick tree: node front_slack + k is block k
+        size_type      front_slack;   //empty nodes before the first block
+        size_type      rebuilds;
+        size_type      size_num;
+
+    private:
+        // -----
+        // valid
+        // -----
+
+        /**
+         * the O(1) invariants, asserted after every operation: the end blocks and the shape of the index
+         */
+        bool valid () const {
+            if (tiers.empty())
+                return (size_num == 0) && (counts.size() == front_slack);
+            const tier& f = tiers.front();
+            const tier& b = tiers.back();
+            return (counts.size() == front_slack + tiers.size()) && (size_num >= tiers.size()) &&
+                   f.data && (f.lo < f.hi) && (f.hi <= B) &&
+                   b.data && (b.lo < b.hi) && (b.hi <= B);}
+
+    public:
+        // ------
+        // verify
+        // ------
+
+        /**
+         * walk every block and the whole index, in O(number of blocks); for tests, and asserted
+         * by the operations that are O(size()) anyway
+         * @return whether every block is non-empty and within its B slots, and the sizes add up
+         */
+        bool verify () const {
+            size_type n = 0;
+            for (size_type k = 0; k != tiers.size(); ++k) {
+                const tier& t = tiers[k];
+                if (!t.data || (t.lo >= t.hi) || (t.hi > B))
+                    return false;
+                n += t.size();}
+            return (n == size_num) && (counts.size() == front_slack + tiers.size()) &&
+                   (tree_prefix(front_slack) == 0) && (prefix(tiers.size()) == size_num);}
+
+        // ------------
+        // constructors
+        // ------------
+
+        /**
+         * nothing is allocated until the first element is added
+         */
+        explicit TieredDeque (const allocator_type& a = allocator_type()) :
+                _a(a),
+                tiers(tier_allocator_type(a)),
+                counts(index_allocator_type(a)),
+                front_slack(0),
+                rebuilds(0),
+                size_num(0)
+        {
+            assert(valid());
+        }
+
+        /**
+         * @param s the number of copies
+         * @param v the element to copy
+         */
+        TieredDeque (size_type s, const_reference v, const allocator_type& a = allocator_type()) :
+                TieredDeque(a)
+        {
+            for(size_type i = 0; i != s; ++i)
+            {
+                emplace_back(v);
+            }
+        }
+
+        /**
+         * @param b the beginning of a range
+         * @param e the end of a range
+         */
+        template <typename II, typename = typename std::enable_if<!std::is_integral<II>::value>::type>
+        TieredDeque (II b, II e, const allocator_type& a = allocator_type()) :
+                TieredDeque(a)
+        {
+            for(; b != e; ++b)
+            {
+                emplace_back(*b);
+            }
+            assert(verify());
+        }
+
+        TieredDeque (const TieredDeque& that) :
+                TieredDeque(that.begin(), that.end(), allocator_traits::select_on_container_copy_construction(that._a))
+        {}
+
+        TieredDeque (TieredDeque&& that) :
+                _a(that._a),
+                tiers(std::move(that.tiers)),
+                counts(std::move(that.counts)),
+                front_slack(that.front_slack),
+                rebuilds(that.rebuilds),
+                size_num(that.size_num)
+        {
+            that.tiers.clear();
+            that.counts.clear();
+            that.front_slack = 0;
+            that.size_num = 0;
+        }
+
+        // ----------
+        // destructor
+        // ----------
+
+        ~TieredDeque ()
+        {
+            clear();
+        }
+
+        // ----------
+        // operator =
+        // ----------
+
+        TieredDeque& operator = (const TieredDeque& that)
+        {
+            if(this != &that)
+            {
+                clear();
+                if(allocator_traits::propagate_on_container_copy_assignment::value)
+                {
+                    _a = that._a;
+                    replace_lists(tier_list(tier_allocator_type(_a)), index_tree(index_allocator_type(_a)));
+                }
+                for(const_iterator it = that.begin(); it != that.end(); ++it)
+                {
+                    emplace_back(*it);
+                }
+                assert(verify());
+            }
+            return *this;
+        }
+
+        /**
+         * steals that's blocks when the allocators allow it, otherwise moves the elements one by one
+         */
+        TieredDeque& operator = (TieredDeque&& that)
+        {
+            if(this == &that)
+            {
+                return *this;
+            }
+            clear();
+            if(allocator_traits::propagate_on_container_move_assignment::value || (_a == that._a))
+            {
+                if(allocator_traits::propagate_on_container_move_assignment::value)
+                {
+                    _a = that._a;
+                }
+                replace_lists(std::move(that.tiers), std::move(that.counts));
+                std::swap(front_slack, that.front_slack);
+                std::swap(size_num, that.size_num);
+            }
+            else
+            {
+                for(iterator it = that.begin(); it != that.end(); ++it)
+                {
+                    emplace_back(std::move(*it));
+                }
+                that.clear();
+            }
+            return *this;
+        }
+
+        // -----------
+        // operator ==
+        // -----------
+
+        friend bool operator == (const TieredDeque& lhs, const TieredDeque& rhs) {
+            return (lhs.size() == rhs.size()) && std::equal(lhs.begin(), lhs.end(), rhs.begin());}
+
+        friend bool operator != (const TieredDeque& lhs, const TieredDeque& rhs) {
+            return !(lhs == rhs);}
+
+        // ----------
+        // operator <
+        // ----------
+
+        friend bool operator < (const TieredDeque& lhs, const TieredDeque& rhs) {
+            return std::lexicographical_compare(lhs.begin(), lhs.end(), rhs.begin(), rhs.end());}
+
+        // -----------
+        // operator []
+        // -----------
+
+        /**
+         * @param index the position of the element
+         * @return the element at index, whose block is found through the Fenwick tree
+         */
+        reference operator [] (size_type index) {
+            size_type k;
+            size_type p;
+            locate(index, k, p);
+            return tiers[k].data[p];}
+
+        const_reference operator [] (size_type index) const {
+            return const_cast<TieredDeque*>(this)->operator[](index);}
+
+        // --
+        // at
+        // --
+
+        /**
+         * @param index the position of the element
+         * @return the element at index
+         * @throw out_of_range
+         */
+        reference at (size_type index) {
+            if (index >= size_num)
+                throw std::out_of_range("invalid index");
+            return (*this)[index];}
+
+        const_reference at (size_type index) const {
+            return const_cast<TieredDeque*>(this)->at(index);}
+
+        // -----
+        // front
+        // -----
+
+        reference front () {
+            return tiers.front().data[tiers.front().lo];}
+
+        const_reference front () const {
+            return const_cast<TieredDeque*>(this)->front();}
+
+        // ----
+        // back
+        // ----
+
+        reference back () {
+            return tiers.back().data[tiers.back().hi - 1];}
+
+        const_reference back () const {
+            return const_cast<TieredDeque*>(this)->back();}
+
+        // -----
+        // begin
+        // -----
+
+        iterator begin () {
+            return iterator(this, 0, tiers.empty() ? 0 : tiers.front().lo);}
+
+        const_iterator begin () const {
+            return const_iterator(this, 0, tiers.empty() ? 0 : tiers.front().lo);}
+
+        const_iterator cbegin () const {
+            return begin();}
+
+        // ---
+        // end
+        // ---
+
+        iterator end () {
+            return iterator(this, tiers.size(), 0);}
+
+        const_iterator end () const {
+            return const_iterator(this, tiers.size(), 0);}
+
+        const_iterator cend () const {
+            return end();}
+
+        // -----
+        // clear
+        // -----
+
+        void clear ()
+        {
+            while(!tiers.empty())
+            {
+                tier& t = tiers.back();
+                for(size_type p = t.lo; p != t.hi; ++p)
+                {
+                    allocator_traits::destroy(_a, &t.data[p]);
+                }
+                allocator_traits::deallocate(_a, t.data, B);
+                tiers.pop_back();
+            }
+            counts.clear();
+            front_slack = 0;
+            size_num = 0;
+        }
+
+        // -----
+        // empty
+        // -----
+
+        bool empty () const {
+            return size_num == 0;}
+
+        // ----
+        // size
+        // ----
+
+        size_type size () const {
+            return size_num;}
+
+        // -----------
+        // block_count
+        // -----------
+
+        /**
+         * @return the number of blocks in use, at most about 4 * size() / B + 1
+         */
+        size_type block_count () const {
+            return tiers.size();}
+
+        // -------------
+        // get_allocator
+        // -------------
+
+        allocator_type get_allocator () const {
+            return _a;}
+
+        // --------------
+        // index_rebuilds
+        // --------------
+
+        /**
+         * @return how often the Fenwick tree was rebuilt whole: on every split or merge and
+         * every middle block added or dropped, but only once the front slack runs out or piles up at the ends
+         */
+        size_type index_rebuilds () const {
+            return rebuilds;}
+
+        // ------------
+        // emplace_back
+        // ------------
+
+        template <typename... Args>
+        reference emplace_back (Args&&... args)
+        {
+            if(tiers.empty() || (tiers.back().hi == B))
+            {
+                add_tier(tiers.size(), 0, std::forward<Args>(args)...);
+            }
+            else
+            {
+                tier& t = tiers.back();
+                allocator_traits::construct(_a, &t.data[t.hi], std::forward<Args>(args)...);
+                ++t.hi;
+                add(tiers.size() - 1, 1);
+            }
+            ++size_num;
+            assert(valid());
+            return back();
+        }
+
+        // -------------
+        // emplace_front
+        // -------------
+
+        template <typename... Args>
+        reference emplace_front (Args&&... args)
+        {
+            if(tiers.empty() || (tiers.front().lo == 0))
+            {
+                add_tier(0, B - 1, std::forward<Args>(args)...);
+            }
+            else
+            {
+                tier& t = tiers.front();
+                allocator_traits::construct(_a, &t.data[t.lo - 1], std::forward<Args>(args)...);
+                --t.lo;
+                add(0, 1);
+            }
+            ++size_num;
+            assert(valid());
+            return front();
+        }
+
+        // ---------
+        // push_back
+        // ---------
+
+        void push_back (const_reference v) {
+            emplace_back(v);}
+
+        void push_back (value_type&& v) {
+            emplace_back(std::move(v));}
+
+        // ----------
+        // push_front
+        // ----------
+
+        void push_front (const_reference v) {
+            emplace_front(v);}
+
+        void push_front (value_type&& v) {
+            emplace_front(std::move(v));}
+
+        // --------
+        // pop_back
+        // --------
+
+        void pop_back ()
+        {
+            assert(!empty());
+            tier& t = tiers.back();
+            allocator_traits::destroy(_a, &t.data[--t.hi]);
+            --size_num;
+            add(tiers.size() - 1, -1);
+            if(t.lo == t.hi)
+            {
+                remove_tier(tiers.size() - 1);
+            }
+            assert(valid());
+        }
+
+        // ---------
+        // pop_front
+        // ---------
+
+        void pop_front ()
+        {
+            assert(!empty());
+            tier& t = tiers.front();
+            allocator_traits::destroy(_a, &t.data[t.lo++]);
+            --size_num;
+            add(0, -1);
+            if(t.lo == t.hi)
+            {
+                remove_tier(0);
+            }
+            assert(valid());
+        }
+
+        // -------
+        // emplace
+        // -------
+
+        /**
+         * construct an element before it, shifting the shorter side of its block
+         * a full block is split in two first
+         * @param it the position of insertion
+         * @param args the arguments forwarded to the constructor of the new element
+         * @return an iterator to the new element
+         */
+        template <typename... Args>
+        iterator emplace (const_iterator it, Args&&... args)
+        {
+            if(it.block == tiers.size())
+            {
+                emplace_back(std::forward<Args>(args)...);
+                return iterator(this, tiers.size() - 1, tiers.back().hi - 1);
+            }
+            if((it.block == 0) && (it.slot == tiers.front().lo))
+            {
+                emplace_front(std::forward<Args>(args)...);
+                return begin();
+            }
+            value_type v(std::forward<Args>(args)...);
+            size_type k = it.block;
+            size_type p = it.slot;
+            if((tiers[k].lo == 0) && (tiers[k].hi == B))
+            {
+                split(k);
+                if(p > tiers[k].hi)
+                {
+                    p -= tiers[k].hi;
+                    ++k;
+                }
+            }
+            p = open_gap(k, p, v);
+            ++size_num;
+            add(k, 1);
+            assert(valid());
+            return iterator(this, k, p);
+        }
+
+        // ------
+        // insert
+        // ------
+
+        iterator insert (const_iterator it, const_reference v) {
+            return emplace(it, v);}
+
+        iterator insert (const_iterator it, value_type&& v) {
+            return emplace(it, std::move(v));}
+
+        // -----
+        // erase
+        // -----
+
+        /**
+         * remove the element at it, shifting the shorter side of its block
+         * an emptied block is freed, and a block that gets small is merged with a neighbour
+         * @return an iterator to the element after it
+         */
+        iterator erase (const_iterator it)
+        {
+            size_type index = it.index();
+            size_type k = it.block;
+            size_type p = it.slot;
+            tier& t = tiers[k];
+            if(p - t.lo < t.hi - p - 1)
+            {
+                std::move_backward(&t.data[t.lo], &t.data[p], &t.data[p + 1]);
+                allocator_traits::destroy(_a, &t.data[t.lo++]);
+            }
+            else
+            {
+                std::move(&t.data[p + 1], &t.data[t.hi], &t.data[p]);
+                allocator_traits::destroy(_a, &t.data[--t.hi]);
+            }
+            --size_num;
+            add(k, -1);
+            if(t.lo == t.hi)
+            {
+                remove_tier(k);
+            }
+            else
+            {
+                merge_small(k);
+            }
+            assert(valid());
+            size_type nk;
+            size_type np;
+            locate(index, nk, np);
+            return iterator(this, nk, np);
+        }
+
+        // ----
+        // swap
+        // ----
+
+        void swap (TieredDeque& that)
+        {
+            if(allocator_traits::propagate_on_container_swap::value)
+            {
+                std::swap(_a, that._a);
+            }
+            assert(_a == that._a);
+            tiers.swap(that.tiers);
+            counts.swap(that.counts);
+            std::swap(front_slack, that.front_slack);
+            std::swap(rebuilds, that.rebuilds);
+            std::swap(size_num, that.size_num);
+        }
+
+    private:
+        // -------------
+        // replace_lists
+        // -------------
+
+        /**
+         * replace the (empty) tier list and index with t and c, allocators included; assigning
+         * would keep the old allocators unless theirs propagate, and then blocks from the new _a
+         * would be tracked by lists from the old one
+         */
+        void replace_lists (tier_list&& t, index_tree&& c) noexcept
+        {
+            assert(tiers.empty() && counts.empty());
+            tiers.~tier_list();
+            ::new (static_cast<void*>(&tiers)) tier_list(std::move(t));
+            counts.~index_tree();
+            ::new (static_cast<void*>(&counts)) index_tree(std::move(c));
+        }
+
+        // --------
+        // index_of
+        // --------
+
+        /**
+         * @return the index of the element in slot p of block k (size() for the end)
+         */
+        size_type index_of (size_type k, size_type p) const
+        {
+            return (k == tiers.size()) ? size_num : prefix(k) + (p - tiers[k].lo);
+        }
+
+        // ------
+        // locate
+        // ------
+
+        /**
+         * find element index, or the end when index is size()
+         * @param k set to its block
+         * @param p set to its slot
+         */
+        void locate (size_type index, size_type& k, size_type& p) const
+        {
+            if(index >= size_num)
+            {
+                k = tiers.size();
+                p = 0;
+                return;
+            }
+            //descend the Fenwick tree: k is the number of whole nodes before index, the empty slack included
+            size_type m = counts.size();
+            size_type step = 1;
+            while((step << 1) <= m)
+            {
+                step <<= 1;
+            }
+            k = 0;
+            for(; step != 0; step >>= 1)
+            {
+                if((k + step <= m) && (counts[k + step - 1] <= index))
+                {
+                    k += step;
+                    index -= counts[k - 1];
+                }
+            }
+            k -= front_slack;
+            p = tiers[k].lo + index;
+        }
+
+        // ------
+        // prefix
+        // ------
+
+        /**
+         * @return the number of elements in blocks [0, k)
+         */
+        size_type prefix (size_type k) const {
+            return tree_prefix(front_slack + k);}
+
+        /**
+         * @return the sum of nodes [0, r)
+         */
+        size_type tree_prefix (size_type r) const
+        {
+            size_type n = 0;
+            for(; r != 0; r &= r - 1)
+            {
+                n += counts[r - 1];
+            }
+            return n;
+        }
+
+        // ---
+        // add
+        // ---
+
+        /**
+         * record that block k gained (or lost) d elements
+         */
+        void add (size_type k, difference_type d) {
+            tree_add(front_slack + k, d);}
+
+        /**
+         * add d to node r; counts[i] holds the sum of nodes [i & (i + 1), i]
+         */
+        void tree_add (size_type r, difference_type d)
+        {
+            for(; r < counts.size(); r |= r + 1)
+            {
+                counts[r] += d;
+            }
+        }
+
+        // -------
+        // reindex
+        // -------
+
+        /**
+         * rebuild the Fenwick tree in O(number of blocks), after blocks were inserted or removed
+         * in the middle, or when the front slack ran out or grew past twice the blocks;
+         * leaves as many empty nodes in front as there are blocks, plus a few, so the next
+         * rebuild for the front's sake is as many front blocks away
+         */
+        void reindex ()
+        {
+            ++rebuilds;
+            front_slack = tiers.size() + 4;
+            counts.resize(front_slack + tiers.size());
+            std::fill(counts.begin(), counts.begin() + front_slack, 0);
+            for(size_type k = 0; k != tiers.size(); ++k)
+            {
+                counts[front_slack + k] = tiers[k].size();
+            }
+            for(size_type k = 0; k != counts.size(); ++k)
+            {
+                size_type j = k | (k + 1);
+                if(j < counts.size())
+                {
+                    counts[j] += counts[k];
+                }
+            }
+        }
+
+        // --------
+        // add_tier
+        // --------
+
+        /**
+         * allocate a block holding one new element in slot p and put it at position k of the tier list
+         */
+        template <typename... Args>
+        void add_tier (size_type k, size_type p, Args&&... args)
+        {
+            pointer data = allocator_traits::allocate(_a, B);
+            try
+            {
+                allocator_traits::construct(_a, &data[p], std::forward<Args>(args)...);
+                try
+                {
+                    tier t = {data, p, p + 1};
+                    if(k == tiers.size())
+                    {
+                        //a new last block only needs its own node: the sum of nodes [r & (r + 1), r]
+                        size_type r = front_slack + k;
+                        counts.push_back(tree_prefix(r) - tree_prefix(r & (r + 1)) + 1);
+                        try
+                        {
+                            tiers.push_back(t);
+                        }
+                        catch(...)
+                        {
+                            counts.pop_back();
+                            throw;
+                        }
+                    }
+                    else if((k == 0) && (front_slack != 0))
+                    {
+                        //a new first block takes over the empty node just before the old one
+                        tiers.push_front(t);
+                        --front_slack;
+                        tree_add(front_slack, 1);
+                    }
+                    else
+                    {
+                        tiers.insert(tiers.begin() + k, t);
+                        reindex();
+                    }
+                }
+                catch(...)
+                {
+                    allocator_traits::destroy(_a, &data[p]);
+                    throw;
+                }
+            }
+            catch(...)
+            {
+                allocator_traits::deallocate(_a, data, B);
+                throw;
+            }
+        }
+
+        // -----------
+        // remove_tier
+        // -----------
+
+        /**
+         * free the (empty) block k and drop it from the tier list
+         */
+        void remove_tier (size_type k)
+        {
+            assert(tiers[k].lo == tiers[k].hi);
+            allocator_traits::deallocate(_a, tiers[k].data, B);
+            if(k + 1 == tiers.size())
+            {
+                //no other node covers the last block
+                tiers.pop_back();
+                counts.pop_back();
+            }
+            else if(k == 0)
+            {
+                //the first block's node is already 0: it joins the slack
+                tiers.pop_front();
+                ++front_slack;
+            }
+            else
+            {
+                tiers.erase(tiers.begin() + k);
+                reindex();
+                return;
+            }
+            if(front_slack > 2 * tiers.size() + 8)
+            {
+                reindex();
+            }
+        }
+
+        // --------
+        // open_gap
+        // --------
+
+        /**
+         * move v into block k before slot p, shifting the shorter side that has room
+         * @return the slot v ended up in
+         */
+        size_type open_gap (size_type k, size_type p, value_type& v)
+        {
+            tier& t = tiers[k];
+            assert(t.size() < B);
+            if((t.hi < B) && ((t.lo == 0) || (t.hi - p <= p - t.lo)))
+            {
+                if(p == t.hi)
+                {
+                    allocator_traits::construct(_a, &t.data[p], std::move(v));
+                }
+                else
+                {
+                    allocator_traits::construct(_a, &t.data[t.hi], std::move(t.data[t.hi - 1]));
+                    std::move_backward(&t.data[p], &t.data[t.hi - 1], &t.data[t.hi]);
+                    t.data[p] = std::move(v);
+                }
+                ++t.hi;
+                return p;
+            }
+            if(p == t.lo)
+            {
+                allocator_traits::construct(_a, &t.data[p - 1], std::move(v));
+            }
+            else
+            {
+                allocator_traits::construct(_a, &t.data[t.lo - 1], std::move(t.data[t.lo]));
+                std::move(&t.data[t.lo + 1], &t.data[p], &t.data[t.lo]);
+                t.data[p - 1] = std::move(v);
+            }
+            --t.lo;
+            return p - 1;
+        }
+
+        // -----
+        // split
+        // -----
+
+        /**
+         * move the upper half of the full block k into a new block after it
+         */
+        void split (size_type k)
+        {
+            const size_type h = B / 2;
+            pointer data = allocator_traits::allocate(_a, B);
+            size_type n = 0;
+            try
+            {
+                for(; n != B - h; ++n)
+                {
+                    allocator_traits::construct(_a, &data[n], std::move_if_noexcept(tiers[k].data[h + n]));
+                }
+                tier t = {data, 0, B - h};
+                tiers.insert(tiers.begin() + (k + 1), t);
+            }
+            catch(...)
+            {
+                while(n != 0)
+                {
+                    allocator_traits::destroy(_a, &data[--n]);
+                }
+                allocator_traits::deallocate(_a, data, B);
+                throw;
+            }
+            for(size_type p = h; p != B; ++p)
+            {
+                allocator_traits::destroy(_a, &tiers[k].data[p]);
+            }
+            tiers[k].hi = h;
+            reindex();
+        }
+
+        // -----------
+        // merge_small
+        // -----------
+
+        /**
+         * merge block k with a neighbour when the two together fill at most half a block,
+         * so the number of blocks stays proportional to size() / B
+         */
+        void merge_small (size_type k)
+        {
+            if((k + 1 < tiers.size()) && (tiers[k].size() + tiers[k + 1].size() <= B / 2))
+            {
+                merge(k);
+            }
+            else if((k != 0) && (tiers[k - 1].size() + tiers[k].size() <= B / 2))
+            {
+                merge(k - 1);
+            }
+        }
+
+        // -----
+        // merge
+        // -----
+
+        /**
+         * pack the elements of blocks k and k + 1 into the bottom of block k and free block k + 1
+         */
+        void merge (size_type k)
+        {
+            tier& t = tiers[k];
+            tier& u = tiers[k + 1];
+            size_type n = 0;
+            for(size_type p = t.lo; p != t.hi; ++p, ++n)
+            {
+                if(p != n)
+                {
+                    allocator_traits::construct(_a, &t.data[n], std::move(t.data[p]));
+                    allocator_traits::destroy(_a, &t.data[p]);
+                }
+            }
+            for(size_type p = u.lo; p != u.hi; ++p, ++n)
+            {
+                allocator_traits::construct(_a, &t.data[n], std::move(u.data[p]));
+                allocator_traits::destroy(_a, &u.data[p]);
+            }
+            t.lo = 0;
+            t.hi = n;
+            allocator_traits::deallocate(_a, u.data, B);
+            tiers.erase(tiers.begin() + (k + 1));
+            reindex();
+        }
+};
+
+template <typename T, typename A, std::size_t B>
+const typename TieredDeque<T, A, B>::size_type TieredDeque<T, A, B>::block_size;
+
+#endif // TieredDeque_h